@@ -0,0 +1,44 @@
+#include "benchmark.h"
+#include <chrono>
+#include <cstdio>
+
+namespace Benchmark {
+    static volatile std::size_t sink = 0;
+
+    double measure(const std::function<void()> &function, const double minSeconds) {
+        typedef std::chrono::steady_clock Clock;
+
+        // Warm up
+        function();
+
+        int iterations = 0;
+        double elapsed = 0;
+        const Clock::time_point start = Clock::now();
+        do {
+            function();
+            iterations++;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < minSeconds);
+
+        return elapsed / iterations;
+    }
+
+    void report(const std::string &name, const double seconds, const std::size_t bytes, const std::size_t items, const char *itemName) {
+        std::printf("%-52s %12.3f us", name.c_str(), seconds * 1e6);
+        if (bytes > 0) {
+            std::printf(" %10.2f MB/s", bytes / seconds / (1024.0 * 1024.0));
+        } else {
+            std::printf(" %15s", "");
+        }
+
+        if (items > 0) {
+            std::printf(" %14.0f %s/s", items / seconds, itemName);
+        }
+
+        std::printf("\n");
+    }
+
+    void consume(const std::size_t value) {
+        sink = sink + value;
+    }
+}
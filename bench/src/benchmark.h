@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Minimal benchmarking helpers (wall clock based).
+ */
+namespace Benchmark {
+    /**
+     * Runs a function repeatedly, for at least minSeconds, and returns the average time of a single run.
+     * @param function the function to measure
+     * @param minSeconds the minimum total measuring time
+     * @return the average time of a single run, in seconds
+     */
+    double measure(const std::function<void()> &function, double minSeconds = 0.25);
+
+    /**
+     * Prints a benchmark result.
+     * @param name the name of the benchmark
+     * @param seconds the time of a single run, in seconds
+     * @param bytes the number of bytes processed by a single run (used to report MB/s, zero to omit)
+     * @param items the number of items processed by a single run (used to report items/s, zero to omit)
+     * @param itemName the name of the items (e.g. "modules")
+     */
+    void report(const std::string &name, double seconds, std::size_t bytes, std::size_t items = 0, const char *itemName = "items");
+
+    /**
+     * Consumes a value, so that the computation producing it is not optimized away.
+     * @param value the value to consume
+     */
+    void consume(std::size_t value);
+
+    /**
+     * Builds a GLSL-like source with a few directives and many regular lines.
+     * @param count the number of lines
+     * @return the source lines
+     */
+    std::vector<std::string> buildSourceLines(int count);
+
+    /**
+     * Compares std::regex include detection with {@link DirectiveScanner}.
+     */
+    void directiveScannerBenchmarks();
+
+    /**
+     * Measures {@link ParsedModule::parse()} on a large module.
+     */
+    void parsedModuleBenchmarks();
+
+    /**
+     * Compares the line splitting and trimming functions of {@link StringUtils} with their former implementations, for
+     * each supported instruction set.
+     */
+    void stringUtilsBenchmarks();
+
+    /**
+     * Measures the {@link ModuleGraph} loading steps on synthetic include graphs (see {@link GraphGenerator}).
+     */
+    void moduleGraphBenchmarks();
+}
@@ -0,0 +1,88 @@
+#include "benchmark.h"
+#include <glsl_assembler/directive_scanner.h>
+#include <glsl_assembler/string_utils.h>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+    std::vector<std::string> buildSourceLines(const int count) {
+        std::vector<std::string> lines;
+        lines.reserve(count);
+        for (int i = 0; i < count; i++) {
+            switch (i % 16) {
+                case 0: lines.push_back("#include <common/math_" + std::to_string(i) + ".glsl>"); break;
+                case 1: lines.push_back("#include \"../local/utils_" + std::to_string(i) + ".glsl\""); break;
+                case 2: lines.push_back("// Computes the " + std::to_string(i) + "-th helper"); break;
+                case 3: lines.push_back("vec3 helper" + std::to_string(i) + "(in vec3 position, in vec3 normal) {"); break;
+                case 4: lines.push_back(""); break;
+                case 5: lines.push_back("}"); break;
+                case 6: lines.push_back("precision highp float;"); break;
+                default: lines.push_back("    vec3 value = normalize(position * normal + vec3(0.5, 0.25, " + std::to_string(i) + ".0));"); break;
+            }
+        }
+
+        return lines;
+    }
+
+    // The regex based detection previously used by Module::analyzeDependencies()
+    static std::size_t scanWithRegex(const std::vector<std::string> &sourceLines) {
+        std::size_t found = 0;
+        const std::regex relativeRegex(R"(^#include \"((\\.|[^\"])*)\"$)");
+        const std::regex absoluteRegex(R"(^#include <((\\.|[^\"])*)>$)");
+        for (int i = 0; i < sourceLines.size(); i++) {
+            const std::string line = StringUtils::trim_copy(sourceLines[i]);
+            if (StringUtils::startsWith(line, "//")) {
+                continue;
+            }
+
+            auto relativeIncludesBegin = std::sregex_iterator(line.begin(), line.end(), relativeRegex);
+            auto relativeIncludesEnd = std::sregex_iterator();
+            if (relativeIncludesBegin != relativeIncludesEnd) {
+                found += relativeIncludesBegin->str(1).size();
+            } else {
+                auto absoluteIncludesBegin = std::sregex_iterator(line.begin(), line.end(), absoluteRegex);
+                auto absoluteIncludesEnd = std::sregex_iterator();
+                if (absoluteIncludesBegin != absoluteIncludesEnd) {
+                    found += absoluteIncludesBegin->str(1).size();
+                }
+            }
+
+            if (StringUtils::startsWith(line, "#version") || StringUtils::startsWith(line, "precision")) {
+                found++;
+            }
+        }
+
+        return found;
+    }
+
+    static std::size_t scanWithDirectiveScanner(const std::vector<std::string> &sourceLines) {
+        std::size_t found = 0;
+        for (const std::string &line : sourceLines) {
+            const DirectiveScanner::Directive directive = DirectiveScanner::scanLine(line.data(), line.data() + line.size());
+            if (directive.isInclude()) {
+                found += directive.argumentLength;
+            } else if (directive.isHoisted()) {
+                found++;
+            }
+        }
+
+        return found;
+    }
+
+    void directiveScannerBenchmarks() {
+        const std::vector<std::string> lines = buildSourceLines(20000);
+        std::size_t bytes = 0;
+        for (const std::string &line : lines) {
+            bytes += line.size() + 1;
+        }
+
+        if (scanWithRegex(lines) != scanWithDirectiveScanner(lines)) {
+            std::printf("directive scanner: results differ from the regex implementation!\n");
+        }
+
+        report("directive scan (std::regex, 20k lines)", measure([&]() { consume(scanWithRegex(lines)); }), bytes);
+        report("directive scan (DirectiveScanner, 20k lines)", measure([&]() { consume(scanWithDirectiveScanner(lines)); }), bytes);
+    }
+}
@@ -0,0 +1,107 @@
+#include "graph_generator.h"
+#include <stdexcept>
+#include <vector>
+
+namespace Benchmark {
+    std::string MemoryModuleLoader::load(const std::string &path) {
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+
+    void GeneratedGraph::addModule(const std::string &id, const std::string &source) {
+        loader.files[id] = source;
+        bytes += source.size();
+    }
+
+    namespace GraphGenerator {
+        // A few lines of GLSL, with a hoisted line every now and then
+        static std::string moduleBody(const int index, const int lines) {
+            std::string body;
+            if (index % 10 == 0) {
+                body += "precision highp float;\n";
+            }
+
+            const std::string suffix = std::to_string(index);
+            body += "// Generated module " + suffix + "\n";
+            body += "vec3 function" + suffix + "(in vec3 position, in vec3 normal) {\n";
+            for (int i = 0; i < lines; i++) {
+                body += "    position += normalize(position * normal + vec3(0.5, 0.25, " + std::to_string(i) + ".0));\n";
+            }
+
+            body += "    return position;\n}\n";
+            return body;
+        }
+
+        static std::string moduleId(const std::string &prefix, const int index) {
+            return "shaders/" + prefix + "_" + std::to_string(index) + ".glsl";
+        }
+
+        // Relative to the including module, all the modules are in the same directory
+        static std::string include(const std::string &prefix, const int index) {
+            return "#include \"" + prefix + "_" + std::to_string(index) + ".glsl\"\n";
+        }
+
+        GeneratedGraph chain(const int count) {
+            GeneratedGraph graph;
+            graph.name = "chain (" + std::to_string(count) + " modules)";
+            graph.rootModule = moduleId("chain", 0);
+            for (int i = 0; i < count; i++) {
+                const std::string includes = i + 1 < count ? include("chain", i + 1) : "";
+                graph.addModule(moduleId("chain", i), includes + moduleBody(i, 4));
+            }
+
+            return graph;
+        }
+
+        GeneratedGraph fanOut(const int count) {
+            GeneratedGraph graph;
+            graph.name = "fan-out (" + std::to_string(count + 1) + " modules)";
+            graph.rootModule = "shaders/main.glsl";
+
+            std::string root = "#version 330\n";
+            for (int i = 0; i < count; i++) {
+                root += include("leaf", i);
+                graph.addModule(moduleId("leaf", i), moduleBody(i, 4));
+            }
+
+            graph.addModule(graph.rootModule, root + "void main() {}\n");
+            return graph;
+        }
+
+        GeneratedGraph diamonds(const int layers, const int width) {
+            GeneratedGraph graph;
+            graph.name = "diamonds (" + std::to_string(layers * width + 1) + " modules)";
+            graph.rootModule = "shaders/main.glsl";
+
+            // Every module of a layer includes every module of the next layer
+            std::vector<std::string> layerIncludes(layers + 1);
+            for (int layer = 0; layer < layers; layer++) {
+                for (int i = 0; i < width; i++) {
+                    layerIncludes[layer] += include("layer" + std::to_string(layer), i);
+                }
+            }
+
+            for (int layer = 0; layer < layers; layer++) {
+                for (int i = 0; i < width; i++) {
+                    const std::string prefix = "layer" + std::to_string(layer);
+                    graph.addModule(moduleId(prefix, i), layerIncludes[layer + 1] + moduleBody(layer * width + i, 4));
+                }
+            }
+
+            graph.addModule(graph.rootModule, "#version 330\n" + layerIncludes[0] + "void main() {}\n");
+            return graph;
+        }
+
+        GeneratedGraph hugeFile(const int lines) {
+            GeneratedGraph graph;
+            graph.name = "huge file (" + std::to_string(lines) + " lines)";
+            graph.rootModule = "shaders/main.glsl";
+            graph.addModule(graph.rootModule, "#version 330\n" + moduleBody(0, lines) + "void main() {}\n");
+            return graph;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <glsl_assembler/simple_module_loader.h>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace Benchmark {
+    /**
+     * Loads modules from memory.
+     */
+    class MemoryModuleLoader : public SimpleModuleLoader {
+    public:
+        std::unordered_map<std::string, std::string> files;
+
+        std::string load(const std::string &path) override;
+    };
+
+    /**
+     * A synthetic include graph.
+     */
+    struct GeneratedGraph {
+        /**
+         * Name of the graph, used in reports.
+         */
+        std::string name;
+
+        /**
+         * Id of the root module.
+         */
+        std::string rootModule;
+
+        /**
+         * Loader containing the modules.
+         */
+        MemoryModuleLoader loader;
+
+        /**
+         * Total size of the module sources, in bytes.
+         */
+        std::size_t bytes = 0;
+
+        /**
+         * Adds a module to the loader.
+         * @param id the module id
+         * @param source the module source
+         */
+        void addModule(const std::string &id, const std::string &source);
+
+        /**
+         * @return the number of modules.
+         */
+        int getModuleCount() const { return loader.files.size(); }
+    };
+
+    /**
+     * Generators of synthetic include graphs.
+     */
+    namespace GraphGenerator {
+        /**
+         * A deep chain: each module includes the next one.
+         * @param count the number of modules
+         */
+        GeneratedGraph chain(int count);
+
+        /**
+         * A wide fan-out: the root module includes all the other modules.
+         * @param count the number of included modules
+         */
+        GeneratedGraph fanOut(int count);
+
+        /**
+         * Dense diamonds: layers of modules, each module including every module of the next layer.
+         * @param layers the number of layers (below the root module)
+         * @param width the number of modules of each layer
+         */
+        GeneratedGraph diamonds(int layers, int width);
+
+        /**
+         * A single huge module.
+         * @param lines the number of lines
+         */
+        GeneratedGraph hugeFile(int lines);
+    }
+}
@@ -0,0 +1,9 @@
+#include "benchmark.h"
+
+int main() {
+    Benchmark::directiveScannerBenchmarks();
+    Benchmark::parsedModuleBenchmarks();
+    Benchmark::stringUtilsBenchmarks();
+    Benchmark::moduleGraphBenchmarks();
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include "benchmark.h"
+#include "graph_generator.h"
+#include <glsl_assembler/graph_snapshot.h>
+#include <glsl_assembler/info_log_rewriter.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/path_resolver.h>
+#include <glsl_assembler/profiler.h>
+#include <glsl_assembler/thread_pool.h>
+#include <glsl_assembler/variant_assembler.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+    /**
+     * Forwards to a loader whose files never change, with a constant version stamp, so that cached modules are not
+     * loaded again.
+     */
+    class VersionedModuleLoader : public SimpleModuleLoader {
+    private:
+        ModuleLoader &moduleLoader;
+
+    public:
+        explicit VersionedModuleLoader(ModuleLoader &moduleLoader)
+            : moduleLoader(moduleLoader) {
+        }
+
+        std::string load(const std::string &path) override {
+            return moduleLoader.load(path);
+        }
+
+        bool getVersion(const std::string &path, std::uint64_t &version) override {
+            version = 1;
+            return true;
+        }
+    };
+
+    /**
+     * Hands out the sources of a memory loader as borrowed buffers, which are parsed in place instead of being copied.
+     */
+    class BorrowingModuleLoader : public SimpleModuleLoader {
+    private:
+        MemoryModuleLoader &moduleLoader;
+
+    public:
+        explicit BorrowingModuleLoader(MemoryModuleLoader &moduleLoader)
+            : moduleLoader(moduleLoader) {
+        }
+
+        std::string load(const std::string &path) override {
+            return moduleLoader.load(path);
+        }
+
+        SourceBuffer loadBuffer(const std::string &path) override {
+            const std::string &source = moduleLoader.files.at(path);
+            return SourceBuffer::borrow(source.data(), source.size());
+        }
+    };
+
+    static void graphBenchmarks(GeneratedGraph graph) {
+        std::printf("\n%s, %.2f MB\n", graph.name.c_str(), graph.bytes / (1024.0 * 1024.0));
+        const std::size_t modules = graph.getModuleCount();
+
+        // Whole loading: reading, parsing, resolving, sorting and assembling
+        report("ModuleGraph::loadModule", measure([&]() {
+            ModuleGraph moduleGraph;
+            moduleGraph.setModuleLoader(&graph.loader);
+            consume(moduleGraph.loadModule(graph.rootModule).size());
+        }), graph.bytes, modules, "modules");
+
+        // Same, parsing the sources in place
+        BorrowingModuleLoader borrowingLoader(graph.loader);
+        report("ModuleGraph::loadModule (borrowed buffers)", measure([&]() {
+            ModuleGraph moduleGraph;
+            moduleGraph.setModuleLoader(&borrowingLoader);
+            consume(moduleGraph.loadModule(graph.rootModule).size());
+        }), graph.bytes, modules, "modules");
+
+        // Loading again with every module cached: only module creation, resolution, sort, assembly and teardown
+        VersionedModuleLoader versionedLoader(graph.loader);
+        ModuleCache moduleCache;
+        ModuleGraph cachedGraph;
+        cachedGraph.setModuleLoader(&versionedLoader);
+        cachedGraph.setModuleCache(&moduleCache);
+        report("ModuleGraph::loadModule (module cache)", measure([&]() {
+            consume(cachedGraph.loadModule(graph.rootModule).size());
+        }), graph.bytes, modules, "modules");
+
+        // Restoring the whole graph from a snapshot, in memory and memory mapped
+        const std::string snapshot = GraphSnapshot::encode(cachedGraph);
+        report("GraphSnapshot::encode", measure([&]() {
+            consume(GraphSnapshot::encode(cachedGraph).size());
+        }), snapshot.size(), modules, "modules");
+
+        report("GraphSnapshot::decode", measure([&]() {
+            ModuleGraph moduleGraph;
+            consume(GraphSnapshot::decode(moduleGraph, SourceBuffer::borrow(snapshot.data(), snapshot.size())));
+        }), snapshot.size(), modules, "modules");
+
+        const std::string snapshotPath = "module_graph_bench.snapshot";
+        GraphSnapshot::save(cachedGraph, snapshotPath);
+        report("GraphSnapshot::load", measure([&]() {
+            ModuleGraph moduleGraph;
+            consume(GraphSnapshot::load(moduleGraph, snapshotPath));
+        }), snapshot.size(), modules, "modules");
+        std::remove(snapshotPath.c_str());
+
+        // Directive analysis of every module
+        report("ParsedModule::parse", measure([&]() {
+            for (const auto &file : graph.loader.files) {
+                consume(ParsedModule::parse(file.first, file.second)->getSourceLinesCount());
+            }
+        }), graph.bytes, modules, "modules");
+
+        // Topological sort and assembly on their own, from the profiler phase times of whole loadings
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&graph.loader);
+        Profiler profiler;
+        profiler.setRecordEvents(false);
+        moduleGraph.setProfiler(&profiler);
+        int loads = 0;
+        measure([&]() {
+            consume(moduleGraph.loadModule(graph.rootModule).size());
+            loads++;
+        });
+        moduleGraph.setProfiler(nullptr);
+
+        const Profiler::Statistics statistics = profiler.getStatistics();
+        const auto phaseSeconds = [&](const Profiler::Phase phase) {
+            return std::chrono::duration<double>(statistics.getPhaseTime(phase)).count() / loads;
+        };
+
+        report("ModuleGraph::buildTopologicalSort", phaseSeconds(Profiler::Phase::SORT), 0, modules, "modules");
+        report("ModuleGraph::assembleSource", phaseSeconds(Profiler::Phase::ASSEMBLE), moduleGraph.getAssembledSourceSize(), modules, "modules");
+
+        // Resolves the path of every dependency edge, with and without the resolution cache
+        int edges = 0;
+        for (int i = 0; i < modules; i++) {
+            edges += moduleGraph.getSortedModule(i)->getParsedModule()->getIncludeCount();
+        }
+
+        report("SimpleModuleLoader::join (dependency edges)", measure([&]() {
+            for (int i = 0; i < modules; i++) {
+                const Module *module = moduleGraph.getSortedModule(i);
+                const ParsedModule &parsedModule = *module->getParsedModule();
+                for (int j = 0; j < parsedModule.getIncludeCount(); j++) {
+                    consume(graph.loader.join(graph.loader.extractPath(module->getId()), parsedModule.getInclude(j).path).size());
+                }
+            }
+        }), 0, edges, "edges");
+
+        PathResolver pathResolver(&graph.loader);
+        report("PathResolver::join (dependency edges)", measure([&]() {
+            for (int i = 0; i < modules; i++) {
+                const Module *module = moduleGraph.getSortedModule(i);
+                const ParsedModule &parsedModule = *module->getParsedModule();
+                for (int j = 0; j < parsedModule.getIncludeCount(); j++) {
+                    consume(pathResolver.join(pathResolver.extractPath(module->getId()), parsedModule.getInclude(j).path).size());
+                }
+            }
+        }), 0, edges, "edges");
+
+        // Maps every assembled line back to its module
+        const int lines = moduleGraph.getSourceBlock(moduleGraph.getSourceBlocksCount() - 1).assembledRange.end + 1;
+        report("ModuleGraph::mapLine", measure([&]() {
+            int moduleLine = 0;
+            for (int line = 0; line < lines; line++) {
+                consume(moduleGraph.mapLine(line, moduleLine) != nullptr);
+            }
+        }), 0, lines, "lines");
+
+        // Rewrites a driver info log with an error on every 7th line, in the driver order (by line, then repeated)
+        std::string infoLog;
+        int errors = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int line = pass; line < lines; line += 7) {
+                infoLog += "0:" + std::to_string(line + 1) + "(12): error: 'x' : undeclared identifier\n";
+                errors++;
+            }
+        }
+
+        const InfoLogRewriter rewriter(moduleGraph);
+        std::vector<InfoLogRewriter::Reference> references;
+        rewriter.findReferences(infoLog, references);
+        report("ModuleGraph::mapLine (info log references)", measure([&]() {
+            int moduleLine = 0;
+            for (const InfoLogRewriter::Reference &reference : references) {
+                consume(moduleGraph.mapLine(reference.line, moduleLine) != nullptr);
+            }
+        }), 0, errors, "errors");
+
+        report("InfoLogRewriter::rewrite", measure([&]() {
+            consume(rewriter.rewrite(infoLog).size());
+        }), infoLog.size(), errors, "errors");
+    }
+
+    // Assembles many #define variants of a graph, by loading it again for each variant or with VariantAssembler
+    static void variantBenchmarks(GeneratedGraph graph, const int variantCount) {
+        std::printf("\n%s, %d variants\n", graph.name.c_str(), variantCount);
+        std::vector<std::vector<VariantAssembler::Define>> defineSets(variantCount);
+        for (int i = 0; i < variantCount; i++) {
+            for (int bit = 0; bit < 9; bit++) {
+                if (i & (1 << bit)) {
+                    defineSets[i].emplace_back("FEATURE_" + std::to_string(bit));
+                }
+            }
+        }
+
+        const std::string rootSource = graph.loader.files[graph.rootModule];
+        report("ModuleGraph::loadModule per variant", measure([&]() {
+            for (const std::vector<VariantAssembler::Define> &defines : defineSets) {
+                std::string source;
+                for (const VariantAssembler::Define &define : defines) {
+                    source += "#define " + define.name + "\n";
+                }
+
+                graph.loader.files[graph.rootModule] = source + rootSource;
+                ModuleGraph moduleGraph;
+                moduleGraph.setModuleLoader(&graph.loader);
+                consume(moduleGraph.loadModule(graph.rootModule).size());
+            }
+        }), 0, variantCount, "variants");
+        graph.loader.files[graph.rootModule] = rootSource;
+
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&graph.loader);
+        moduleGraph.loadModule(graph.rootModule);
+        const VariantAssembler variantAssembler(moduleGraph);
+        report("VariantAssembler::assembleAll", measure([&]() {
+            consume(variantAssembler.assembleAll(defineSets).size());
+        }), 0, variantCount, "variants");
+
+        ThreadPool threadPool;
+        report("VariantAssembler::assembleAll (thread pool)", measure([&]() {
+            consume(variantAssembler.assembleAll(defineSets, &threadPool).size());
+        }), 0, variantCount, "variants");
+    }
+
+    void moduleGraphBenchmarks() {
+        graphBenchmarks(GraphGenerator::chain(10000));
+        graphBenchmarks(GraphGenerator::fanOut(10000));
+        graphBenchmarks(GraphGenerator::diamonds(20, 50));
+        graphBenchmarks(GraphGenerator::hugeFile(200000));
+        variantBenchmarks(GraphGenerator::diamonds(20, 50), 64);
+    }
+}
@@ -0,0 +1,36 @@
+#include "benchmark.h"
+#include <glsl_assembler/analysis_cache.h>
+#include <glsl_assembler/hash.h>
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/string_utils.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+    // Byte-at-a-time 64-bit FNV-1a, as a baseline for Hash::xxh64() (http://www.isthe.com/chongo/tech/comp/fnv/)
+    static std::uint64_t fnv1a(const std::string &str) {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (const char c : str) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    void parsedModuleBenchmarks() {
+        const std::string source = StringUtils::join(buildSourceLines(20000), "\n") + "\n";
+        report("FNV-1a baseline (20k lines)", measure([&]() { consume(fnv1a(source)); }), source.size());
+        report("Hash::xxh64 (20k lines)", measure([&]() { consume(Hash::xxh64(source)); }), source.size());
+        report("ParsedModule::parse (20k lines)", measure([&]() {
+            consume(ParsedModule::parse("bench.glsl", source)->getSourceLinesCount());
+        }), source.size());
+
+        AnalysisCache analysisCache("bench_analysis_cache.bin");
+        ParsedModule::parse("bench.glsl", source, &analysisCache);
+        report("ParsedModule::parse (20k lines, analysis cache hit)", measure([&]() {
+            consume(ParsedModule::parse("bench.glsl", source, &analysisCache)->getSourceLinesCount());
+        }), source.size());
+    }
+}
@@ -0,0 +1,82 @@
+#include "benchmark.h"
+#include "graph_generator.h"
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/string_utils.h>
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+    // The former implementations, for comparison
+    static std::vector<std::string> splitLinesGetline(const std::string &str) {
+        std::vector<std::string> result;
+        std::stringstream ss(str);
+
+        std::string line;
+        while (std::getline(ss, line)) {
+            result.push_back(line);
+        }
+
+        return result;
+    }
+
+    static std::string trimCopyIsspace(std::string s) {
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
+        return s;
+    }
+
+    static const char *getSimdLevelName(const StringUtils::SimdLevel level) {
+        switch (level) {
+            case StringUtils::SimdLevel::SSE2:
+                return "SSE2";
+            case StringUtils::SimdLevel::AVX2:
+                return "AVX2";
+            default:
+                return "scalar";
+        }
+    }
+
+    void stringUtilsBenchmarks() {
+        GeneratedGraph graph = GraphGenerator::hugeFile(200000);
+        const std::string source = graph.loader.load(graph.rootModule);
+        const std::vector<std::string> lines = StringUtils::splitLines(source);
+
+        report("splitLines, std::getline (huge file)", measure([&]() { consume(splitLinesGetline(source).size()); }), source.size());
+        report("trim_copy, std::isspace (huge file lines)", measure([&]() {
+            for (const std::string &line : lines) {
+                consume(trimCopyIsspace(line).size());
+            }
+        }), source.size());
+
+        const StringUtils::SimdLevel supportedLevel = StringUtils::getSupportedSimdLevel();
+        const StringUtils::SimdLevel levels[] = { StringUtils::SimdLevel::SCALAR, StringUtils::SimdLevel::SSE2, StringUtils::SimdLevel::AVX2 };
+        std::vector<std::size_t> newlines;
+        for (const StringUtils::SimdLevel level : levels) {
+            if (level > supportedLevel) {
+                continue;
+            }
+
+            StringUtils::setSimdLevel(level);
+            const std::string suffix = std::string(", ") + getSimdLevelName(level) + " (huge file)";
+            report("findNewlines" + suffix, measure([&]() {
+                newlines.clear();
+                StringUtils::findNewlines(source.data(), source.size(), newlines);
+                consume(newlines.size());
+            }), source.size());
+            report("splitLines" + suffix, measure([&]() { consume(StringUtils::splitLines(source).size()); }), source.size());
+            report("trim_copy" + suffix, measure([&]() {
+                for (const std::string &line : lines) {
+                    consume(StringUtils::trim_copy(line).size());
+                }
+            }), source.size());
+            report("ParsedModule::parse" + suffix, measure([&]() {
+                consume(ParsedModule::parse(graph.rootModule, source)->getSourceLinesCount());
+            }), source.size());
+        }
+
+        StringUtils::setSimdLevel(supportedLevel);
+    }
+}
@@ -3,4 +3,5 @@
 # the exported information of targets GLSLAssembler, this is how the targets and their properties
 # are imported into another project.
 include(CMakeFindDependencyMacro)
+find_dependency(Threads)
 include("${CMAKE_CURRENT_LIST_DIR}/GLSLAssemblerTargets.cmake")
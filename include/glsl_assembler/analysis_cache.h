@@ -0,0 +1,191 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/parsed_module.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * <p>Persistent (on-disk) cache of the directive analysis of modules: their include directives and hoisted lines.
+ * <p>Entries are keyed by the source contents (hash and size), so they do not depend on the module id nor on the
+ * {@link ModuleLoader}. When an entry is found, {@link ParsedModule::parse()} only splits the source into lines and
+ * skips directive scanning entirely.
+ * <p>The cache is stored in a single file, read by {@link #load()} and written by {@link #save()} (atomically, through
+ * a temporary file). The file is versioned and checksummed: a stale, truncated or corrupt file is ignored, and the
+ * cache starts empty.
+ * <p>The number of entries is bounded (see {@link #setMaxEntries()}): the least recently used entries are evicted, so
+ * that the analyses of sources which no longer exist (e.g. every saved version of an edited file) do not accumulate.
+ * The entries are saved from the least to the most recently used, so the order survives reloads of the file.
+ * <p>Use it through {@link ModuleGraph::setAnalysisCache()} or {@link ModuleCache::setAnalysisCache()}.
+ * <p>This class is threadsafe.
+ */
+class GLSLASSEMBLER_API AnalysisCache {
+public:
+    /**
+     * The analysis of a module source.
+     */
+    struct GLSLASSEMBLER_API Analysis {
+        /**
+         * The include directives, in line order.
+         */
+        std::vector<ParsedModule::Include> includes;
+
+        /**
+         * The indices of the hoisted lines, in ascending order.
+         */
+        std::vector<int> hoistedLines;
+    };
+
+    /**
+     * Cache statistics.
+     */
+    struct GLSLASSEMBLER_API Statistics {
+        /**
+         * Number of lookups satisfied by the cache.
+         */
+        std::size_t hits = 0;
+
+        /**
+         * Number of lookups not satisfied by the cache.
+         */
+        std::size_t misses = 0;
+
+        /**
+         * Number of entries evicted to respect the maximum number of entries.
+         */
+        std::size_t evictions = 0;
+    };
+
+private:
+    struct Entry {
+        std::size_t sourceSize;
+        Analysis analysis;
+
+        /**
+         * Value of the use clock when the entry was last stored or found.
+         */
+        std::uint64_t lastUse;
+    };
+
+    /**
+     * Path of the cache file.
+     */
+    std::string path;
+
+    /**
+     * Cached analyses, by source hash.
+     */
+    std::unordered_map<std::uint64_t, Entry> entries;
+
+    /**
+     * Incremented on every use of an entry, orders the entries by recency.
+     */
+    std::uint64_t useClock = 0;
+
+    /**
+     * Maximum number of entries (zero means unlimited).
+     */
+    int maxEntries;
+
+    /**
+     * Whether some entry has been added since the last load or save.
+     */
+    bool modified = false;
+
+    Statistics statistics;
+
+    /**
+     * Guards all the fields.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * Evicts the least recently used entries, until at most maxEntries are left. The mutex must be held.
+     */
+    void prune(std::size_t maxEntries);
+
+public:
+    /**
+     * Version of the file format. Files with a different version are ignored.
+     */
+    static const std::uint32_t FORMAT_VERSION = 2;
+
+    /**
+     * Default maximum number of entries (see {@link #setMaxEntries()}).
+     */
+    static const int DEFAULT_MAX_ENTRIES = 65536;
+
+    /**
+     * @param path the path of the cache file (the cache is not loaded, see {@link #load()}).
+     * @param maxEntries the maximum number of entries (zero means unlimited).
+     */
+    explicit AnalysisCache(const std::string &path, int maxEntries = DEFAULT_MAX_ENTRIES);
+
+    AnalysisCache(const AnalysisCache &) = delete;
+    AnalysisCache &operator=(const AnalysisCache &) = delete;
+
+    /**
+     * Replaces the cache contents with the contents of the cache file.
+     * @return true if the file has been loaded, false if it does not exist or is not valid (the cache is then empty).
+     */
+    bool load();
+
+    /**
+     * Writes the cache file, if some entry has been added since the last load or save. The file is written to a
+     * uniquely named temporary file first, so that many processes can save the same cache.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save();
+
+    /**
+     * Looks up the analysis of a source.
+     * @param sourceHash the hash of the source (see {@link Hash::xxh64()})
+     * @param sourceSize the size of the source
+     * @param analysis will contain the analysis
+     * @return true if the analysis has been found
+     */
+    bool find(std::uint64_t sourceHash, std::size_t sourceSize, Analysis &analysis);
+
+    /**
+     * Stores the analysis of a source.
+     * @param sourceHash the hash of the source (see {@link Hash::xxh64()})
+     * @param sourceSize the size of the source
+     * @param analysis the analysis
+     */
+    void store(std::uint64_t sourceHash, std::size_t sourceSize, const Analysis &analysis);
+
+    /**
+     * Sets the maximum number of entries, evicting the least recently used entries if needed. Between saves, the cache
+     * may exceed the maximum by an eighth, so that evictions are amortized.
+     * @param maxEntries the maximum number of entries (zero means unlimited).
+     */
+    void setMaxEntries(int maxEntries);
+
+    /**
+     * @return the maximum number of entries (zero means unlimited).
+     */
+    int getMaxEntries() const;
+
+    /**
+     * @return the path of the cache file.
+     */
+    const std::string &getPath() const { return path; }
+
+    /**
+     * @return the number of cached analyses.
+     */
+    int size() const;
+
+    /**
+     * @return the cache statistics.
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * Removes all the analyses (the file is emptied by the next {@link #save()}).
+     */
+    void clear();
+};
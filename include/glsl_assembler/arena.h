@@ -0,0 +1,157 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * <p>Monotonic memory arena: memory is carved out of large blocks, individual allocations are never freed, and
+ * {@link #release()} frees everything at once.
+ * <p>The arena keeps its largest block across releases, so that an arena which is filled and released repeatedly (e.g.
+ * by a {@link ModuleGraph} loaded again and again) stops allocating from the heap.
+ * <p>Objects created in the arena are not destroyed by it: their destructors must be called explicitly if needed.
+ * <p>This class is <strong>NOT</strong> threadsafe.
+ */
+class GLSLASSEMBLER_API Arena {
+private:
+    /**
+     * Header of a block, followed by its memory.
+     */
+    struct Block {
+        Block *next;
+        std::size_t size;
+    };
+
+    /**
+     * The blocks, the current one first.
+     */
+    Block *blocks = nullptr;
+
+    /**
+     * Free memory of the current block.
+     */
+    char *current = nullptr;
+    char *end = nullptr;
+
+    /**
+     * Size of the first block.
+     */
+    std::size_t initialBlockSize;
+
+    /**
+     * Bytes allocated since the last release.
+     */
+    std::size_t allocatedSize = 0;
+
+    /**
+     * Allocates a new block with at least size bytes, aligned.
+     */
+    void *allocateBlock(std::size_t size, std::size_t alignment);
+
+public:
+    /**
+     * @param initialBlockSize the size of the first block, in bytes (the next blocks are larger).
+     */
+    explicit Arena(std::size_t initialBlockSize = 16 * 1024);
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * Allocates memory, which stays valid until {@link #release()}.
+     * @param size the number of bytes
+     * @param alignment the alignment, a power of two
+     * @return the memory
+     */
+    void *allocate(const std::size_t size, const std::size_t alignment = alignof(std::max_align_t)) {
+        const std::size_t padding = (alignment - reinterpret_cast<std::size_t>(current) % alignment) % alignment;
+        if (!current || padding + size > static_cast<std::size_t>(end - current)) {
+            return allocateBlock(size, alignment);
+        }
+
+        void *memory = current + padding;
+        allocatedSize += padding + size;
+        current += padding + size;
+        return memory;
+    }
+
+    /**
+     * Constructs an object in the arena.
+     * @param args the constructor arguments
+     * @return the object (its destructor is not called by the arena)
+     */
+    template <typename T, typename... Args>
+    T *create(Args &&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Frees all the allocated memory at once, keeping the largest block for the next allocations.
+     */
+    void release();
+
+    /**
+     * @return the number of bytes allocated since the last release (including alignment padding).
+     */
+    std::size_t getAllocatedSize() const { return allocatedSize; }
+
+    /**
+     * @return the total size of the blocks held by the arena, in bytes.
+     */
+    std::size_t getCapacity() const;
+};
+
+/**
+ * <p>Standard allocator backed by an {@link Arena}, for containers whose memory should live in the arena.
+ * <p>Deallocation does nothing (the memory is reclaimed by {@link Arena::release()}). Without an arena, it falls back
+ * to the global operator new and delete.
+ */
+template <typename T>
+class ArenaAllocator {
+private:
+    Arena *arena;
+
+    template <typename U>
+    friend class ArenaAllocator;
+
+public:
+    typedef T value_type;
+
+    /**
+     * @param arena the arena (can be nullptr, to use the heap).
+     */
+    ArenaAllocator(Arena *arena = nullptr)
+        : arena(arena) {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : arena(other.arena) {
+    }
+
+    T *allocate(const std::size_t count) {
+        if (arena) {
+            return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t) {
+        if (!arena) {
+            ::operator delete(pointer);
+        }
+    }
+
+    /**
+     * @return the arena (null for the heap).
+     */
+    Arena *getArena() const { return arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
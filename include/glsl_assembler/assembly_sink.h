@@ -0,0 +1,108 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+/**
+ * <p>Destination of an assembled source (see {@link ModuleGraph::writeAssembledSource()}).
+ * <p>The assembled source is written in many small chunks (usually one per line), so that no intermediate copy of the
+ * whole source is needed. The total size is announced before the first write.
+ */
+class GLSLASSEMBLER_API AssemblySink {
+public:
+    AssemblySink() = default;
+    virtual ~AssemblySink() = default;
+
+    /**
+     * Called once before the first write.
+     * @param size the total number of bytes that will be written.
+     */
+    virtual void reserve(std::size_t size) {
+    }
+
+    /**
+     * Writes a chunk of the assembled source.
+     * @param data the first byte of the chunk
+     * @param size the number of bytes of the chunk
+     */
+    virtual void write(const char *data, std::size_t size) = 0;
+};
+
+/**
+ * Appends the assembled source to a string, which is grown only once.
+ */
+class GLSLASSEMBLER_API StringAssemblySink : public AssemblySink {
+private:
+    std::string &str;
+
+public:
+    /**
+     * @param str the string to append to (not owned, must outlive the sink).
+     */
+    explicit StringAssemblySink(std::string &str)
+        : str(str) {
+    }
+
+    void reserve(const std::size_t size) override {
+        str.reserve(str.size() + size);
+    }
+
+    void write(const char *data, const std::size_t size) override {
+        str.append(data, size);
+    }
+};
+
+/**
+ * Writes the assembled source to an output stream.
+ */
+class GLSLASSEMBLER_API StreamAssemblySink : public AssemblySink {
+private:
+    std::ostream &stream;
+
+public:
+    /**
+     * @param stream the stream to write to (not owned, must outlive the sink).
+     */
+    explicit StreamAssemblySink(std::ostream &stream)
+        : stream(stream) {
+    }
+
+    void write(const char *data, const std::size_t size) override {
+        stream.write(data, size);
+    }
+};
+
+/**
+ * Forwards the assembled source to callbacks.
+ */
+class GLSLASSEMBLER_API CallbackAssemblySink : public AssemblySink {
+public:
+    typedef std::function<void(const char *data, std::size_t size)> WriteCallback;
+    typedef std::function<void(std::size_t size)> ReserveCallback;
+
+private:
+    WriteCallback writeCallback;
+    ReserveCallback reserveCallback;
+
+public:
+    /**
+     * @param writeCallback invoked for each chunk
+     * @param reserveCallback invoked with the total size before the first chunk (optional)
+     */
+    explicit CallbackAssemblySink(WriteCallback writeCallback, ReserveCallback reserveCallback = nullptr)
+        : writeCallback(std::move(writeCallback)),
+          reserveCallback(std::move(reserveCallback)) {
+    }
+
+    void reserve(const std::size_t size) override {
+        if (reserveCallback) {
+            reserveCallback(size);
+        }
+    }
+
+    void write(const char *data, const std::size_t size) override {
+        writeCallback(data, size);
+    }
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/module_graph.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class ModuleCache;
+class ModuleLoader;
+class Profiler;
+class ThreadPool;
+
+/**
+ * <p>Assembles many root modules concurrently.
+ * <p>Each root module is loaded into its own {@link ModuleGraph}, and the graphs are loaded in parallel on a
+ * {@link ThreadPool}. All the graphs share a {@link ModuleCache}, so modules included by many roots are parsed only
+ * once, and the sources returned by the loader are kept for the duration of {@link #assemble()}, so each file is loaded
+ * only once per batch.
+ * <p>The module loader <strong>MUST</strong> be threadsafe, since it is invoked from many threads at once.
+ * <p>This class is <strong>NOT</strong> threadsafe (but a single {@link #assemble()} call uses all the pool threads).
+ */
+class GLSLASSEMBLER_API BatchAssembler {
+public:
+    /**
+     * Result of assembling a single root module.
+     */
+    struct GLSLASSEMBLER_API Result {
+        /**
+         * The pathname of the root module.
+         */
+        std::string modulePath;
+
+        /**
+         * The module graph of the root module, which gives access to the assembled source, the source blocks and the
+         * line mapping (null if the module could not be assembled).
+         * <p>The graph uses the module loader, and the module cache set with {@link BatchAssembler::setModuleCache()}
+         * (if any): it does not refer to the assembler (internal cache, profiler), so it can outlive it.
+         */
+        std::unique_ptr<ModuleGraph> moduleGraph;
+
+        /**
+         * The error message (empty if the module has been assembled).
+         */
+        std::string error;
+
+        /**
+         * @return true if the module has been assembled.
+         */
+        bool succeeded() const { return moduleGraph != nullptr; }
+    };
+
+private:
+    /**
+     * The module loader.
+     */
+    ModuleLoader *moduleLoader;
+
+    /**
+     * The include directory of the graphs.
+     */
+    std::string includeDir;
+
+    /**
+     * The thread pool (null means an internal pool, created on demand).
+     */
+    ThreadPool *threadPool;
+
+    /**
+     * The module cache (null means an internal cache).
+     */
+    ModuleCache *moduleCache;
+
+    /**
+     * The profiler of the graphs (can be nullptr).
+     */
+    Profiler *profiler;
+
+    /**
+     * Internal thread pool, used when no thread pool is set.
+     */
+    std::unique_ptr<ThreadPool> ownThreadPool;
+
+    /**
+     * Internal module cache, used when no module cache is set.
+     */
+    std::unique_ptr<ModuleCache> ownModuleCache;
+
+public:
+    BatchAssembler();
+    ~BatchAssembler();
+
+    BatchAssembler(const BatchAssembler &) = delete;
+    BatchAssembler &operator=(const BatchAssembler &) = delete;
+
+    /**
+     * Assembles the given root modules. A module loader must be set before invoking this method.
+     * <p>Errors do not stop the batch: each root module reports its own error in its {@link Result}.
+     * @param modulePaths the pathnames of the root modules
+     * @return the results, in the same order as modulePaths
+     */
+    std::vector<Result> assemble(const std::vector<std::string> &modulePaths);
+
+    /**
+     * @return the module loader.
+     */
+    ModuleLoader *getModuleLoader() const { return moduleLoader; }
+
+    /**
+     * Sets the module loader, which must be threadsafe.
+     * @param moduleLoader the module loader.
+     */
+    void setModuleLoader(ModuleLoader *moduleLoader) { this->moduleLoader = moduleLoader; }
+
+    /**
+     * @return the include directory.
+     */
+    const std::string &getIncludeDir() const { return includeDir; }
+
+    /**
+     * Sets the include directory of the graphs (see {@link ModuleGraph::setIncludeDir()}).
+     * @param includeDir the include directory.
+     */
+    void setIncludeDir(const std::string &includeDir) { this->includeDir = includeDir; }
+
+    /**
+     * @return the thread pool (null if the internal pool is used).
+     */
+    ThreadPool *getThreadPool() const { return threadPool; }
+
+    /**
+     * Sets the thread pool used to load the graphs. The pool is not owned and must outlive the batch.
+     * <p>When no pool is set, an internal pool with one thread per core is used.
+     * @param threadPool the thread pool, or null to use the internal pool.
+     */
+    void setThreadPool(ThreadPool *threadPool) { this->threadPool = threadPool; }
+
+    /**
+     * @return the module cache (null if the internal cache is used).
+     */
+    ModuleCache *getModuleCache() const { return moduleCache; }
+
+    /**
+     * Sets the module cache shared by the graphs. The cache is not owned, and the result graphs keep using it (e.g.
+     * in {@link ModuleGraph::reload()}).
+     * <p>When no cache is set, an internal cache is used, which is kept across batches; the result graphs then have no
+     * cache.
+     * @param moduleCache the module cache, or null to use the internal cache.
+     */
+    void setModuleCache(ModuleCache *moduleCache) { this->moduleCache = moduleCache; }
+
+    /**
+     * @return the profiler of the graphs (can be nullptr).
+     */
+    Profiler *getProfiler() const { return profiler; }
+
+    /**
+     * Sets the profiler shared by the graphs (see {@link ModuleGraph::setProfiler()}). Each graph records its events
+     * on the pool thread which loads it, so the trace shows the whole batch as a timeline. The result graphs are
+     * detached from the profiler once loaded.
+     * @param profiler the profiler (not owned, can be nullptr).
+     */
+    void setProfiler(Profiler *profiler) { this->profiler = profiler; }
+};
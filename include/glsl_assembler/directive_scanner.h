@@ -0,0 +1,98 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+
+/**
+ * Single-pass scanner for the preprocessor directives handled by GLSLAssembler.
+ * <p>Lines are examined in place: no trimmed copy of the line is built and no regular expression is involved.
+ * <p>The recognized syntax is the same as the one documented in the README:
+ * <ul>
+ *  <li><code>#include "..."</code> and <code>#include <...></code>, with exactly one space after <code>#include</code>
+ *  and nothing (except whitespace) before or after the directive;</li>
+ *  <li>lines starting with <code>#version</code> or <code>precision</code>;</li>
+ *  <li>lines starting with <code>//</code> are comments and are never directives.</li>
+ * </ul>
+ */
+namespace DirectiveScanner {
+    /**
+     * Kind of directive found on a line.
+     */
+    enum class DirectiveType : int {
+        /**
+         * The line does not contain any directive handled by GLSLAssembler.
+         */
+        NONE,
+
+        /**
+         * The line is a line comment.
+         */
+        COMMENT,
+
+        /**
+         * <code>#include "..."</code> directive, the argument is relative to the including module.
+         */
+        RELATIVE_INCLUDE,
+
+        /**
+         * <code>#include <...></code> directive, the argument is relative to the include directory.
+         */
+        ABSOLUTE_INCLUDE,
+
+        /**
+         * Include directive with an empty path (e.g. <code>#include ""</code>).
+         */
+        INVALID_INCLUDE,
+
+        /**
+         * <code>#version</code> directive (must be hoisted).
+         */
+        VERSION,
+
+        /**
+         * <code>precision</code> statement (must be hoisted).
+         */
+        PRECISION
+    };
+
+    /**
+     * Result of scanning a single line.
+     */
+    struct GLSLASSEMBLER_API Directive {
+        /**
+         * Kind of directive.
+         */
+        DirectiveType type = DirectiveType::NONE;
+
+        /**
+         * Start of the include path (points inside the scanned line). Only set for RELATIVE_INCLUDE and ABSOLUTE_INCLUDE.
+         */
+        const char *argument = nullptr;
+
+        /**
+         * Length of the include path.
+         */
+        std::size_t argumentLength = 0;
+
+        /**
+         * @return true if the directive is an include (either relative or absolute)
+         */
+        bool isInclude() const {
+            return type == DirectiveType::RELATIVE_INCLUDE || type == DirectiveType::ABSOLUTE_INCLUDE;
+        }
+
+        /**
+         * @return true if the line must be hoisted at the top of the assembled source
+         */
+        bool isHoisted() const {
+            return type == DirectiveType::VERSION || type == DirectiveType::PRECISION;
+        }
+    };
+
+    /**
+     * Scans a single line (without the EOL terminator) looking for a directive.
+     * @param begin pointer to the first character of the line
+     * @param end pointer past the last character of the line
+     * @return the directive found
+     */
+    GLSLASSEMBLER_API Directive scanLine(const char *begin, const char *end);
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * <p>POSIX file system implementation of {@link ModuleLoader}.
+ * <p>Module paths are normalized by {@link SimpleModuleLoader::join()} (so "." and ".." segments are resolved before
+ * a path becomes a module id), and resolved against an optional root directory: with root directory "assets", the
+ * module "shaders/main.glsl" is read from "assets/shaders/main.glsl".
+ * <p>Files are read with a single read() call into a string allocated with the exact size, so they are copied only once.
+ * <p>Optionally (see {@link #setKeepMappings()}), large files are not copied at all: {@link #loadBuffer()} returns a
+ * read-only memory mapping of the file, which is parsed in place.
+ * <p>Version stamps (see {@link ModuleLoader::getVersion()}) are derived from the modification time and the size of
+ * the files.
+ * <p>This class is threadsafe.
+ */
+class GLSLASSEMBLER_API FileModuleLoader : public SimpleModuleLoader {
+private:
+    /**
+     * Directory the module paths are relative to (empty means the current directory).
+     */
+    std::string rootDir;
+
+    /**
+     * Files smaller than this size (in bytes) are read instead of mapped, when mappings are kept.
+     */
+    std::size_t mmapThreshold;
+
+    /**
+     * Whether {@link #loadBuffer()} returns the mappings of large files instead of copying them.
+     */
+    bool keepMappings;
+
+    /**
+     * Opens a regular file.
+     * @param filePath the file system path
+     * @param size will contain the file size
+     * @return the file descriptor, to be closed by the caller
+     * @throws std::runtime_error if the file cannot be opened or is not a regular file
+     */
+    int openFile(const std::string &filePath, std::size_t &size) const;
+
+    /**
+     * Reads an open file into a string.
+     * @param fd the file descriptor
+     * @param size the file size
+     * @param filePath the file system path (for error messages)
+     * @return the file contents
+     * @throws std::runtime_error if the file cannot be read
+     */
+    std::string readFile(int fd, std::size_t size, const std::string &filePath) const;
+
+public:
+    /**
+     * Default value of the mmap threshold (see {@link #setMmapThreshold()}).
+     */
+    static const std::size_t DEFAULT_MMAP_THRESHOLD = 16 * 1024;
+
+    /**
+     * @param rootDir the directory the module paths are relative to (empty means the current directory).
+     */
+    explicit FileModuleLoader(const std::string &rootDir = "");
+
+    /**
+     * Loads a file.
+     * @param path the module path
+     * @return the file contents
+     * @throws std::runtime_error if the file cannot be read
+     */
+    std::string load(const std::string &path) override;
+
+    /**
+     * Loads a file into a buffer: the string read by {@link #load()}, or the mapping of the file if mappings are kept
+     * (see {@link #setKeepMappings()}).
+     * @param path the module path
+     * @return the file contents
+     * @throws std::runtime_error if the file cannot be read
+     */
+    SourceBuffer loadBuffer(const std::string &path) override;
+
+    /**
+     * @param path the module path
+     * @param version will contain a stamp derived from the modification time and size of the file
+     * @return true if the file exists, false otherwise
+     */
+    bool getVersion(const std::string &path, std::uint64_t &version) override;
+
+    /**
+     * @param pathString the path to check
+     * @return true if the path is an existing directory
+     */
+    bool isPath(const std::string &pathString) override;
+
+    /**
+     * Same as {@link SimpleModuleLoader::join()}, but an empty base path stands for the root directory (instead of
+     * producing an absolute path).
+     * @param path the base path (never includes a filename)
+     * @param pathName a path name, which can include special ".." and "." symbols
+     * @return the joined path
+     */
+    std::string join(const std::string &path, const std::string &pathName) override;
+
+    /**
+     * @param path the module path
+     * @return the file system path of the module (relative to the root directory, unless it is absolute)
+     */
+    std::string getFilePath(const std::string &path) const;
+
+    /**
+     * @return the directory the module paths are relative to.
+     */
+    const std::string &getRootDir() const { return rootDir; }
+
+    /**
+     * Sets the size under which files are read with read() instead of being memory mapped, when mappings are kept (see
+     * {@link #setKeepMappings()}): mapping a small file costs more than reading it.
+     * @param mmapThreshold the size in bytes (zero means always mmap).
+     */
+    void setMmapThreshold(const std::size_t mmapThreshold) { this->mmapThreshold = mmapThreshold; }
+
+    /**
+     * @return the size under which files are read instead of being memory mapped.
+     */
+    std::size_t getMmapThreshold() const { return mmapThreshold; }
+
+    /**
+     * <p>Sets whether {@link #loadBuffer()} returns the mappings of the files above the mmap threshold instead of
+     * copying them. A mapping stays alive as long as a buffer (e.g. a cached {@link ParsedModule}) refers to it.
+     * <p>Only enable it when the files are replaced (written elsewhere, then renamed) rather than rewritten in place:
+     * a mapped file which is modified changes the parsed modules under their feet, and reading past its end once it
+     * has been truncated crashes the process (SIGBUS).
+     * @param keepMappings true to keep the mappings (disabled by default)
+     */
+    void setKeepMappings(const bool keepMappings) { this->keepMappings = keepMappings; }
+
+    /**
+     * @return true if {@link #loadBuffer()} returns the mappings of large files.
+     */
+    bool isKeepMappings() const { return keepMappings; }
+};
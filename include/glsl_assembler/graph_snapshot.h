@@ -0,0 +1,63 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstdint>
+#include <string>
+
+// Forward declarations
+class ModuleGraph;
+class SourceBuffer;
+
+/**
+ * <p>Binary snapshot of a loaded {@link ModuleGraph}: the modules (ids, sources, line tables, include directives with
+ * their resolved dependencies, hoisted lines and version stamps), the topological sort, the assembled source and the
+ * source blocks.
+ * <p>Restoring a snapshot skips loading, parsing, path resolution, sorting and assembly, so it suits builds which
+ * always load the same graphs. The module sources are not copied: they are {@link SourceBuffer} slices of the snapshot
+ * (memory mapped by {@link #load()}), which stays alive as long as a module refers to it. Only the per-module tables
+ * are decoded. Line mapping, module iteration, {@link ModuleGraph::writeAssembledSource()} and
+ * {@link ModuleGraph::reload()} work on the restored graph as on a loaded one.
+ * <p>Snapshots are versioned and checksummed, and every index is checked: a stale, truncated or corrupt snapshot is
+ * rejected, and the graph is left untouched.
+ * <p>Use it through {@link ModuleGraph::saveSnapshot()} and {@link ModuleGraph::loadSnapshot()}, or encode snapshots in
+ * memory (e.g. to store them in a pack file) with {@link #encode()} and {@link #decode()}.
+ */
+class GLSLASSEMBLER_API GraphSnapshot {
+public:
+    /**
+     * Version of the snapshot format. Snapshots with another version are rejected.
+     */
+    static const std::uint32_t FORMAT_VERSION = 1;
+
+    /**
+     * Encodes a loaded graph.
+     * @param moduleGraph the graph
+     * @return the snapshot
+     * @throws std::runtime_error if no module is loaded, or if a module is too large for the format (4 GiB)
+     */
+    static std::string encode(const ModuleGraph &moduleGraph);
+
+    /**
+     * Replaces a graph with the one stored in a snapshot.
+     * @param moduleGraph the graph
+     * @param snapshot the snapshot, referred to by the restored modules
+     * @return true if the snapshot has been restored, false if it is stale or corrupt (the graph is then untouched)
+     */
+    static bool decode(ModuleGraph &moduleGraph, const SourceBuffer &snapshot);
+
+    /**
+     * Writes the snapshot of a loaded graph to a file (atomically, through a uniquely named temporary file).
+     * @param moduleGraph the graph
+     * @param path the path of the snapshot file
+     * @throws std::runtime_error if the graph cannot be encoded, or if the file cannot be written
+     */
+    static void save(const ModuleGraph &moduleGraph, const std::string &path);
+
+    /**
+     * Replaces a graph with the one stored in a snapshot file, which is memory mapped.
+     * @param moduleGraph the graph
+     * @param path the path of the snapshot file
+     * @return true if the snapshot has been restored, false if the file is missing, stale or corrupt (the graph is
+     * then untouched)
+     */
+    static bool load(ModuleGraph &moduleGraph, const std::string &path);
+};
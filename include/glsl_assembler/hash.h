@@ -0,0 +1,38 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Fast non-cryptographic hashing, used to detect changes in module sources.
+ */
+namespace Hash {
+    /**
+     * Computes the 64-bit xxHash (XXH64) of a byte sequence. Processes 32 bytes per iteration; used for module
+     * sources.
+     * @param data pointer to the first byte
+     * @param size number of bytes
+     * @param seed the seed
+     * @return the hash
+     */
+    GLSLASSEMBLER_API std::uint64_t xxh64(const char *data, std::size_t size, std::uint64_t seed = 0);
+
+    /**
+     * Computes the 64-bit xxHash (XXH64) of a string.
+     * @param str the string to hash
+     * @param seed the seed
+     * @return the hash
+     */
+    inline std::uint64_t xxh64(const std::string &str, const std::uint64_t seed = 0) {
+        return xxh64(str.data(), str.size(), seed);
+    }
+
+    /**
+     * Combines a hash with a value. The result depends on the order of the combined values.
+     * @param hash the hash so far
+     * @param value the value to combine
+     * @return the combined hash
+     */
+    GLSLASSEMBLER_API std::uint64_t combine(std::uint64_t hash, std::uint64_t value);
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class ModuleGraph;
+
+/**
+ * <p>Watches the files of many {@link ModuleGraph} with inotify (Linux only), and reloads the graphs whose files changed.
+ * <p>The service knows which files every registered graph depends on. File system events are coalesced: the affected
+ * graphs are reloaded (see {@link ModuleGraph::reload()}) only once no event arrived for the debounce interval, so
+ * a burst of saves causes a single reload. The new assembled sources are published through the reload callback.
+ * <p>Directories are watched, rather than single files, so that editors saving through a temporary file and a rename
+ * are detected as well.
+ * <p>Module ids are mapped to files through {@link FileModuleLoader::getFilePath()} when the graph uses a
+ * {@link FileModuleLoader}, otherwise module ids are used as file paths.
+ * <p>The service does not create threads: {@link #poll()} must be called periodically (e.g. once per frame), or when
+ * {@link #getFileDescriptor()} becomes readable.
+ * <p>This class is <strong>NOT</strong> threadsafe.
+ */
+class GLSLASSEMBLER_API HotReloadService {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Invoked after a graph has been reloaded and its assembled source changed.
+     * The parameters are the graph and the ids of the modules parsed again, added or removed.
+     * The service compacts the reloaded graphs (see {@link ModuleGraph::compact()}): the {@link Module} pointers
+     * obtained from the graph before the callback must not be used anymore.
+     */
+    typedef std::function<void(ModuleGraph *moduleGraph, const std::vector<std::string> &touchedModules)> ReloadCallback;
+
+    /**
+     * Invoked when a graph cannot be reloaded. The parameters are the graph and the error message.
+     */
+    typedef std::function<void(ModuleGraph *moduleGraph, const std::string &error)> ErrorCallback;
+
+    /**
+     * Service statistics.
+     */
+    struct GLSLASSEMBLER_API Statistics {
+        /**
+         * Number of file system events concerning the watched files.
+         */
+        std::size_t events = 0;
+
+        /**
+         * Number of graph reloads that changed the assembled source.
+         */
+        std::size_t reloads = 0;
+
+        /**
+         * Number of graph reloads that failed.
+         */
+        std::size_t failures = 0;
+
+        /**
+         * Latency of the last reload: from the first event of the burst (when read by {@link #poll()}) to the new
+         * assembled source being published through the reload callback.
+         */
+        Clock::duration lastLatency = Clock::duration::zero();
+
+        /**
+         * Maximum latency of the reloads.
+         */
+        Clock::duration maxLatency = Clock::duration::zero();
+
+        /**
+         * Total latency of the reloads (divide by reloads to get the average).
+         */
+        Clock::duration totalLatency = Clock::duration::zero();
+    };
+
+private:
+    /**
+     * A watched directory.
+     */
+    struct Directory {
+        /**
+         * inotify watch descriptor.
+         */
+        int watch = -1;
+
+        /**
+         * Number of watched files in the directory.
+         */
+        int fileCount = 0;
+    };
+
+    /**
+     * inotify file descriptor.
+     */
+    int inotifyFd;
+
+    /**
+     * Watched directories, by path.
+     */
+    std::unordered_map<std::string, Directory> directories;
+
+    /**
+     * Path of the watched directories, by watch descriptor.
+     */
+    std::unordered_map<int, std::string> watchDirectories;
+
+    /**
+     * For each watched file, the graphs depending on it.
+     */
+    std::unordered_map<std::string, std::vector<ModuleGraph *>> fileGraphs;
+
+    /**
+     * For each registered graph, the watched files (sorted).
+     */
+    std::unordered_map<ModuleGraph *, std::vector<std::string>> graphFiles;
+
+    /**
+     * Graphs to reload, with the time of the first event that affected them.
+     */
+    std::unordered_map<ModuleGraph *, Clock::time_point> pendingGraphs;
+
+    /**
+     * Time of the last event affecting some graph.
+     */
+    Clock::time_point lastEventTime;
+
+    /**
+     * Minimum time without events before reloading.
+     */
+    Clock::duration debounce;
+
+    ReloadCallback reloadCallback;
+    ErrorCallback errorCallback;
+    Statistics statistics;
+
+    /**
+     * @return the canonical path of the file of a module, or an empty string if its directory does not exist.
+     */
+    std::string getFile(const ModuleGraph *moduleGraph, const std::string &moduleId) const;
+
+    /**
+     * Watches a directory, unless it is already watched.
+     * @return the directory
+     */
+    Directory &watchDirectory(const std::string &directoryPath);
+
+    /**
+     * Adds a graph to the graphs depending on a file, watching the directory of the file if needed.
+     */
+    void watchFile(ModuleGraph *moduleGraph, const std::string &file);
+
+    /**
+     * Removes a graph from the graphs depending on a file, and stops watching its directory if no file is left in it.
+     */
+    void unwatchFile(ModuleGraph *moduleGraph, const std::string &file);
+
+    /**
+     * Watches the files of a graph (the current modules of the graph). Only the files added or removed since the last
+     * call are watched or unwatched, so that the watches of the unchanged directories are kept (and no event is lost).
+     */
+    void watchGraph(ModuleGraph *moduleGraph);
+
+    /**
+     * Stops watching the files of a graph.
+     */
+    void unwatchGraph(ModuleGraph *moduleGraph);
+
+    /**
+     * Marks the graphs depending on a file as pending.
+     */
+    void fileChanged(const std::string &filePath, Clock::time_point time);
+
+    /**
+     * Reads the available inotify events, waiting at most timeout for the first one.
+     */
+    void readEvents(Clock::duration timeout);
+
+    /**
+     * Reloads the pending graphs.
+     * @return the number of reloaded graphs
+     */
+    int reloadPendingGraphs();
+
+public:
+    /**
+     * Default debounce interval (see {@link #setDebounce()}).
+     */
+    static const int DEFAULT_DEBOUNCE_MS = 50;
+
+    /**
+     * @throws std::runtime_error if inotify cannot be initialized.
+     */
+    HotReloadService();
+    ~HotReloadService();
+
+    HotReloadService(const HotReloadService &) = delete;
+    HotReloadService &operator=(const HotReloadService &) = delete;
+
+    /**
+     * Starts watching the files of a graph, which must already be loaded (see {@link ModuleGraph::loadModule()}).
+     * The set of watched files is updated after each successful reload. When a reload fails because a module cannot be
+     * loaded (see {@link ModuleGraph::getFailedModuleId()}), its file is watched as well, so that creating it reloads
+     * the graph.
+     * @param moduleGraph the graph (not owned, must be removed before being destroyed)
+     */
+    void addGraph(ModuleGraph *moduleGraph);
+
+    /**
+     * Stops watching the files of a graph.
+     * @param moduleGraph the graph
+     */
+    void removeGraph(ModuleGraph *moduleGraph);
+
+    /**
+     * Processes the file system events, and reloads the affected graphs once no event arrived for the debounce interval.
+     * Callbacks are invoked from this method.
+     * @param timeoutMs maximum time to wait for events, in milliseconds (zero means do not wait)
+     * @return the number of graphs reloaded (successfully or not)
+     */
+    int poll(int timeoutMs = 0);
+
+    /**
+     * @return the inotify file descriptor, which becomes readable when there are events to process with {@link #poll()}.
+     */
+    int getFileDescriptor() const { return inotifyFd; }
+
+    /**
+     * @return the number of graphs waiting to be reloaded.
+     */
+    int getPendingGraphsCount() const { return pendingGraphs.size(); }
+
+    /**
+     * @return the number of watched files.
+     */
+    int getWatchedFilesCount() const { return fileGraphs.size(); }
+
+    /**
+     * Sets the minimum time without events before the affected graphs are reloaded.
+     * @param debounce the debounce interval
+     */
+    void setDebounce(const Clock::duration debounce) { this->debounce = debounce; }
+
+    /**
+     * @return the debounce interval.
+     */
+    Clock::duration getDebounce() const { return debounce; }
+
+    /**
+     * @param reloadCallback invoked after a graph has been reloaded and its assembled source changed.
+     */
+    void setReloadCallback(ReloadCallback reloadCallback) { this->reloadCallback = std::move(reloadCallback); }
+
+    /**
+     * @param errorCallback invoked when a graph cannot be reloaded.
+     */
+    void setErrorCallback(ErrorCallback errorCallback) { this->errorCallback = std::move(errorCallback); }
+
+    /**
+     * @return the service statistics.
+     */
+    const Statistics &getStatistics() const { return statistics; }
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/string_view.h>
+#include <glsl_assembler/variant_assembler.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class Module;
+class ModuleGraph;
+class ThreadPool;
+
+/**
+ * <p>Rewrites the info log of a shader compiled from the assembled source of a {@link ModuleGraph} (or of one of its
+ * {@link VariantAssembler::Variant}s), so that every line reference points to a module line:
+ * <code>0(123) : error C0000: ...</code> becomes <code>shaders/lighting.glsl:42 : error C0000: ...</code>.
+ * <p>The line references of the common drivers are understood: <code>0(123)</code> (NVIDIA), <code>0:123(5)</code>
+ * (Mesa, whose column is kept) and <code>0:123</code> (AMD, ANGLE, Apple). Driver lines start at 1, as module lines
+ * in the rewritten log. References to another source string, or to lines which have no module (e.g. the define lines
+ * of a variant), are left as they are.
+ * <p>All the references of a log are collected in a single pass, sorted, then mapped by a single sweep over the source
+ * blocks of the graph, instead of a lookup per reference.
+ * <p>The rewriter only reads the graph, which must outlive it and must not be modified while it is in use: logs can be
+ * rewritten concurrently, e.g. by passing a {@link ThreadPool} to {@link #rewriteAll()}.
+ */
+class GLSLASSEMBLER_API InfoLogRewriter {
+public:
+    /**
+     * A line reference found in an info log.
+     */
+    struct GLSLASSEMBLER_API Reference {
+        /**
+         * Offset of the reference in the log.
+         */
+        std::size_t offset = 0;
+
+        /**
+         * Length of the reference in the log (e.g. 6 for <code>0(123)</code>, 5 for the <code>0:123</code> part of
+         * <code>0:123(5)</code>).
+         */
+        std::size_t length = 0;
+
+        /**
+         * The referenced line of the compiled source, i.e. the assembled source or the variant source (zero-based).
+         */
+        int line = -1;
+
+        /**
+         * The module of the line, or null if the line has no module.
+         */
+        Module *module = nullptr;
+
+        /**
+         * The line in the module (zero-based), or -1 if the line has no module.
+         */
+        int moduleLine = -1;
+    };
+
+private:
+    /**
+     * The graph (not owned).
+     */
+    const ModuleGraph &moduleGraph;
+
+    /**
+     * Index of the source string of the assembled source (as passed to glShaderSource).
+     */
+    int sourceString = 0;
+
+public:
+    /**
+     * @param moduleGraph the loaded graph (not owned, must outlive the rewriter).
+     */
+    explicit InfoLogRewriter(const ModuleGraph &moduleGraph);
+
+    /**
+     * Finds and maps the line references of a log.
+     * @param infoLog the info log
+     * @param references will contain the references referring to the source string, in the order of the log
+     * @param variant the variant the shader has been compiled from (can be nullptr, for the source of the graph). Its
+     * graph must be the one of the rewriter.
+     * @return the number of references mapped to a module
+     * @throws std::runtime_error if the variant has been assembled from another graph
+     */
+    int findReferences(StringView infoLog, std::vector<Reference> &references, const VariantAssembler::Variant *variant = nullptr) const;
+
+    /**
+     * Rewrites the line references of a log into <code>module:line</code> references.
+     * @param infoLog the info log
+     * @param variant the variant the shader has been compiled from (can be nullptr, for the source of the graph). Its
+     * graph must be the one of the rewriter.
+     * @return the rewritten log
+     * @throws std::runtime_error if the variant has been assembled from another graph
+     */
+    std::string rewrite(StringView infoLog, const VariantAssembler::Variant *variant = nullptr) const;
+
+    /**
+     * Rewrites the logs of many variants, in parallel if a thread pool is given.
+     * @param infoLogs the info log of each variant
+     * @param variants the variants, in the same order as infoLogs (see {@link VariantAssembler::assembleAll()})
+     * @param threadPool the thread pool (can be nullptr, to rewrite the logs on the calling thread)
+     * @return the rewritten logs, in the same order as infoLogs
+     * @throws std::runtime_error if there is not a variant for each log, or if a variant has been assembled from
+     * another graph
+     */
+    std::vector<std::string> rewriteAll(const std::vector<std::string> &infoLogs, const std::vector<VariantAssembler::Variant> &variants, ThreadPool *threadPool = nullptr) const;
+
+    /**
+     * Sets the index of the source string of the assembled source, when the shader is compiled from many strings
+     * (references to other strings are not rewritten). Defaults to 0.
+     * @param sourceString the index of the source string
+     */
+    void setSourceString(const int sourceString) { this->sourceString = sourceString; }
+
+    /**
+     * @return the index of the source string of the assembled source.
+     */
+    int getSourceString() const { return sourceString; }
+
+    /**
+     * @return the graph.
+     */
+    const ModuleGraph &getModuleGraph() const { return moduleGraph; }
+};
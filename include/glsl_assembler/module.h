@@ -1,10 +1,17 @@
 #pragma once
 #include <glsl_assembler/conf.h>
+#include <glsl_assembler/arena.h>
+#include <glsl_assembler/module_registry.h>
+#include <glsl_assembler/parsed_module.h>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 /**
- * A module represents a single GLSL file. Modules are linked to each other through one ore more {@link Dependency}.
+ * <p>A module represents a single GLSL file inside a {@link ModuleGraph}. Modules are linked to each other through one ore more {@link Dependency}.
+ * <p>The parse result (source lines, include directives and hoisted lines) is held by an immutable {@link ParsedModule},
+ * which can be shared by the modules of different graphs. A Module only holds the state specific to its graph.
  */
 class GLSLASSEMBLER_API Module {
 public:
@@ -32,23 +39,23 @@ public:
      * A dependency to another module.
      */
     struct GLSLASSEMBLER_API Dependency {
-        enum class Type {
-            /**
-             * The dependency's moduleId is relative to the includeDir of {@link ModuleGraph}.
-             */
-            ABSOLUTE,
-
-            /**
-             * The dependency's moduleId is relative to the moduleId
-             */
-            RELATIVE
-        };
+        /**
+         * ABSOLUTE dependencies are relative to the includeDir of {@link ModuleGraph}, RELATIVE ones to the moduleId.
+         */
+        typedef ParsedModule::Include::Type Type;
 
         /**
          * Reference to the module. This field is populated by {@link ModuleGraph}.
          */
         Module *module = nullptr;
 
+        /**
+         * Handle of the module in the {@link ModuleRegistry} of the owning {@link ModuleGraph}.
+         * Two resolved dependencies refer to the same module if and only if their handles are equal.
+         * This field is populated by {@link ModuleGraph}.
+         */
+        ModuleRegistry::Handle moduleHandle = ModuleRegistry::INVALID_HANDLE;
+
         /**
          * The unique identifier of the module, i.e. its full pathname.
          */
@@ -102,39 +109,34 @@ public:
      * Some GLSL directives (like version and precision) must appear at the start of the file.
      * These lines are "hoisted" during the import process.
      */
-    struct GLSLASSEMBLER_API HoistedLine {
-        /**
-         * Original line (hoisted lines become commented)
-         */
-        std::string line;
+    typedef ParsedModule::HoistedLine HoistedLine;
 
-        /**
-         * Line index (zero-based)
-         */
-        int index;
-    };
+    /**
+     * The dependency records, allocated in the arena of the module (if any).
+     */
+    typedef std::vector<Dependency, ArenaAllocator<Dependency>> Dependencies;
 
 private:
     /**
-     * The unique identifier of the module, i.e. its full pathname.
+     * The parse result (shared, immutable).
      */
-    std::string id;
+    std::shared_ptr<const ParsedModule> parsedModule;
 
     /**
-     * Lines of the module that need to be hoisted.
+     * Dependencies of the module, initially populated from the include directives of the parsed module, and further
+     * refined by {@link ModuleGraph}.
      */
-    std::vector<HoistedLine> hoistLines;
+    Dependencies dependencies;
 
     /**
-     * Source lines of the module.
+     * Version stamp supplied by the {@link ModuleLoader} (only meaningful if hasVersion is true).
      */
-    std::vector<std::string> sourceLines;
+    std::uint64_t version = 0;
 
     /**
-     * Dependencies of the module, initially populated by {@link #analyzeDependencies()}, and further refined
-     * by {@link ModuleGraph}.
+     * Whether the module has a version stamp.
      */
-    std::vector<Dependency> dependencies;
+    bool hasVersion = false;
 
     /**
      * Mark used for topological sort.
@@ -142,46 +144,55 @@ private:
     Mark mark = Mark::UNMARKED;
 
     /**
-     * Populates the dependencies vector (without instancing other Modules)
+     * A module must be instantiated through {@link #fromSource()} or {@link #fromParsedModule()} methods.
+     * @param arena the arena of the dependency records (can be nullptr, to use the heap)
      */
-    void analyzeDependencies();
+    explicit Module(Arena *arena);
 
+public:
     /**
-     * A module must be instantiated through {@link #fromSource()} method.
+     * Creates a module with the given id and source.
+     * Include directives and hoist directives are processed.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @return the built Module instance
      */
-    Module();
+    static Module *fromSource(const std::string &id, const std::string &source);
 
     /**
-     * Comments a module line.
-     * Includes and hoisted lines are commented instead of removed, to simplify the mapping between the
-     * assembled source and the individual modules.
-     * @param index the line index to comment (zero-based)
+     * Creates a module from a parse result.
+     * @param parsedModule the parse result (cannot be nullptr)
+     * @return the built Module instance
      */
-    void commentLine(int index);
+    static Module *fromParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule);
 
     /**
-     * Some GLSL directives must appear at the top of the file, so they must be "hoisted".
-     * Hoisted lines are also commented.
-     * @param index the line index to comment (zero-based)
+     * Creates a module from a parse result, in an arena: the module and its dependency records are allocated in the
+     * arena. The module must not be deleted: its destructor must be called explicitly before the arena is released.
+     * @param parsedModule the parse result (cannot be nullptr)
+     * @param arena the arena, which must outlive the module
+     * @return the built Module instance
      */
-    void hoistLine(int index);
+    static Module *fromParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule, Arena &arena);
 
-public:
     /**
-     * Creates a module with the given id and source.
-     * Include directives and hoist directives are processed.
-     * @param id the unique id of the module
-     * @param source the source code of the module
-     * @return the built Module instance
+     * Replaces the parse result of the module. The dependencies are built again from the new include directives,
+     * so they need to be resolved again by {@link ModuleGraph}. The version stamp is cleared.
+     * @param parsedModule the new parse result (cannot be nullptr), which must have the same id
      */
-    static Module *fromSource(const std::string &id, const std::string &source);
+    void setParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule);
+
+    /**
+     * @return the parse result of the module.
+     */
+    const std::shared_ptr<const ParsedModule> &getParsedModule() const { return parsedModule; }
 
     /**
      * Checks whether the module has no source lines
      * @return true if the modules has no source lines.
      */
     bool isEmpty() const {
-        return sourceLines.empty();
+        return parsedModule->getSourceLinesCount() == 0;
     }
 
     /**
@@ -189,19 +200,19 @@ public:
      * by an empty line is injected.
      * @param lines the vector where to inject the module.
      */
-    void inject(std::vector<std::string> &lines) const;
+    void inject(std::vector<std::string> &lines) const { parsedModule->inject(lines); }
 
     /**
      * Begin iterator over the dependencies.
      * @return the iterator begin
      */
-    std::vector<Dependency>::iterator begin() { return dependencies.begin(); }
+    Dependencies::iterator begin() { return dependencies.begin(); }
 
     /**
      * End iterator over the dependencies.
      * @return the iterator begin
      */
-    std::vector<Dependency>::iterator end() { return dependencies.end(); }
+    Dependencies::iterator end() { return dependencies.end(); }
 
     /**
      * Sets a mark for the node. Used by {@link ModuleGraph} for topological sorting.
@@ -209,21 +220,48 @@ public:
      */
     void setMark(Mark mark) { this->mark = mark; }
 
+    /**
+     * Sets the version stamp supplied by the {@link ModuleLoader}. Used by {@link ModuleGraph} for incremental reloading.
+     * @param version the version stamp
+     */
+    void setVersion(const std::uint64_t version) { this->version = version; hasVersion = true; }
+
+    /**
+     * Checks whether the module version stamp matches a given one.
+     * @param version the version stamp to check
+     * @return true if the module has a version stamp equal to the given one
+     */
+    bool isVersion(const std::uint64_t version) const { return hasVersion && this->version == version; }
+
+    /**
+     * @param version will contain the version stamp, if any
+     * @return true if the module has a version stamp
+     */
+    bool getVersion(std::uint64_t &version) const {
+        version = this->version;
+        return hasVersion;
+    }
+
+    /**
+     * @return the content hash of the module source (see {@link Hash::xxh64()}), computed when the module is parsed.
+     */
+    std::uint64_t getSourceHash() const { return parsedModule->getSourceHash(); }
+
     /**
      * @return the module id, i.e. its full path.
      */
-    const std::string &getId() const { return id; }
+    const std::string &getId() const { return parsedModule->getId(); }
 
     /**
      * @param index the index of hoisted line
      * @return the index-th hoisted line
      */
-    const HoistedLine &getHoistedLine(int index) const { return hoistLines.at(index); }
+    const HoistedLine &getHoistedLine(int index) const { return parsedModule->getHoistedLine(index); }
 
     /**
      * @return the number of hoisted lines.
      */
-    int getHoistedLinesCount() const { return hoistLines.size(); }
+    int getHoistedLinesCount() const { return parsedModule->getHoistedLinesCount(); }
 
     /**
      * @return the number of dependencies of the module.
@@ -245,13 +283,13 @@ public:
     /**
      * @return the number of source lines
      */
-    int getSourceLinesCount() const { return sourceLines.size(); }
+    int getSourceLinesCount() const { return parsedModule->getSourceLinesCount(); }
 
     /**
      * @param index the source line (zero-based)
      * @return the index-th source line
      */
-    const std::string &getSourceLine(const int index) const { return sourceLines.at(index); }
+    StringView getSourceLine(const int index) const { return parsedModule->getSourceLine(index); }
 
     /**
      * @return the node mark (used by {@link ModuleGraph})
@@ -0,0 +1,285 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/source_buffer.h>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class AnalysisCache;
+
+/**
+ * <p>Cache of {@link ParsedModule}, which can be shared by many {@link ModuleGraph} (see {@link ModuleGraph::setModuleCache()}).
+ * <p>Parsed modules are keyed by module id and source contents (compared through their hash and size), so each
+ * distinct file is parsed and stored only once. Parsed modules are immutable and reference counted: graphs keep
+ * using them even after they are evicted from the cache.
+ * <p>When the loader provides version stamps (see {@link ModuleLoader::getVersion()}), a module can also be looked up
+ * by id and version stamp, which does not require loading its source at all.
+ * <p>Concurrent requests for the same module (e.g. from graphs loaded on different threads) wait for a single parse.
+ * <p>Only the latest source of each module is kept: when another source of a module is cached (e.g. after the file has
+ * been edited), the previous ones are dropped as soon as no graph uses them anymore (see {@link #purge()}, called by
+ * {@link ModuleGraph} when it releases modules), so that hot reloading does not accumulate every saved version of
+ * every file.
+ * <p>An optional memory budget can be set: when the memory used by the cached modules exceeds it, the least recently
+ * used modules are evicted.
+ * <p>This class is threadsafe.
+ */
+class GLSLASSEMBLER_API ModuleCache {
+public:
+    /**
+     * Cache statistics.
+     */
+    struct GLSLASSEMBLER_API Statistics {
+        /**
+         * Number of lookups satisfied by the cache.
+         */
+        std::size_t hits = 0;
+
+        /**
+         * Number of lookups that required parsing a module.
+         */
+        std::size_t misses = 0;
+
+        /**
+         * Number of modules evicted because of the memory budget.
+         */
+        std::size_t evictions = 0;
+
+        /**
+         * Number of modules dropped because another source of the same module has been cached since.
+         */
+        std::size_t superseded = 0;
+    };
+
+private:
+    struct Entry {
+        /**
+         * The cached parse result.
+         */
+        std::shared_ptr<const ParsedModule> module;
+
+        /**
+         * Version stamp of the module (only meaningful if hasVersion is true).
+         */
+        std::uint64_t version = 0;
+
+        /**
+         * Whether the entry has a version stamp.
+         */
+        bool hasVersion = false;
+
+        /**
+         * Memory used by the module (see {@link ParsedModule::getMemoryUsage()}).
+         */
+        std::size_t memoryUsage = 0;
+
+        /**
+         * Whether another source of the module has been used since, while this one was still used (the entry is then
+         * listed in supersededEntries, until {@link #purge()} drops it).
+         */
+        bool superseded = false;
+    };
+
+    typedef std::list<Entry>::iterator EntryIterator;
+
+    /**
+     * Cached entries, from the most recently used to the least recently used.
+     */
+    std::list<Entry> entries;
+
+    /**
+     * Superseded entries still used by some graph, dropped by {@link #purge()} once they are not used anymore.
+     */
+    std::vector<EntryIterator> supersededEntries;
+
+    /**
+     * Maps module ids to their entries (usually one per id).
+     */
+    std::unordered_map<std::string, std::vector<EntryIterator>> index;
+
+    /**
+     * Key of a module being parsed: id, source hash and source size.
+     */
+    typedef std::tuple<std::string, std::uint64_t, std::size_t> ParsingKey;
+
+    /**
+     * Modules being parsed, so that concurrent requests for the same module wait for a single parse.
+     */
+    std::map<ParsingKey, std::shared_future<std::shared_ptr<const ParsedModule>>> parsing;
+
+    /**
+     * Memory budget (zero means unlimited).
+     */
+    std::size_t memoryBudget;
+
+    /**
+     * Persistent analysis cache used when parsing (not owned, can be nullptr).
+     */
+    AnalysisCache *analysisCache = nullptr;
+
+    /**
+     * Memory used by the cached modules.
+     */
+    std::size_t memoryUsage = 0;
+
+    /**
+     * Cache statistics.
+     */
+    Statistics statistics;
+
+    /**
+     * Guards all the fields.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * Finds the entry of a module with the given id and source hash and size (the mutex must be locked).
+     * @return the entry, or entries.end() if not found
+     */
+    EntryIterator findEntry(const std::string &id, std::uint64_t sourceHash, std::size_t sourceSize);
+
+    /**
+     * Moves an entry at the front of the LRU list (the mutex must be locked).
+     * @param entry the entry to touch
+     */
+    void touch(EntryIterator entry);
+
+    /**
+     * Removes an entry (the mutex must be locked).
+     * @param entry the entry to remove
+     */
+    void remove(EntryIterator entry);
+
+    /**
+     * Makes an entry the latest source of its module: the other entries of the module are superseded, and dropped if
+     * no graph uses them anymore (the mutex must be locked).
+     * @param latest the latest entry of the module
+     */
+    void supersede(EntryIterator latest);
+
+    /**
+     * Evicts the least recently used entries until the memory budget is respected (the mutex must be locked).
+     * The most recently used entry is never evicted.
+     */
+    void evict();
+
+    /**
+     * Implementation of the public acquire methods.
+     */
+    std::shared_ptr<const ParsedModule> acquire(const std::string &id, const SourceBuffer &source, const std::uint64_t *version);
+
+public:
+    /**
+     * @param memoryBudget the memory budget in bytes (zero means unlimited).
+     */
+    explicit ModuleCache(std::size_t memoryBudget = 0);
+
+    ModuleCache(const ModuleCache &) = delete;
+    ModuleCache &operator=(const ModuleCache &) = delete;
+
+    /**
+     * Returns the parsed module for the given id and source. The source is parsed only if it is not cached yet.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @return the parsed module
+     * @throws std::runtime_error if the module cannot be parsed
+     */
+    std::shared_ptr<const ParsedModule> acquire(const std::string &id, const std::string &source);
+
+    /**
+     * Same as {@link #acquire(const std::string &, const std::string &)}, but the version stamp of the source is
+     * recorded as well, so that the module can later be found with {@link #find()}.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @param version the version stamp of the source (see {@link ModuleLoader::getVersion()})
+     * @return the parsed module
+     * @throws std::runtime_error if the module cannot be parsed
+     */
+    std::shared_ptr<const ParsedModule> acquire(const std::string &id, const std::string &source, std::uint64_t version);
+
+    /**
+     * Same as {@link #acquire(const std::string &, const std::string &)}, but the source is not copied: on a miss,
+     * the parsed module keeps the buffer (see {@link ParsedModule::parse()}).
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @return the parsed module
+     * @throws std::runtime_error if the module cannot be parsed
+     */
+    std::shared_ptr<const ParsedModule> acquire(const std::string &id, const SourceBuffer &source);
+
+    /**
+     * Same as {@link #acquire(const std::string &, const SourceBuffer &)}, recording the version stamp of the source.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @param version the version stamp of the source (see {@link ModuleLoader::getVersion()})
+     * @return the parsed module
+     * @throws std::runtime_error if the module cannot be parsed
+     */
+    std::shared_ptr<const ParsedModule> acquire(const std::string &id, const SourceBuffer &source, std::uint64_t version);
+
+    /**
+     * Looks up a module by id and version stamp.
+     * @param id the unique id of the module
+     * @param version the version stamp (see {@link ModuleLoader::getVersion()})
+     * @return the parsed module, or nullptr if it is not cached
+     */
+    std::shared_ptr<const ParsedModule> find(const std::string &id, std::uint64_t version);
+
+    /**
+     * Sets the memory budget, evicting modules if needed.
+     * @param memoryBudget the memory budget in bytes (zero means unlimited).
+     */
+    void setMemoryBudget(std::size_t memoryBudget);
+
+    /**
+     * @return the memory budget in bytes (zero means unlimited).
+     */
+    std::size_t getMemoryBudget() const;
+
+    /**
+     * @return the memory used by the cached modules, in bytes.
+     */
+    std::size_t getMemoryUsage() const;
+
+    /**
+     * @return the number of cached modules.
+     */
+    int size() const;
+
+    /**
+     * @return the cache statistics.
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * Sets the persistent analysis cache used to parse the modules not found in this cache.
+     * @param analysisCache the analysis cache (not owned, can be nullptr).
+     */
+    void setAnalysisCache(AnalysisCache *analysisCache);
+
+    /**
+     * @return the analysis cache (can be nullptr).
+     */
+    AnalysisCache *getAnalysisCache() const;
+
+    /**
+     * Drops the modules superseded by another source of the same module which are not used by any graph anymore.
+     * {@link ModuleGraph} calls it after releasing modules, on {@link ModuleGraph::reload()} and
+     * {@link ModuleGraph::loadModule()}.
+     */
+    void purge();
+
+    /**
+     * Removes all the modules from the cache (modules still used by some graph are not destroyed).
+     */
+    void clear();
+};
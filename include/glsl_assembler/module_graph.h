@@ -1,11 +1,27 @@
 #pragma once
 #include <glsl_assembler/conf.h>
+#include <glsl_assembler/arena.h>
+#include <glsl_assembler/module_registry.h>
+#include <glsl_assembler/path_resolver.h>
+#include <glsl_assembler/source_minifier.h>
+#include <cstdint>
+#include <exception>
+#include <memory>
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 // Forward declarations
+class AnalysisCache;
+class AssemblySink;
+class GraphSnapshot;
 class Module;
+class ModuleCache;
 class ModuleLoader;
+class ParsedModule;
+class Profiler;
+class SourceBuffer;
+class ThreadPool;
 
 /**
  * <p>ModuleGraph is the main interface of GLSLAssembler. It encapsulates all the {@link Module} along with their dependencies.
@@ -81,21 +97,37 @@ public:
          * @return the local line index (zero-based).
          */
         int mapLine(const int assembledLine) const {
-            return assembledLine - assembledRange.begin;
+            return moduleRange.begin + assembledLine - assembledRange.begin;
         }
     };
 
 private:
     /**
-     * Modules are the node of the graph (owned by this class).
+     * Modules are the node of the graph (owned by this class, allocated in the arena), indexed by their handle.
      */
-    std::vector<Module *> modules;
+    ModuleRegistry modules;
+
+    /**
+     * Backs the modules and their dependency records, released at once by {@link #destroy()}. Memory of the modules
+     * removed or replaced by {@link #reload()} is reclaimed by {@link #compact()}.
+     */
+    Arena arena;
 
     /**
      * Topological sort of modules (references). Populated by {@link #buildTopologicalSort()}.
      */
     std::vector<Module *> toposort;
 
+    /**
+     * Id of the root module, i.e. the one passed to {@link #loadModule()}. Used by {@link #reload()}.
+     */
+    std::string rootModuleId;
+
+    /**
+     * Id of the module that could not be loaded or parsed by the last {@link #loadModule()} or {@link #reload()}.
+     */
+    std::string failedModuleId;
+
     /**
      * Include directory (only one is supported). This is used for #include<...> directives
      */
@@ -107,38 +139,194 @@ private:
     ModuleLoader *moduleLoader;
 
     /**
-     * Fully assembled source, with include directives resolved. Populated by {@link #assembleSource()}.
+     * Caches the dependency paths resolved by the module loader, across loads.
+     */
+    PathResolver pathResolver;
+
+    /**
+     * Cache of parsed modules, possibly shared with other graphs (not owned by this class, can be nullptr).
+     */
+    ModuleCache *moduleCache;
+
+    /**
+     * Thread pool used to load modules in parallel (not owned by this class, can be nullptr).
+     */
+    ThreadPool *threadPool;
+
+    /**
+     * Persistent analysis cache (not owned by this class, can be nullptr).
+     */
+    AnalysisCache *analysisCache;
+
+    /**
+     * Instrumentation of the loading phases (not owned by this class, can be nullptr).
+     */
+    Profiler *profiler;
+
+    /**
+     * Fully assembled source, with include directives resolved. Populated by {@link #assembleSource()}, unless
+     * keepAssembledSource is false.
      */
     std::string assembledSource;
 
+    /**
+     * Size (in bytes) of the assembled source. Computed by {@link #assembleSource()}.
+     */
+    std::size_t assembledSourceSize = 0;
+
+    /**
+     * Hash of the assembled program. Computed by {@link #assembleSource()}.
+     */
+    std::uint64_t programHash = 0;
+
+    /**
+     * Number of hoisted lines at the start of the assembled source (one source block each). Computed by
+     * {@link #assembleSource()}.
+     */
+    int hoistedLinesCount = 0;
+
+    /**
+     * Whether {@link #assembleSource()} stores the assembled source (see {@link #setKeepAssembledSource()}).
+     */
+    bool keepAssembledSource = true;
+
+    /**
+     * Whether {@link #assembleSource()} removes the unreferenced declarations (see {@link #setTreeShaking()}).
+     */
+    bool treeShaking = false;
+
+    /**
+     * Whether {@link #assembleSource()} minifies the assembled source (see {@link #setMinify()}).
+     */
+    bool minify = false;
+
     /**
      * Source blocks composing the assembled sources, used for line mapping. Populated by {@link #assembleSource()}.
+     * Blocks are sorted by their assembled range, which allows {@link #mapLine()} to binary search them.
      */
     std::vector<SourceBlock> assembledSourceBlocks;
 
+    /**
+     * Reverse line mapping index: for each module, the indices of its source blocks (in ascending order).
+     * Populated by {@link #assembleSource()}.
+     */
+    std::unordered_map<const Module *, std::vector<int>> moduleSourceBlocks;
+
+    /**
+     * When minifying, the minifier state at the start of each source block (except the hoisted lines), so that
+     * {@link #writeAssembledSource()} can minify the lines again. Populated by {@link #assembleSource()}.
+     */
+    std::vector<SourceMinifier::State> minifiedBlockStates;
+
     /**
      * Frees all the allocated memory
      */
     void destroy();
 
     /**
-     * Builds the topological sort of the modules. An exception is thrown if a cycle is found.
+     * Parses a module source in place, through the module cache if available.
+     * @param id the id of the module
+     * @param source the source of the module, as loaded by {@link ModuleLoader::loadBuffer()}
+     * @param version the version stamp of the source (nullptr if not available)
+     * @return the parsed module
      */
-    void buildTopologicalSort();
+    std::shared_ptr<const ParsedModule> parseModule(const std::string &id, const SourceBuffer &source, const std::uint64_t *version);
+
+    /**
+     * A loaded and parsed module, before the creation of its {@link Module}.
+     */
+    struct LoadedModule {
+        std::shared_ptr<const ParsedModule> parsedModule;
+        std::uint64_t version = 0;
+        bool versioned = false;
+    };
+
+    /**
+     * Loads and parses a module. Threadsafe (if the loader is).
+     * @param id the id of the module
+     * @param loadedModule will contain the parse result and the version stamp
+     */
+    void loadParsedModule(const std::string &id, LoadedModule &loadedModule);
+
+    /**
+     * Creates a module in the arena (the module is not registered).
+     * @param loadedModule the parse result and the version stamp
+     * @return the built module (to be registered or destroyed with {@link #destroyModule()})
+     */
+    Module *createModule(const LoadedModule &loadedModule);
+
+    /**
+     * Loads, parses and creates a module (the module is not registered).
+     * @param id the id of the module
+     * @return the built module (to be registered or destroyed with {@link #destroyModule()})
+     */
+    Module *createModule(const std::string &id);
 
     /**
-     * Helper recursive method for topological sort.
-     * @param module the current module to examine
-     * @param stack the stack of module ids (used to report dependency cycles)
-     * @throws std::runtime_error if a cycle is detected.
+     * Destroys a module created by {@link #createModule()} (its memory is reclaimed with the arena).
+     * @param module the module
      */
-    void buildTopologicalSort(Module *module, std::vector<std::string> &stack);
+    static void destroyModule(Module *module);
+
+    /**
+     * Loads and parses many modules, in parallel if a thread pool is set, then creates them in order (the modules are
+     * not registered). Without a thread pool, modules are loaded in order and loading stops at the first error.
+     * @param ids the ids of the modules to load
+     * @param created will contain the built modules (to be registered or destroyed), nullptr for those that could not
+     * be loaded
+     * @param errors will contain the error of each module that could not be loaded, nullptr for the others
+     */
+    void createModules(const std::vector<std::string> &ids, std::vector<Module *> &created, std::vector<std::exception_ptr> &errors);
+
+    /**
+     * Resolves the dependencies of the given modules, in breadth-first order. Modules which are not part of the graph
+     * are loaded, registered and resolved as well.
+     * @param frontier the modules whose dependencies must be resolved
+     */
+    void resolveDependencies(std::vector<Module *> frontier);
+
+    /**
+     * Deletes the modules which are no longer reachable from the root module, and reassigns the handles.
+     * @param removedModules the ids of the removed modules are appended here
+     */
+    void removeUnreachableModules(std::vector<std::string> &removedModules);
+
+    /**
+     * Builds the topological sort of the modules (iteratively, so the depth of the graph is not limited by the call
+     * stack). An exception is thrown if a cycle is found, describing one cycle per strongly connected component.
+     */
+    void buildTopologicalSort();
 
     /**
      * Assembles the source and computes the source blocks.
      */
     void assembleSource();
 
+    /**
+     * Finds the strongly connected components of the graph which contain a cycle (Tarjan's algorithm).
+     * @param components will contain the components (each sorted by handle), sorted by their first handle
+     */
+    void findCycles(std::vector<std::vector<ModuleRegistry::Handle>> &components) const;
+
+    /**
+     * Finds a shortest cycle through the first module of a component.
+     * @param component the component (sorted by handle, see {@link #findCycles()})
+     * @param cycle will contain the cycle, starting and ending with the first module
+     */
+    void findCycle(const std::vector<ModuleRegistry::Handle> &component, std::vector<ModuleRegistry::Handle> &cycle) const;
+
+    /**
+     * Snapshots store and restore the resolved state of the graph.
+     */
+    friend class GraphSnapshot;
+
+    /**
+     * Reports a dependency cycle, along with one cycle for every other strongly connected component.
+     * @param cycle the cycle found by the topological sort
+     * @throws std::runtime_error always.
+     */
+    [[noreturn]] void throwDependencyCycles(const std::vector<ModuleRegistry::Handle> &cycle) const;
+
 public:
     ModuleGraph();
     ~ModuleGraph();
@@ -155,18 +343,71 @@ public:
 
     /**
      * Builds the module graph starting from a single module.
-     * A module loader must be set before invoking this method.
+     * A module loader must be set before invoking this method. If some module cannot be loaded, or the modules contain
+     * a cycle, an exception is thrown and the graph is left empty.
      * @param modulePath the pathname of the first module to load.
-     * @return the assembled source
+     * @return the assembled source (empty if the assembled source is not kept, see {@link #setKeepAssembledSource()})
      */
     const std::string &loadModule(const std::string &modulePath);
 
+    /**
+     * <p>Reloads the last module loaded by {@link #loadModule()}, processing only the modules that changed.
+     * <p>A module is considered changed if its version stamp (see {@link ModuleLoader::getVersion()}) or, when the loader
+     * does not support version stamps, the hash of its source changed. Only the changed modules are parsed again and
+     * have their dependencies resolved again; the topological sort is rebuilt only if some dependency changed, and the
+     * source is assembled again only if some module changed.
+     * <p>The modules which are not removed keep their address. The memory of the removed modules is not reclaimed
+     * until {@link #compact()} is called (or the graph is loaded again).
+     * <p>If a changed module cannot be loaded or parsed, an exception is thrown and the graph is left untouched.
+     * If the new dependencies cannot be loaded (or contain a cycle) an exception is thrown and the graph is emptied;
+     * a subsequent reload will then load everything from scratch.
+     * @param touchedModules will contain the ids of the modules that were parsed again, added or removed.
+     * @return true if the assembled source has been rebuilt, false if nothing changed.
+     */
+    bool reload(std::vector<std::string> &touchedModules);
+
+    /**
+     * <p>Reclaims the arena memory no longer used (modules removed, and dependency records replaced, by
+     * {@link #reload()}) when it exceeds the memory of the live modules, by creating the modules again in the released
+     * arena. The parse results, the handles, the topological sort and the source blocks are kept: nothing is loaded,
+     * parsed nor assembled again.
+     * <p>Only the addresses of the modules change: when it returns true, the {@link Module} pointers obtained before
+     * (e.g. from {@link #findModule()} or {@link #mapLine()}) must not be used anymore.
+     * @return true if the modules have been moved, false if there was not enough memory to reclaim.
+     */
+    bool compact();
+
+    /**
+     * Writes the loaded graph to a snapshot file (see {@link GraphSnapshot}), which {@link #loadSnapshot()} restores
+     * without loading, parsing nor assembling anything.
+     * @param path the path of the snapshot file
+     * @throws std::runtime_error if no module is loaded, or if the file cannot be written
+     */
+    void saveSnapshot(const std::string &path) const;
+
+    /**
+     * <p>Replaces the graph with the one stored in a snapshot file by {@link #saveSnapshot()}. The file is memory
+     * mapped, and the module sources are used in place.
+     * <p>The tree shaking and minify options are restored as they were when the snapshot was saved. No module loader
+     * is needed, except to {@link #reload()} the graph afterwards.
+     * @param path the path of the snapshot file
+     * @return true if the snapshot has been loaded, false if the file is missing, stale or corrupt (the graph is then
+     * left untouched)
+     */
+    bool loadSnapshot(const std::string &path);
+
     /**
      * @param id the id of the module
      * @return the module having the specified id, or null if it does not exist.
      */
     Module *findModule(const std::string &id);
 
+    /**
+     * @param handle the handle of the module (e.g. {@link Module::Dependency::moduleHandle})
+     * @return the module having the specified handle, or null if the handle is not valid.
+     */
+    Module *getModule(const ModuleRegistry::Handle handle) const { return modules.isValid(handle) ? modules.get(handle) : nullptr; }
+
     /**
      * Given a line in the assembled source, returns the corresponding local line index and module.
      * @param assembledLine the line index in the assembled source (zero-based).
@@ -175,11 +416,28 @@ public:
      */
     Module *mapLine(const int assembledLine, int &moduleLine) const;
 
+    /**
+     * Given a line of a module, returns the corresponding line indices in the assembled source.
+     * A module line can be mapped to more than one assembled line: hoisted lines appear both at the top of the
+     * assembled source and (commented) inside the module.
+     * @param module the module
+     * @param moduleLine the local line index (zero-based).
+     * @param assembledLines will contain the assembled line indices (zero-based), in ascending order.
+     * @return the number of assembled lines found.
+     */
+    int mapModuleLine(const Module *module, const int moduleLine, std::vector<int> &assembledLines) const;
+
     /**
      * @return the number of modules.
      */
     int getModuleCount() const { return modules.size(); }
 
+    /**
+     * @return the number of bytes used by the modules and their dependency records in the arena of the graph,
+     * including the memory not reclaimed yet after a {@link #reload()} (see {@link #compact()}).
+     */
+    std::size_t getArenaSize() const { return arena.getAllocatedSize(); }
+
     /**
      * @return the module loader.
      */
@@ -197,10 +455,87 @@ public:
     const std::string &getIncludeDir() const { return includeDir; }
 
     /**
-     * @return the assembled source.
+     * @return the id of the module that could not be loaded or parsed by the last {@link #loadModule()} or
+     * {@link #reload()} (e.g. a missing include), or an empty string if it succeeded or failed for another reason.
+     */
+    const std::string &getFailedModuleId() const { return failedModuleId; }
+
+    /**
+     * @return the assembled source (empty if the assembled source is not kept, see {@link #setKeepAssembledSource()}).
      */
     const std::string &getAssembledSource() const { return assembledSource; }
 
+    /**
+     * <p>Returns a hash identifying the assembled source, derived from the topological sort of the modules and from
+     * their ids and content hashes (see {@link Module::getSourceHash()}), without hashing the assembled source itself.
+     * <p>Graphs with the same hash have the same assembled source, so the hash can key a cache of compiled programs,
+     * which can be checked before the source is written (see {@link #setKeepAssembledSource()}).
+     * @return the program hash (zero if no module is loaded).
+     */
+    std::uint64_t getProgramHash() const { return programHash; }
+
+    /**
+     * @return the size (in bytes) of the assembled source, even if it is not kept.
+     */
+    std::size_t getAssembledSourceSize() const { return assembledSourceSize; }
+
+    /**
+     * @return the number of hoisted lines (<code>#version</code>, <code>precision</code>...) at the start of the
+     * assembled source, i.e. the index of the first line after them.
+     */
+    int getHoistedLinesCount() const { return hoistedLinesCount; }
+
+    /**
+     * <p>Writes the assembled source straight from the modules to a sink, without intermediate copies.
+     * <p>The total size is passed to {@link AssemblySink::reserve()} first, then the source is written in chunks.
+     * The output is the same as {@link #getAssembledSource()}.
+     * @param sink the destination of the assembled source
+     */
+    void writeAssembledSource(AssemblySink &sink) const;
+
+    /**
+     * <p>Sets whether the assembled source is stored in the graph (the default).
+     * <p>When disabled, {@link #loadModule()} and {@link #reload()} only compute the source blocks, and the assembled
+     * source must be retrieved with {@link #writeAssembledSource()}: this avoids keeping a copy of the whole source.
+     * @param keepAssembledSource true to store the assembled source.
+     */
+    void setKeepAssembledSource(const bool keepAssembledSource) { this->keepAssembledSource = keepAssembledSource; }
+
+    /**
+     * @return true if the assembled source is stored in the graph.
+     */
+    bool isKeepAssembledSource() const { return keepAssembledSource; }
+
+    /**
+     * <p>Sets whether the declarations not referenced by the program are removed from the assembled source (disabled
+     * by default). Functions, structs and constants which cannot be reached from <code>main()</code> and from the
+     * other global declarations are dropped (see {@link TreeShaker}); the source blocks only map the lines kept.
+     * <p>The option takes effect when the source is assembled again (e.g. by {@link #loadModule()}), and changes the
+     * program hash.
+     * @param treeShaking true to remove the unreferenced declarations.
+     */
+    void setTreeShaking(const bool treeShaking) { this->treeShaking = treeShaking; }
+
+    /**
+     * @return true if the unreferenced declarations are removed from the assembled source.
+     */
+    bool isTreeShaking() const { return treeShaking; }
+
+    /**
+     * <p>Sets whether the assembled source is minified (disabled by default): comments, blank lines, the module
+     * preambles and redundant whitespace are removed (see {@link SourceMinifier}).
+     * <p>Lines are never joined, so the source blocks map each minified line to its module line.
+     * <p>The option takes effect when the source is assembled again (e.g. by {@link #loadModule()}), and changes the
+     * program hash.
+     * @param minify true to minify the assembled source.
+     */
+    void setMinify(const bool minify) { this->minify = minify; }
+
+    /**
+     * @return true if the assembled source is minified.
+     */
+    bool isMinify() const { return minify; }
+
     /**
      * @return the number of source blocks into the assembled sources.
      */
@@ -212,11 +547,71 @@ public:
      */
     const SourceBlock &getSourceBlock(const int index) const { return assembledSourceBlocks.at(index); }
 
+    /**
+     * @return the cache of the dependency paths (see {@link PathResolver}).
+     */
+    const PathResolver &getPathResolver() const { return pathResolver; }
+
     /**
      * Sets the module loader. This is mandatory before using {@link #loadModule()}.
      * @param moduleLoader the module loader instance (cannot be nullptr).
      */
-    void setModuleLoader(ModuleLoader *moduleLoader) { this->moduleLoader = moduleLoader; }
+    void setModuleLoader(ModuleLoader *moduleLoader) {
+        this->moduleLoader = moduleLoader;
+        pathResolver.setModuleLoader(moduleLoader);
+    }
+
+    /**
+     * Sets the cache of parsed modules. The same cache can be shared by many graphs, so that modules included by
+     * many of them are parsed and stored only once. By default no cache is used.
+     * @param moduleCache the module cache instance (not owned, can be nullptr).
+     */
+    void setModuleCache(ModuleCache *moduleCache) { this->moduleCache = moduleCache; }
+
+    /**
+     * @return the module cache (can be nullptr).
+     */
+    ModuleCache *getModuleCache() const { return moduleCache; }
+
+    /**
+     * Sets the persistent analysis cache, so that the directive analysis of unchanged modules is skipped.
+     * <p>When a module cache is set, the analysis cache of the module cache is used instead
+     * (see {@link ModuleCache::setAnalysisCache()}).
+     * @param analysisCache the analysis cache (not owned, can be nullptr).
+     */
+    void setAnalysisCache(AnalysisCache *analysisCache) { this->analysisCache = analysisCache; }
+
+    /**
+     * @return the analysis cache (can be nullptr).
+     */
+    AnalysisCache *getAnalysisCache() const { return analysisCache; }
+
+    /**
+     * Enables the instrumentation of {@link #loadModule()} and {@link #reload()}: phase times, counters and events
+     * are recorded in the profiler. The profiler can be shared with other graphs.
+     * @param profiler the profiler (not owned, can be nullptr to disable the instrumentation).
+     */
+    void setProfiler(Profiler *profiler) { this->profiler = profiler; }
+
+    /**
+     * @return the profiler (can be nullptr).
+     */
+    Profiler *getProfiler() const { return profiler; }
+
+    /**
+     * <p>Enables parallel loading. Modules are discovered one breadth-first level at a time: the new modules of a level
+     * are loaded and parsed concurrently on the thread pool, then registered in discovery order, so the modules,
+     * their topological sort and the assembled source are the same as with serial loading.
+     * <p>The module loader (and the module cache, if any) are then used from many threads at the same time, so they
+     * must be threadsafe. By default modules are loaded serially.
+     * @param threadPool the thread pool (not owned, can be nullptr to load serially).
+     */
+    void setThreadPool(ThreadPool *threadPool) { this->threadPool = threadPool; }
+
+    /**
+     * @return the thread pool used for parallel loading (can be nullptr).
+     */
+    ThreadPool *getThreadPool() const { return threadPool; }
 
     /**
      * Sets the include base path, which is used to resolve #include <...> directives
@@ -1,5 +1,7 @@
 #pragma once
 #include <glsl_assembler/conf.h>
+#include <glsl_assembler/source_buffer.h>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -7,6 +9,7 @@
  * ModuleLoader is used by {@link ModuleGraph} to resolve paths and to actually load modules.
  * <p>Different implementations can load, for example, from disk or from memory.
  * <p>A basic (partial) implementation is provided by {@link SimpleModuleLoader}.
+ * <p>Sources can use either \\n or \\r\\n as newline: carriage returns are dropped when the lines are split.
  */
 class ModuleLoader {
 public:
@@ -15,7 +18,6 @@ public:
 
     /**
      * Loads the GLSL file located at path.
-     * Note: the returned string <strong>MUST</strong> use \\n as newline character.
      *
      * @param path the path of the resource to load.
      * @return the GLSL file contents.
@@ -23,6 +25,34 @@ public:
      */
     virtual std::string load(const std::string &path) = 0;
 
+    /**
+     * Loads the GLSL file located at path into a buffer, which is parsed in place by {@link ModuleGraph}.
+     * <p>The default implementation wraps the string returned by {@link #load()}. Loaders which already hold the
+     * contents in memory (a memory mapping, a slice of a pack file, an embedded resource...) should return a buffer
+     * referring to it, so that the contents are never copied.
+     *
+     * @param path the path of the resource to load.
+     * @return the GLSL file contents.
+     * @throws std::runtime_error if the resource cannot be loaded.
+     */
+    virtual SourceBuffer loadBuffer(const std::string &path) {
+        return SourceBuffer::fromString(load(path));
+    }
+
+    /**
+     * Returns a version stamp of the GLSL file located at path (for example its modification time, or a revision number).
+     * <p>The stamp must change whenever the file contents change. It is used by {@link ModuleGraph::reload()} to skip
+     * loading unchanged modules. Loaders that do not support version stamps return false (the default), in which case
+     * modules are loaded again and their contents hash is compared.
+     *
+     * @param path the path of the resource.
+     * @param version will contain the version stamp.
+     * @return true if the version stamp is supported, false otherwise.
+     */
+    virtual bool getVersion(const std::string &path, std::uint64_t &version) {
+        return false;
+    }
+
     /**
      * @param pathString the path string to check
      * @return true if the string is only a path, without filename
@@ -0,0 +1,86 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class Module;
+
+/**
+ * <p>Registry of the modules of a {@link ModuleGraph}.
+ * <p>Module ids are interned: an id is hashed only when it is looked up by name, and the module is then referred to
+ * by a compact integer handle. Handles are assigned in registration order, starting from zero, so they can be used
+ * directly as indices for per-module bookkeeping.
+ * <p>Modules are not owned by the registry.
+ */
+class GLSLASSEMBLER_API ModuleRegistry {
+public:
+    /**
+     * Handle of a registered module.
+     */
+    typedef int Handle;
+
+    /**
+     * Value of an invalid (or not yet resolved) handle.
+     */
+    static const Handle INVALID_HANDLE = -1;
+
+private:
+    /**
+     * Maps the module ids to their handles.
+     */
+    std::unordered_map<std::string, Handle> handles;
+
+    /**
+     * Registered modules, indexed by handle.
+     */
+    std::vector<Module *> modules;
+
+public:
+    /**
+     * Registers a module. The id must not be registered yet.
+     * @param module the module to register (cannot be nullptr)
+     * @return the handle assigned to the module
+     * @throws std::runtime_error if a module with the same id is already registered
+     */
+    Handle add(Module *module);
+
+    /**
+     * @param id the id of the module
+     * @return the handle of the module, or INVALID_HANDLE if no module with such id is registered.
+     */
+    Handle find(const std::string &id) const;
+
+    /**
+     * @param handle a valid handle
+     * @return the module having the specified handle
+     */
+    Module *get(const Handle handle) const { return modules[handle]; }
+
+    /**
+     * @param handle the handle to check
+     * @return true if the handle refers to a registered module
+     */
+    bool isValid(const Handle handle) const { return handle >= 0 && handle < static_cast<Handle>(modules.size()); }
+
+    /**
+     * Removes all the modules from the registry (modules are not deleted).
+     */
+    void clear();
+
+    /**
+     * @return the number of registered modules.
+     */
+    int size() const { return modules.size(); }
+
+    /**
+     * @return Begin iterator over the modules, in registration order.
+     */
+    std::vector<Module *>::const_iterator begin() const { return modules.begin(); }
+
+    /**
+     * @return End iterator over the modules, in registration order.
+     */
+    std::vector<Module *>::const_iterator end() const { return modules.end(); }
+};
@@ -0,0 +1,263 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/source_buffer.h>
+#include <glsl_assembler/string_view.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class AnalysisCache;
+class GraphSnapshot;
+
+/**
+ * <p>The result of parsing a single GLSL file: its (processed) source lines, its include directives and its hoisted lines.
+ * <p>A ParsedModule is immutable once built, so it can be shared (see {@link ModuleCache}) by many {@link Module},
+ * which hold the state specific to a {@link ModuleGraph} (resolved dependencies, marks).
+ * <p>The source is parsed in place: the module keeps the {@link SourceBuffer} it has been parsed from, and its lines
+ * refer to it, except the commented ones.
+ */
+class GLSLASSEMBLER_API ParsedModule {
+public:
+    /**
+     * An include directive found in the module source.
+     */
+    struct GLSLASSEMBLER_API Include {
+        enum class Type {
+            /**
+             * The path is relative to the includeDir of {@link ModuleGraph}.
+             */
+            ABSOLUTE,
+
+            /**
+             * The path is relative to the including module
+             */
+            RELATIVE
+        };
+
+        /**
+         * The path, as written in the include directive.
+         */
+        std::string path;
+
+        /**
+         * Line (zero-based) in the module source which contains the include directive.
+         */
+        int line = -1;
+
+        /**
+         * Type of include. Include directives with angular brackets are ABSOLUTE, while quotes are RELATIVE.
+         */
+        Type type;
+    };
+
+    /**
+     * Some GLSL directives (like version and precision) must appear at the start of the file.
+     * These lines are "hoisted" during the import process.
+     */
+    struct GLSLASSEMBLER_API HoistedLine {
+        /**
+         * Original line (hoisted lines become commented)
+         */
+        std::string line;
+
+        /**
+         * Line index (zero-based)
+         */
+        int index;
+    };
+
+private:
+    /**
+     * Location of a source line: an offset in the source buffer, or (past its end) in the commented text.
+     */
+    struct Line {
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    /**
+     * The unique identifier of the module, i.e. its full pathname.
+     */
+    std::string id;
+
+    /**
+     * Hash of the source the module has been parsed from (see {@link Hash::xxh64()}).
+     */
+    std::uint64_t sourceHash = 0;
+
+    /**
+     * Size of the source the module has been parsed from.
+     */
+    std::size_t sourceSize = 0;
+
+    /**
+     * Lines of the module that need to be hoisted.
+     */
+    std::vector<HoistedLine> hoistLines;
+
+    /**
+     * The source as loaded (shared with the loader, never copied).
+     */
+    SourceBuffer source;
+
+    /**
+     * <p>The commented versions of the include and hoisted lines.
+     * <p>Keeping all these lines in a single buffer avoids one allocation per line.
+     */
+    std::string commentedText;
+
+    /**
+     * Source lines of the module (without the newline, and without the carriage return of \\r\\n newlines), as
+     * spans of the source or of the commented text.
+     */
+    std::vector<Line> sourceLines;
+
+    /**
+     * Include directives of the module, populated by {@link #analyzeDependencies()}.
+     */
+    std::vector<Include> includes;
+
+    /**
+     * A parsed module must be instantiated through {@link #parse()} method.
+     */
+    ParsedModule();
+
+    /**
+     * Snapshots store and restore the parse results as they are, without parsing again.
+     */
+    friend class GraphSnapshot;
+
+    /**
+     * Populates the sourceLines vector from the source buffer.
+     */
+    void splitLines();
+
+    /**
+     * Populates the includes vector and hoists the lines which need it.
+     */
+    void analyzeDependencies();
+
+    /**
+     * Same as {@link #analyzeDependencies()}, but using the results of a previous analysis of the same source.
+     * @return false if the analysis does not fit the source (nothing is changed then)
+     */
+    bool applyAnalysis(const std::vector<Include> &cachedIncludes, const std::vector<int> &cachedHoistedLines);
+
+    /**
+     * Comments a module line: the commented line is appended to the commented text, and the line span is moved there.
+     * Includes and hoisted lines are commented instead of removed, to simplify the mapping between the
+     * assembled source and the individual modules.
+     * @param index the line index to comment (zero-based)
+     */
+    void commentLine(int index);
+
+    /**
+     * Some GLSL directives must appear at the top of the file, so they must be "hoisted".
+     * Hoisted lines are also commented.
+     * @param index the line index to comment (zero-based)
+     */
+    void hoistLine(int index);
+
+public:
+    /**
+     * Parses a module with the given id and source.
+     * Include directives and hoist directives are processed.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @return the parsed module
+     * @throws std::runtime_error if an include directive is not valid
+     */
+    static std::shared_ptr<const ParsedModule> parse(const std::string &id, const std::string &source);
+
+    /**
+     * Same as {@link #parse(const std::string &, const std::string &)}, but the directive analysis is looked up in
+     * (and, on a miss, stored into) an analysis cache.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @param analysisCache the analysis cache (can be nullptr)
+     * @return the parsed module
+     * @throws std::runtime_error if an include directive is not valid
+     */
+    static std::shared_ptr<const ParsedModule> parse(const std::string &id, const std::string &source, AnalysisCache *analysisCache);
+
+    /**
+     * Same as {@link #parse(const std::string &, const std::string &, AnalysisCache *)}, but the source is not copied:
+     * the parsed module keeps the buffer, and its lines refer to it.
+     * @param id the unique id of the module
+     * @param source the source code of the module
+     * @param analysisCache the analysis cache (can be nullptr)
+     * @return the parsed module
+     * @throws std::runtime_error if an include directive is not valid
+     */
+    static std::shared_ptr<const ParsedModule> parse(const std::string &id, const SourceBuffer &source, AnalysisCache *analysisCache);
+
+    /**
+     * @return the module id, i.e. its full path.
+     */
+    const std::string &getId() const { return id; }
+
+    /**
+     * @return the hash of the module source.
+     */
+    std::uint64_t getSourceHash() const { return sourceHash; }
+
+    /**
+     * @return the size (in bytes) of the module source.
+     */
+    std::size_t getSourceSize() const { return sourceSize; }
+
+    /**
+     * @return an estimate of the memory (in bytes) used by the parsed module.
+     */
+    std::size_t getMemoryUsage() const;
+
+    /**
+     * @return the number of include directives.
+     */
+    int getIncludeCount() const { return includes.size(); }
+
+    /**
+     * @param index the index of the include directive
+     * @return the index-th include directive
+     */
+    const Include &getInclude(const int index) const { return includes.at(index); }
+
+    /**
+     * @param index the index of hoisted line
+     * @return the index-th hoisted line
+     */
+    const HoistedLine &getHoistedLine(int index) const { return hoistLines.at(index); }
+
+    /**
+     * @return the number of hoisted lines.
+     */
+    int getHoistedLinesCount() const { return hoistLines.size(); }
+
+    /**
+     * @return the number of source lines
+     */
+    int getSourceLinesCount() const { return sourceLines.size(); }
+
+    /**
+     * @param index the source line (zero-based)
+     * @return the index-th source line (without the newline), valid as long as the parsed module exists
+     */
+    StringView getSourceLine(const int index) const {
+        const Line &line = sourceLines.at(index);
+        if (line.offset < source.size()) {
+            return StringView(source.data() + line.offset, line.length);
+        }
+
+        return StringView(commentedText.data() + (line.offset - source.size()), line.length);
+    }
+
+    /**
+     * Injects the module's source code into a vector. A comment preamble followed by the module source followed
+     * by an empty line is injected.
+     * @param lines the vector where to inject the module.
+     */
+    void inject(std::vector<std::string> &lines) const;
+};
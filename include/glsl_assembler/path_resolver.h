@@ -0,0 +1,113 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// Forward declarations
+class ModuleLoader;
+
+/**
+ * <p>Caches the path operations of a {@link ModuleLoader}, which {@link ModuleGraph} performs for every dependency:
+ * {@link ModuleLoader::extractPath()} on the including module, and {@link ModuleLoader::join()} of the directory with
+ * the include path.
+ * <p>Results are keyed by (directory, include path), and the resolved paths are interned: the same include, repeated
+ * by many modules of the same directory, is resolved once, and then costs two hash lookups without any allocation.
+ * <p>The loader path operations must be pure (same arguments, same result). Changing the loader clears the cache.
+ * <p>This class is <strong>NOT</strong> threadsafe.
+ */
+class GLSLASSEMBLER_API PathResolver {
+private:
+    /**
+     * The loader performing the actual path operations (not owned).
+     */
+    ModuleLoader *moduleLoader;
+
+    /**
+     * Interned paths (the elements of an unordered set are never moved).
+     */
+    std::unordered_set<std::string> paths;
+
+    /**
+     * Joined paths, by directory and path name.
+     */
+    std::unordered_map<std::string, std::unordered_map<std::string, const std::string *>> joinedPaths;
+
+    /**
+     * Directories, by path name.
+     */
+    std::unordered_map<std::string, const std::string *> directories;
+
+    /**
+     * Number of cached results returned.
+     */
+    std::size_t hits = 0;
+
+    /**
+     * Number of results computed by the loader.
+     */
+    std::size_t misses = 0;
+
+    /**
+     * @param path a path
+     * @return the interned copy of the path
+     */
+    const std::string *intern(const std::string &path);
+
+public:
+    /**
+     * @param moduleLoader the loader performing the path operations (not owned, can be nullptr).
+     */
+    explicit PathResolver(ModuleLoader *moduleLoader = nullptr);
+
+    PathResolver(const PathResolver &) = delete;
+    PathResolver &operator=(const PathResolver &) = delete;
+
+    /**
+     * Same as {@link ModuleLoader::join()}, cached.
+     * @param path the base path (never includes a filename)
+     * @param pathName a path name, which can include special ".." and "." symbols
+     * @return the joined path, valid until the cache is cleared
+     * @throws std::runtime_error if the loader cannot join the paths (errors are not cached)
+     */
+    const std::string &join(const std::string &path, const std::string &pathName);
+
+    /**
+     * Same as {@link ModuleLoader::extractPath()}, cached.
+     * @param pathName a path along with a filename (e.g. /my/path/file.glsl)
+     * @return the path part, valid until the cache is cleared
+     */
+    const std::string &extractPath(const std::string &pathName);
+
+    /**
+     * Forgets all the cached paths.
+     */
+    void clear();
+
+    /**
+     * Sets the loader performing the path operations, and clears the cache.
+     * @param moduleLoader the loader (not owned, can be nullptr)
+     */
+    void setModuleLoader(ModuleLoader *moduleLoader);
+
+    /**
+     * @return the loader performing the path operations.
+     */
+    ModuleLoader *getModuleLoader() const { return moduleLoader; }
+
+    /**
+     * @return the number of results returned from the cache since the last clear.
+     */
+    std::size_t getHits() const { return hits; }
+
+    /**
+     * @return the number of results computed by the loader since the last clear.
+     */
+    std::size_t getMisses() const { return misses; }
+
+    /**
+     * @return the number of interned paths.
+     */
+    std::size_t getPathCount() const { return paths.size(); }
+};
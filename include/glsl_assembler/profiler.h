@@ -0,0 +1,299 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * <p>Opt-in instrumentation of {@link ModuleGraph} loading: wall time of each loading phase, counters, and a timeline
+ * of events which can be exported in the Chrome trace event format (see {@link #writeChromeTrace()}), to be viewed in
+ * chrome://tracing or Perfetto.
+ * <p>Set it with {@link ModuleGraph::setProfiler()} (or {@link BatchAssembler::setProfiler()}). A profiler can be shared
+ * by many graphs, loaded on many threads: events are recorded with the thread which produced them.
+ * <p>Phase times are the sum of the recorded durations: when modules are loaded in parallel, the load and analyze
+ * times can exceed the wall time of the whole loading.
+ * <p>This class is threadsafe.
+ */
+class GLSLASSEMBLER_API Profiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Loading phases.
+     */
+    enum class Phase {
+        /**
+         * Reading a module source through the {@link ModuleLoader}.
+         */
+        LOAD,
+
+        /**
+         * Analyzing a module source (see {@link ParsedModule::parse()}), or fetching it from the {@link ModuleCache}.
+         */
+        ANALYZE,
+
+        /**
+         * Resolving the include paths of a BFS level and finding its new modules. Loading, creating and registering
+         * the new modules happen outside of this phase.
+         */
+        RESOLVE,
+
+        /**
+         * Building the topological sort.
+         */
+        SORT,
+
+        /**
+         * Assembling the source.
+         */
+        ASSEMBLE
+    };
+
+    /**
+     * Number of phases.
+     */
+    static const int PHASE_COUNT = 5;
+
+    /**
+     * Returns a callback counting the allocations made so far by the process (see {@link #setAllocationCounter()}).
+     */
+    typedef std::function<std::size_t()> AllocationCounter;
+
+    /**
+     * Loading counters.
+     */
+    struct GLSLASSEMBLER_API Counters {
+        /**
+         * Number of modules read through the {@link ModuleLoader}.
+         */
+        std::size_t modulesLoaded = 0;
+
+        /**
+         * Number of modules reused without being read: found in the {@link ModuleCache} by version stamp, or
+         * unchanged on {@link ModuleGraph::reload()}.
+         */
+        std::size_t modulesReused = 0;
+
+        /**
+         * Number of bytes read through the {@link ModuleLoader}.
+         */
+        std::size_t bytesLoaded = 0;
+
+        /**
+         * Number of lines of the modules read.
+         */
+        std::size_t linesProcessed = 0;
+
+        /**
+         * Number of bytes of the assembled sources.
+         */
+        std::size_t bytesAssembled = 0;
+    };
+
+    /**
+     * Aggregated measurements.
+     */
+    struct GLSLASSEMBLER_API Statistics {
+        /**
+         * Total time of each phase, indexed by {@link Phase}.
+         */
+        Clock::duration phaseTimes[PHASE_COUNT];
+
+        /**
+         * Number of allocations made during each phase, indexed by {@link Phase} (only if an allocation counter is
+         * set; approximate when loading in parallel, since allocations of other threads are counted as well).
+         */
+        std::size_t phaseAllocations[PHASE_COUNT];
+
+        /**
+         * Loading counters.
+         */
+        Counters counters;
+
+        Statistics();
+
+        /**
+         * @param phase the phase
+         * @return the total time of the phase.
+         */
+        Clock::duration getPhaseTime(const Phase phase) const { return phaseTimes[static_cast<int>(phase)]; }
+
+        /**
+         * @param phase the phase
+         * @return the number of allocations made during the phase.
+         */
+        std::size_t getPhaseAllocations(const Phase phase) const { return phaseAllocations[static_cast<int>(phase)]; }
+    };
+
+    /**
+     * A timed event.
+     */
+    struct GLSLASSEMBLER_API Event {
+        /**
+         * Name of the event (a phase name, see {@link Profiler::getPhaseName()}, or e.g. "loadModule").
+         */
+        std::string name;
+
+        /**
+         * Id of the module concerned (e.g. the loaded module, or the root module of the graph).
+         */
+        std::string module;
+
+        /**
+         * Index of the thread which recorded the event (in order of first appearance, starting from zero).
+         */
+        int thread = 0;
+
+        /**
+         * Start of the event.
+         */
+        Clock::time_point begin;
+
+        /**
+         * Duration of the event.
+         */
+        Clock::duration duration = Clock::duration::zero();
+    };
+
+    /**
+     * Measures a scope (RAII): the event is recorded when the scope ends. Does nothing if the profiler is nullptr.
+     */
+    class GLSLASSEMBLER_API Scope {
+    private:
+        Profiler *profiler;
+        const char *name;
+        int phase;
+        const std::string *module;
+        Clock::time_point begin;
+        std::size_t allocations;
+
+    public:
+        /**
+         * Measures a phase.
+         * @param profiler the profiler (can be nullptr)
+         * @param phase the phase
+         * @param module the module concerned (must outlive the scope)
+         */
+        Scope(Profiler *profiler, Phase phase, const std::string &module);
+
+        /**
+         * Measures an event which is not a phase (e.g. a whole loading).
+         * @param profiler the profiler (can be nullptr)
+         * @param name the event name (must outlive the scope)
+         * @param module the module concerned (must outlive the scope)
+         */
+        Scope(Profiler *profiler, const char *name, const std::string &module);
+
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+private:
+    /**
+     * Time origin of the events in the exported trace.
+     */
+    Clock::time_point origin;
+
+    Statistics statistics;
+    std::vector<Event> events;
+
+    /**
+     * Whether events are recorded (besides the statistics).
+     */
+    bool recordEvents = true;
+
+    AllocationCounter allocationCounter;
+
+    /**
+     * Thread indices, by thread id.
+     */
+    std::unordered_map<std::thread::id, int> threads;
+
+    /**
+     * Guards all the fields.
+     */
+    mutable std::mutex mutex;
+
+    /**
+     * @return the current allocation count (zero if there is no allocation counter).
+     */
+    std::size_t countAllocations() const;
+
+    /**
+     * Records an event.
+     * @param name the event name
+     * @param phase the phase index, or -1 if the event is not a phase
+     * @param module the module concerned
+     * @param begin the start of the event
+     * @param end the end of the event
+     * @param allocations the number of allocations made during the event
+     */
+    void record(const char *name, int phase, const std::string &module, Clock::time_point begin, Clock::time_point end, std::size_t allocations);
+
+public:
+    Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    /**
+     * @param phase the phase
+     * @return the name of the phase ("load", "analyze", "resolve", "sort" or "assemble").
+     */
+    static const char *getPhaseName(Phase phase);
+
+    /**
+     * Adds to the counters.
+     * @param counters the values to add
+     */
+    void count(const Counters &counters);
+
+    /**
+     * @return the aggregated measurements.
+     */
+    Statistics getStatistics() const;
+
+    /**
+     * @return a copy of the recorded events, in recording order.
+     */
+    std::vector<Event> getEvents() const;
+
+    /**
+     * Writes the recorded events in the Chrome trace event format (JSON), with timestamps relative to the creation of
+     * the profiler (or the last {@link #clear()}).
+     * @param stream the destination
+     */
+    void writeChromeTrace(std::ostream &stream) const;
+
+    /**
+     * Sets whether events are recorded (the default). When disabled, only the statistics are kept.
+     * @param recordEvents true to record the events
+     */
+    void setRecordEvents(bool recordEvents);
+
+    /**
+     * @return true if the events are recorded.
+     */
+    bool isRecordEvents() const;
+
+    /**
+     * <p>Sets the callback counting the allocations made so far by the process, used to count the allocations of each
+     * phase. The library does not replace the global allocator: the application can provide the count, e.g. from its
+     * own operator new or from its allocator statistics.
+     * @param allocationCounter the callback (can be empty)
+     */
+    void setAllocationCounter(AllocationCounter allocationCounter);
+
+    /**
+     * Removes the statistics and the events, and resets the time origin.
+     */
+    void clear();
+};
@@ -2,6 +2,10 @@
 #include <glsl_assembler/conf.h>
 #include <glsl_assembler/module_loader.h>
 #include <glsl_assembler/string_utils.h>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
 
 /**
  * Basic implementation of path utility methods.
@@ -25,22 +29,66 @@ public:
     }
 
     std::string join(const std::string &path, const std::string &pathName) override {
-        std::vector<std::string> pathSegments = StringUtils::split(path, "/");
-        const std::vector<std::string> pathNameSegments = StringUtils::split(pathName, "/");
-        for (const std::string &segment : pathNameSegments) {
-            if (segment == "" || segment == ".") {
-                continue;
-            } else if (segment == "..") {
-                if (pathSegments.empty()) {
+        // Fast path: a normalized path name is simply appended
+        if (isNormalized(pathName)) {
+            std::string joined;
+            joined.reserve(path.size() + 1 + pathName.size());
+            joined += path;
+            joined += '/';
+            joined += pathName;
+            return joined;
+        }
+
+        // The segments of the base path are kept as they are, the path name ones are applied to them in place
+        std::string joined = path;
+        std::size_t segments = std::count(path.begin(), path.end(), '/') + 1;
+        for (std::size_t begin = 0; begin <= pathName.size();) {
+            std::size_t end = pathName.find('/', begin);
+            end = end == std::string::npos ? pathName.size() : end;
+            const std::size_t length = end - begin;
+            if (length == 0 || (length == 1 && pathName[begin] == '.')) {
+                // Skip empty and "." segments
+            } else if (length == 2 && pathName[begin] == '.' && pathName[begin + 1] == '.') {
+                if (segments == 0) {
                     throw std::runtime_error("Unknown path");
                 }
 
-                pathSegments.pop_back();
+                const std::size_t slash = segments > 1 ? joined.find_last_of('/') : 0;
+                joined.erase(slash);
+                segments--;
             } else {
-                pathSegments.push_back(segment);
+                if (segments > 0) {
+                    joined += '/';
+                }
+
+                joined.append(pathName, begin, length);
+                segments++;
             }
+
+            begin = end + 1;
         }
 
-        return StringUtils::join(pathSegments, "/");
+        return joined;
+    }
+
+    /**
+     * @param pathName a path name
+     * @return true if the path name has no empty, "." or ".." segment (so joining it needs no resolution)
+     */
+    static bool isNormalized(const std::string &pathName) {
+        for (std::size_t begin = 0;;) {
+            std::size_t end = pathName.find('/', begin);
+            end = end == std::string::npos ? pathName.size() : end;
+            const std::size_t length = end - begin;
+            if (length == 0 || (pathName[begin] == '.' && (length == 1 || (length == 2 && pathName[begin + 1] == '.')))) {
+                return false;
+            }
+
+            if (end == pathName.size()) {
+                return true;
+            }
+
+            begin = end + 1;
+        }
     }
 };
@@ -0,0 +1,104 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/string_view.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+/**
+ * <p>The source of a module, as returned by {@link ModuleLoader::loadBuffer()}: a read-only range of characters, and
+ * the (reference counted) owner which keeps it alive.
+ * <p>The owner can be anything holding the memory: a string, a memory mapping, a pack file shared by many buffers...
+ * Buffers referring to memory which is never freed (e.g. resources embedded in the executable) have no owner.
+ * <p>A {@link ParsedModule} keeps the buffer it has been parsed from, so that the source is never copied: the buffer
+ * must not be modified as long as it is referenced.
+ * <p>Copying a buffer only copies the reference: buffers can be shared across threads.
+ */
+class GLSLASSEMBLER_API SourceBuffer {
+private:
+    /**
+     * The first character.
+     */
+    const char *bufferData;
+
+    /**
+     * The number of characters.
+     */
+    std::size_t bufferSize;
+
+    /**
+     * Keeps the characters alive (null if they are never freed).
+     */
+    std::shared_ptr<const void> owner;
+
+public:
+    /**
+     * Creates an empty buffer.
+     */
+    SourceBuffer()
+        : bufferData(""),
+          bufferSize(0) {
+    }
+
+    /**
+     * @param data the first character
+     * @param size the number of characters
+     * @param owner keeps the characters alive as long as the buffer (or one of its copies) exists
+     */
+    SourceBuffer(const char *data, const std::size_t size, std::shared_ptr<const void> owner)
+        : bufferData(data),
+          bufferSize(size),
+          owner(std::move(owner)) {
+    }
+
+    /**
+     * Creates a buffer owning a string, without copying it.
+     * @param source the string
+     * @return the buffer
+     */
+    static SourceBuffer fromString(std::string source) {
+        const std::shared_ptr<const std::string> string = std::make_shared<const std::string>(std::move(source));
+        return SourceBuffer(string->data(), string->size(), string);
+    }
+
+    /**
+     * Creates a buffer referring to memory which outlives every buffer (e.g. a resource embedded in the executable).
+     * @param data the first character
+     * @param size the number of characters
+     * @return the buffer
+     */
+    static SourceBuffer borrow(const char *data, const std::size_t size) {
+        return SourceBuffer(data, size, nullptr);
+    }
+
+    /**
+     * @return the first character (not null terminated).
+     */
+    const char *data() const { return bufferData; }
+
+    /**
+     * @return the number of characters.
+     */
+    std::size_t size() const { return bufferSize; }
+
+    /**
+     * @return true if the buffer has no characters.
+     */
+    bool empty() const { return bufferSize == 0; }
+
+    /**
+     * @return a view of the characters, valid as long as the buffer exists.
+     */
+    StringView view() const { return StringView(bufferData, bufferSize); }
+
+    /**
+     * @return a copy of the characters.
+     */
+    std::string str() const { return std::string(bufferData, bufferSize); }
+
+    /**
+     * @return the owner of the characters (null if they are never freed).
+     */
+    const std::shared_ptr<const void> &getOwner() const { return owner; }
+};
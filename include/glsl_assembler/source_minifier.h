@@ -0,0 +1,39 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/string_view.h>
+#include <string>
+
+/**
+ * <p>Line by line minifier of GLSL sources (see {@link ModuleGraph::setMinify()}).
+ * <p>Comments are removed, and whitespace is removed unless it separates two tokens which would otherwise merge
+ * (e.g. two identifiers, or <code>a - -b</code>). Preprocessor directives keep a single space wherever they had
+ * whitespace, since it can be significant (e.g. <code>#define A (x)</code>). Lines continued with a backslash (and the
+ * lines they continue) are kept as they are, except for leading and trailing whitespace at the ends of the spliced
+ * line.
+ * <p>Lines are never joined: each source line gives at most one minified line, so that line mapping is preserved.
+ * The state carried from line to line (block comments, continued directives) is kept in a {@link State}.
+ */
+namespace SourceMinifier {
+    /**
+     * State carried from one line to the next.
+     */
+    struct GLSLASSEMBLER_API State {
+        /**
+         * Whether the line starts inside a block comment.
+         */
+        bool inBlockComment = false;
+
+        /**
+         * Whether the line continues the previous one (which ended with a backslash).
+         */
+        bool continued = false;
+    };
+
+    /**
+     * Minifies a single line.
+     * @param line the line (without newline)
+     * @param state the state at the start of the line, updated to the state at the end of the line
+     * @param output will contain the minified line (empty if nothing is left, e.g. a comment or a blank line)
+     */
+    GLSLASSEMBLER_API void minifyLine(const StringView &line, State &state, std::string &output);
+}
@@ -1,32 +1,92 @@
 #pragma once
 #include <glsl_assembler/conf.h>
+#include <cstddef>
 #include <string>
 #include <vector>
 
 /**
- * String utilities.
+ * <p>String utilities.
+ * <p>The scanning primitives ({@link #findNewlines()}, {@link #skipWhitespace()}, {@link #skipWhitespaceBackward()})
+ * are vectorized with SSE2 or AVX2 when the CPU supports them (detected at runtime), with a scalar fallback.
+ * Whitespace is the same set of characters as <code>std::isspace()</code> in the "C" locale.
  */
 namespace StringUtils {
+    /**
+     * Instruction sets used by the scanning primitives.
+     */
+    enum class SimdLevel {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @return the best instruction set supported by the CPU (and the compiler)
+     */
+    GLSLASSEMBLER_API SimdLevel getSupportedSimdLevel();
+
+    /**
+     * @return the instruction set currently used by the scanning primitives (the supported one by default)
+     */
+    GLSLASSEMBLER_API SimdLevel getSimdLevel();
+
+    /**
+     * Sets the instruction set used by the scanning primitives, e.g. to compare them in benchmarks. Levels which are
+     * not supported are lowered to {@link #getSupportedSimdLevel()}.
+     * @param level the wanted instruction set
+     */
+    GLSLASSEMBLER_API void setSimdLevel(SimdLevel level);
+
+    /**
+     * @param ch the character to check
+     * @return true if the character is whitespace (space, tab, newline, vertical tab, form feed or carriage return)
+     */
+    inline bool isSpace(const char ch) {
+        return ch == ' ' || (ch >= '\t' && ch <= '\r');
+    }
+
+    /**
+     * Finds all the newline characters of a buffer.
+     * @param data the buffer
+     * @param size the size of the buffer
+     * @param positions the offsets of the newline characters are appended to it, in ascending order
+     */
+    GLSLASSEMBLER_API void findNewlines(const char *data, std::size_t size, std::vector<std::size_t> &positions);
+
+    /**
+     * @param begin the start of the characters to scan
+     * @param end the end of the characters to scan
+     * @return the first character which is not whitespace, or end
+     */
+    GLSLASSEMBLER_API const char *skipWhitespace(const char *begin, const char *end);
+
+    /**
+     * @param begin the start of the characters to scan
+     * @param end the end of the characters to scan
+     * @return the position after the last character which is not whitespace, or begin
+     */
+    GLSLASSEMBLER_API const char *skipWhitespaceBackward(const char *begin, const char *end);
+
     /**
      * Returns a copy of a string without whitespace at the start.
      * @param s the string to left-trim
      * @return the left-trimmed string
      */
-    GLSLASSEMBLER_API std::string ltrim_copy(std::string s);
+    GLSLASSEMBLER_API std::string ltrim_copy(const std::string &s);
 
     /**
      * Returns a copy of a string without whitespace at the end.
      * @param s the string to right-trim
      * @return the right-trimmed string
      */
-    GLSLASSEMBLER_API std::string rtrim_copy(std::string s);
+    GLSLASSEMBLER_API std::string rtrim_copy(const std::string &s);
 
     /**
      * Returns a copy of a string without whitespace at the start nor at the end.
      * @param s the string to trim
      * @return the trimmed string
      */
-    GLSLASSEMBLER_API std::string trim_copy(std::string s);
+    GLSLASSEMBLER_API std::string trim_copy(const std::string &s);
 
     /**
      * Joints a list of strings with a specific separator.
@@ -37,7 +97,8 @@ namespace StringUtils {
     GLSLASSEMBLER_API std::string join(const std::vector<std::string> &list, const std::string &separator = "");
 
     /**
-     * Splits the lines of a string
+     * Splits the lines of a string (same lines as <code>std::getline()</code>: a trailing newline does not start a new
+     * line, carriage returns are kept).
      * @param str the string to split into lines.
      * @return the list of string lines.
      */
@@ -0,0 +1,88 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+/**
+ * <p>A non-owning view of a character sequence (a minimal std::string_view, which is not available in C++11).
+ * <p>The viewed characters must outlive the view.
+ */
+class GLSLASSEMBLER_API StringView {
+private:
+    /**
+     * The first character.
+     */
+    const char *viewData;
+
+    /**
+     * The number of characters.
+     */
+    std::size_t viewSize;
+
+public:
+    StringView()
+        : viewData(""),
+          viewSize(0) {
+    }
+
+    StringView(const char *data, const std::size_t size)
+        : viewData(data),
+          viewSize(size) {
+    }
+
+    StringView(const char *str)
+        : viewData(str),
+          viewSize(std::strlen(str)) {
+    }
+
+    StringView(const std::string &str)
+        : viewData(str.data()),
+          viewSize(str.size()) {
+    }
+
+    /**
+     * @return the first character (not null terminated).
+     */
+    const char *data() const { return viewData; }
+
+    /**
+     * @return the number of characters.
+     */
+    std::size_t size() const { return viewSize; }
+
+    /**
+     * @return the number of characters.
+     */
+    std::size_t length() const { return viewSize; }
+
+    /**
+     * @return true if the view has no characters.
+     */
+    bool empty() const { return viewSize == 0; }
+
+    const char *begin() const { return viewData; }
+    const char *end() const { return viewData + viewSize; }
+
+    char operator[](const std::size_t index) const { return viewData[index]; }
+
+    /**
+     * @return a copy of the viewed characters.
+     */
+    std::string str() const { return std::string(viewData, viewSize); }
+
+    operator std::string() const { return str(); }
+
+    friend bool operator==(const StringView &a, const StringView &b) {
+        return a.viewSize == b.viewSize && (a.viewSize == 0 || std::memcmp(a.viewData, b.viewData, a.viewSize) == 0);
+    }
+
+    friend bool operator!=(const StringView &a, const StringView &b) {
+        return !(a == b);
+    }
+
+    friend std::ostream &operator<<(std::ostream &stream, const StringView &view) {
+        return stream.write(view.viewData, view.viewSize);
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * <p>Work-stealing thread pool.
+ * <p>Each worker thread owns a task queue: tasks submitted by a worker go to its own queue (and are executed in LIFO
+ * order), tasks submitted by other threads are distributed round-robin. An idle worker steals the oldest task from the
+ * queues of the other workers.
+ * <p>Threads waiting in {@link #parallelFor()} execute queued tasks while waiting, so parallelFor can be safely nested
+ * inside tasks.
+ * <p>This class is threadsafe.
+ */
+class GLSLASSEMBLER_API ThreadPool {
+private:
+    /**
+     * Task queue of a worker thread.
+     */
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    /**
+     * Worker queues (one for each thread).
+     */
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    /**
+     * Worker threads.
+     */
+    std::vector<std::thread> threads;
+
+    /**
+     * Number of queued (not yet started) tasks.
+     */
+    std::atomic<int> queuedTasks;
+
+    /**
+     * Index of the worker queue receiving the next task submitted from outside the pool.
+     */
+    std::atomic<unsigned> nextWorker;
+
+    /**
+     * Whether the pool is being destroyed.
+     */
+    bool stopping = false;
+
+    /**
+     * Used by idle workers to wait for tasks.
+     */
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    /**
+     * Extracts a task, preferring the queue of the given worker (LIFO), then stealing from the other ones (FIFO).
+     * @param workerIndex the index of the preferred worker queue (-1 if the calling thread is not a worker)
+     * @param task will contain the extracted task
+     * @return true if a task has been extracted
+     */
+    bool popTask(int workerIndex, std::function<void()> &task);
+
+    /**
+     * Main loop of a worker thread.
+     * @param workerIndex the index of the worker
+     */
+    void run(int workerIndex);
+
+    /**
+     * @return the index of the worker running on the calling thread, or -1 if the calling thread is not a worker of this pool.
+     */
+    int currentWorker() const;
+
+public:
+    /**
+     * Starts the worker threads.
+     * @param threadCount the number of threads (zero means std::thread::hardware_concurrency()).
+     */
+    explicit ThreadPool(int threadCount = 0);
+
+    /**
+     * Waits for the queued tasks to complete, then stops the worker threads.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * Queues a task. Exceptions thrown by the task are ignored.
+     * @param task the task to execute
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Executes function(0), ..., function(count - 1) on the pool, and waits for them to complete.
+     * The calling thread takes part in the execution.
+     * @param count the number of invocations
+     * @param function the function to invoke
+     * @throws any exception thrown by the invocations (the one with the lowest index is rethrown, after all the
+     * invocations completed)
+     */
+    void parallelFor(int count, const std::function<void(int)> &function);
+
+    /**
+     * @return the number of worker threads.
+     */
+    int getThreadCount() const { return threads.size(); }
+};
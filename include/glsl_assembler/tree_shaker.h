@@ -0,0 +1,31 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <glsl_assembler/module_graph.h>
+#include <vector>
+
+/**
+ * <p>Removes the declarations which are not referenced by the program (see {@link ModuleGraph::setTreeShaking()}).
+ * <p>The source of each module is split into top-level declarations, with a lightweight tokenizer (comments are
+ * skipped, braces, parentheses and brackets are balanced). Declarations are either:
+ * <ul>
+ *  <li>removable: function definitions and prototypes, struct definitions (without declarators) and
+ *  <code>const</code> variables, identified by the names they define;</li>
+ *  <li>roots: <code>main()</code>, preprocessor directives and every other declaration (uniforms, inputs, outputs,
+ *  interface blocks, global variables...), which are always kept since they are part of the program interface.</li>
+ * </ul>
+ * <p>Starting from the roots, every identifier referenced by a kept declaration keeps all the declarations defining
+ * that name (e.g. all the overloads of a function), across all the modules.
+ * <p>Removal works on whole lines: comments and blank lines before a declaration belong to it, and declarations sharing
+ * a line are kept or removed together. Modules which cannot be split (unbalanced braces, e.g. because of conditional
+ * compilation) are kept whole, and their identifiers are all considered referenced.
+ * <p>Names built by macros (token pasting) are not detected: do not enable tree shaking with such sources.
+ */
+namespace TreeShaker {
+    /**
+     * Computes the lines to keep in each module.
+     * @param modules the modules of the program (e.g. in topological order)
+     * @param keptRanges will contain, for each module, the ranges of its source lines to keep, in ascending order
+     * (empty if the whole module is removed)
+     */
+    GLSLASSEMBLER_API void shake(const std::vector<Module *> &modules, std::vector<std::vector<ModuleGraph::LineRange>> &keptRanges);
+}
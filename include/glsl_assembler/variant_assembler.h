@@ -0,0 +1,145 @@
+#pragma once
+#include <glsl_assembler/conf.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Forward declarations
+class AssemblySink;
+class Module;
+class ModuleGraph;
+class ThreadPool;
+
+/**
+ * <p>Assembles variants of a program, which differ only by the <code>#define</code> directives inserted in their
+ * source, from a single loaded {@link ModuleGraph}: the modules are loaded, parsed and sorted once, whatever the number
+ * of variants.
+ * <p>The defines of a variant are inserted right after the hoisted lines (<code>#version</code>,
+ * <code>precision</code>...), one <code>#define NAME VALUE</code> line each. Each {@link Variant} maps its lines back
+ * to the module lines, taking the define lines into account.
+ * <p>The graph must outlive the assembler and its variants, and must not be modified (e.g. loaded again) while they
+ * are in use. Since the assembler only reads the graph, variants can be assembled concurrently, e.g. by passing a
+ * {@link ThreadPool} to {@link #assembleAll()}.
+ */
+class GLSLASSEMBLER_API VariantAssembler {
+public:
+    /**
+     * A preprocessor definition.
+     */
+    struct GLSLASSEMBLER_API Define {
+        /**
+         * The macro name (with its parameters, if any).
+         */
+        std::string name;
+
+        /**
+         * The replacement (can be empty).
+         */
+        std::string value;
+
+        Define() = default;
+
+        Define(std::string name, std::string value = "")
+            : name(std::move(name)),
+              value(std::move(value)) {
+        }
+    };
+
+    /**
+     * An assembled variant.
+     */
+    struct GLSLASSEMBLER_API Variant {
+        /**
+         * The defines of the variant.
+         */
+        std::vector<Define> defines;
+
+        /**
+         * The assembled source of the variant.
+         */
+        std::string source;
+
+        /**
+         * Hash of the variant: the program hash of the graph, combined with the defines.
+         */
+        std::uint64_t programHash = 0;
+
+        /**
+         * Index of the first define line in the source (the number of hoisted lines).
+         */
+        int defineLinesBegin = 0;
+
+        /**
+         * The graph of the variant.
+         */
+        const ModuleGraph *moduleGraph = nullptr;
+
+        /**
+         * Maps a line of the variant source to its module (see {@link ModuleGraph::mapLine()}).
+         * @param line the variant line (starting at 0)
+         * @param moduleLine will contain the module line (starting at 0), or -1 if the line is not found
+         * @return the module, or null if the line is not found or is a define line
+         */
+        Module *mapLine(int line, int &moduleLine) const;
+
+        /**
+         * Maps a module line to the lines of the variant source (see {@link ModuleGraph::mapModuleLine()}).
+         * @param module the module
+         * @param moduleLine the module line (starting at 0)
+         * @param lines will contain the variant lines (starting at 0)
+         * @return the number of variant lines
+         */
+        int mapModuleLine(const Module *module, int moduleLine, std::vector<int> &lines) const;
+    };
+
+private:
+    /**
+     * The graph (not owned).
+     */
+    const ModuleGraph &moduleGraph;
+
+public:
+    /**
+     * @param moduleGraph the loaded graph (not owned, must outlive the assembler).
+     */
+    explicit VariantAssembler(const ModuleGraph &moduleGraph);
+
+    /**
+     * Assembles a single variant.
+     * @param defines the defines of the variant
+     * @return the variant
+     * @throws std::runtime_error if a define is invalid (empty name, or a newline in the name or the value)
+     */
+    Variant assemble(const std::vector<Define> &defines) const;
+
+    /**
+     * Assembles many variants, in parallel if a thread pool is given.
+     * @param defineSets the defines of each variant
+     * @param threadPool the thread pool (can be nullptr, to assemble the variants on the calling thread)
+     * @return the variants, in the same order as defineSets
+     * @throws std::runtime_error if a define is invalid
+     */
+    std::vector<Variant> assembleAll(const std::vector<std::vector<Define>> &defineSets, ThreadPool *threadPool = nullptr) const;
+
+    /**
+     * Writes the source of a variant to a sink, without storing it (see {@link ModuleGraph::writeAssembledSource()}).
+     * @param defines the defines of the variant
+     * @param sink the destination
+     * @throws std::runtime_error if a define is invalid
+     */
+    void writeSource(const std::vector<Define> &defines, AssemblySink &sink) const;
+
+    /**
+     * Computes the hash of a variant, without assembling it: the program hash of the graph, combined with the defines.
+     * @param defines the defines of the variant
+     * @return the hash of the variant
+     */
+    std::uint64_t getProgramHash(const std::vector<Define> &defines) const;
+
+    /**
+     * @return the graph.
+     */
+    const ModuleGraph &getModuleGraph() const { return moduleGraph; }
+};
@@ -0,0 +1,321 @@
+#include <glsl_assembler/analysis_cache.h>
+#include <glsl_assembler/hash.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+const std::uint32_t AnalysisCache::FORMAT_VERSION;
+const int AnalysisCache::DEFAULT_MAX_ENTRIES;
+
+// File layout (little endian):
+// magic (8 bytes), format version (u32), entry count (u32), entries (least recently used first),
+// checksum of everything before (u64).
+// Entry: source hash (u64), source size (u64), include count (u32), includes, hoisted line count (u32), hoisted lines.
+// Include: line (u32), type (u8), path length (u32), path bytes. Hoisted line: index (u32).
+static const char MAGIC[8] = { 'G', 'L', 'S', 'L', 'A', 'C', 'H', 'E' };
+
+namespace {
+    class Writer {
+    private:
+        std::string &buffer;
+
+    public:
+        explicit Writer(std::string &buffer)
+            : buffer(buffer) {
+        }
+
+        void write(const std::uint64_t value, const int size) {
+            for (int i = 0; i < size; i++) {
+                buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        void write(const std::string &str) {
+            write(str.size(), 4);
+            buffer += str;
+        }
+    };
+
+    /**
+     * Reads values, checking the bounds of the buffer.
+     */
+    class Reader {
+    private:
+        const std::string &buffer;
+        std::size_t position;
+        std::size_t end;
+
+    public:
+        Reader(const std::string &buffer, const std::size_t begin, const std::size_t end)
+            : buffer(buffer),
+              position(begin),
+              end(end) {
+        }
+
+        bool read(std::uint64_t &value, const int size) {
+            if (end - position < static_cast<std::size_t>(size)) {
+                return false;
+            }
+
+            value = 0;
+            for (int i = 0; i < size; i++) {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(buffer[position++])) << (8 * i);
+            }
+
+            return true;
+        }
+
+        bool read(std::string &str) {
+            std::uint64_t size;
+            if (!read(size, 4) || end - position < size) {
+                return false;
+            }
+
+            str.assign(buffer, position, size);
+            position += size;
+            return true;
+        }
+    };
+
+    /**
+     * @return a unique temporary path next to a file, so that concurrent writers never write the same file.
+     */
+    std::string temporaryPathOf(const std::string &path) {
+        std::random_device random;
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", static_cast<unsigned int>(random()), static_cast<unsigned int>(random()));
+        return path + suffix;
+    }
+}
+
+AnalysisCache::AnalysisCache(const std::string &path, const int maxEntries)
+    : path(path),
+      maxEntries(std::max(maxEntries, 0)) {
+}
+
+void AnalysisCache::prune(const std::size_t maxEntries) {
+    if (entries.size() <= maxEntries) {
+        return;
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> uses;
+    uses.reserve(entries.size());
+    for (const auto &it : entries) {
+        uses.emplace_back(it.second.lastUse, it.first);
+    }
+
+    const std::size_t evicted = entries.size() - maxEntries;
+    std::nth_element(uses.begin(), uses.begin() + evicted, uses.end());
+    for (std::size_t i = 0; i < evicted; i++) {
+        entries.erase(uses[i].second);
+    }
+
+    statistics.evictions += evicted;
+    modified = true;
+}
+
+bool AnalysisCache::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    useClock = 0;
+    modified = false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    const std::string buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (buffer.size() < sizeof(MAGIC) + 4 + 4 + 8 || buffer.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    // Checksum first, so that corrupt files are never parsed
+    const std::size_t contentSize = buffer.size() - 8;
+    Reader checksumReader(buffer, contentSize, buffer.size());
+    std::uint64_t checksum;
+    if (!checksumReader.read(checksum, 8) || checksum != Hash::xxh64(buffer.data(), contentSize)) {
+        return false;
+    }
+
+    Reader reader(buffer, sizeof(MAGIC), contentSize);
+    std::uint64_t version, entryCount;
+    if (!reader.read(version, 4) || version != FORMAT_VERSION || !reader.read(entryCount, 4)) {
+        return false;
+    }
+
+    std::unordered_map<std::uint64_t, Entry> loadedEntries;
+    for (std::uint64_t i = 0; i < entryCount; i++) {
+        std::uint64_t sourceHash, sourceSize, includeCount, hoistedLineCount;
+        Entry entry;
+        if (!reader.read(sourceHash, 8) || !reader.read(sourceSize, 8) || !reader.read(includeCount, 4)) {
+            return false;
+        }
+
+        entry.sourceSize = sourceSize;
+        for (std::uint64_t j = 0; j < includeCount; j++) {
+            ParsedModule::Include include;
+            std::uint64_t line, type;
+            if (!reader.read(line, 4) || !reader.read(type, 1) || !reader.read(include.path) || type > 1) {
+                return false;
+            }
+
+            include.line = line;
+            include.type = type == 0 ? ParsedModule::Include::Type::ABSOLUTE : ParsedModule::Include::Type::RELATIVE;
+            entry.analysis.includes.push_back(include);
+        }
+
+        if (!reader.read(hoistedLineCount, 4)) {
+            return false;
+        }
+
+        for (std::uint64_t j = 0; j < hoistedLineCount; j++) {
+            std::uint64_t index;
+            if (!reader.read(index, 4)) {
+                return false;
+            }
+
+            entry.analysis.hoistedLines.push_back(index);
+        }
+
+        // Entries are saved from the least to the most recently used
+        entry.lastUse = ++useClock;
+        loadedEntries[sourceHash] = std::move(entry);
+    }
+
+    entries.swap(loadedEntries);
+    if (maxEntries > 0) {
+        prune(maxEntries);
+        modified = false;
+    }
+
+    return true;
+}
+
+void AnalysisCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!modified) {
+        return;
+    }
+
+    if (maxEntries > 0) {
+        prune(maxEntries);
+    }
+
+    // Least recently used first, so that load() restores the order
+    std::vector<std::pair<std::uint64_t, const std::pair<const std::uint64_t, Entry> *>> sortedEntries;
+    sortedEntries.reserve(entries.size());
+    for (const auto &it : entries) {
+        sortedEntries.emplace_back(it.second.lastUse, &it);
+    }
+
+    std::sort(sortedEntries.begin(), sortedEntries.end());
+
+    std::string buffer(MAGIC, sizeof(MAGIC));
+    Writer writer(buffer);
+    writer.write(FORMAT_VERSION, 4);
+    writer.write(entries.size(), 4);
+    for (const auto &sortedEntry : sortedEntries) {
+        const auto &it = *sortedEntry.second;
+        const Analysis &analysis = it.second.analysis;
+        writer.write(it.first, 8);
+        writer.write(it.second.sourceSize, 8);
+        writer.write(analysis.includes.size(), 4);
+        for (const ParsedModule::Include &include : analysis.includes) {
+            writer.write(include.line, 4);
+            writer.write(include.type == ParsedModule::Include::Type::ABSOLUTE ? 0 : 1, 1);
+            writer.write(include.path);
+        }
+
+        writer.write(analysis.hoistedLines.size(), 4);
+        for (const int index : analysis.hoistedLines) {
+            writer.write(index, 4);
+        }
+    }
+
+    writer.write(Hash::xxh64(buffer), 8);
+
+    // Write a temporary file, then replace the cache file, so that readers never see a partial file
+    const std::string temporaryPath = temporaryPathOf(path);
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(buffer.data(), buffer.size());
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Cannot write analysis cache " + temporaryPath);
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        // Some platforms do not replace existing files
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Cannot write analysis cache " + path);
+        }
+    }
+
+    modified = false;
+}
+
+bool AnalysisCache::find(const std::uint64_t sourceHash, const std::size_t sourceSize, Analysis &analysis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = entries.find(sourceHash);
+    if (it == entries.end() || it->second.sourceSize != sourceSize) {
+        statistics.misses++;
+        return false;
+    }
+
+    statistics.hits++;
+    it->second.lastUse = ++useClock;
+    analysis = it->second.analysis;
+    return true;
+}
+
+void AnalysisCache::store(const std::uint64_t sourceHash, const std::size_t sourceSize, const Analysis &analysis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &entry = entries[sourceHash];
+    entry.sourceSize = sourceSize;
+    entry.analysis = analysis;
+    entry.lastUse = ++useClock;
+    modified = true;
+
+    // Amortized: evict an eighth of the entries at once
+    if (maxEntries > 0 && entries.size() > static_cast<std::size_t>(maxEntries) + maxEntries / 8) {
+        prune(maxEntries);
+    }
+}
+
+void AnalysisCache::setMaxEntries(const int maxEntries) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->maxEntries = std::max(maxEntries, 0);
+    if (this->maxEntries > 0) {
+        prune(this->maxEntries);
+    }
+}
+
+int AnalysisCache::getMaxEntries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxEntries;
+}
+
+int AnalysisCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+AnalysisCache::Statistics AnalysisCache::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void AnalysisCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    modified = true;
+}
@@ -0,0 +1,94 @@
+#include <glsl_assembler/arena.h>
+#include <cstdlib>
+
+// Blocks grow geometrically up to this size (larger allocations get a block of their own size)
+static const std::size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+Arena::Arena(const std::size_t initialBlockSize)
+    : initialBlockSize(initialBlockSize) {
+}
+
+Arena::~Arena() {
+    while (blocks) {
+        Block *next = blocks->next;
+        std::free(blocks);
+        blocks = next;
+    }
+}
+
+void *Arena::allocateBlock(const std::size_t size, const std::size_t alignment) {
+    std::size_t blockSize = blocks ? blocks->size * 2 : initialBlockSize;
+    if (blockSize > MAX_BLOCK_SIZE) {
+        blockSize = MAX_BLOCK_SIZE;
+    }
+
+    if (blockSize < size + alignment) {
+        blockSize = size + alignment;
+    }
+
+    Block *block = static_cast<Block *>(std::malloc(sizeof(Block) + blockSize));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+
+    block->size = blockSize;
+    char *memory = reinterpret_cast<char *>(block + 1);
+
+    // A block for a single large allocation does not replace the current block, which may still have free memory
+    const bool dedicated = blocks && blockSize > MAX_BLOCK_SIZE;
+    if (dedicated) {
+        block->next = blocks->next;
+        blocks->next = block;
+    } else {
+        block->next = blocks;
+        blocks = block;
+        current = memory;
+        end = memory + blockSize;
+    }
+
+    const std::size_t padding = (alignment - reinterpret_cast<std::size_t>(memory) % alignment) % alignment;
+    allocatedSize += padding + size;
+    if (!dedicated) {
+        current += padding + size;
+    }
+
+    return memory + padding;
+}
+
+void Arena::release() {
+    if (!blocks) {
+        return;
+    }
+
+    // Keep the largest block
+    Block *largest = blocks;
+    for (Block *block = blocks->next; block; block = block->next) {
+        if (block->size > largest->size) {
+            largest = block;
+        }
+    }
+
+    while (blocks) {
+        Block *next = blocks->next;
+        if (blocks != largest) {
+            std::free(blocks);
+        }
+
+        blocks = next;
+    }
+
+    largest->next = nullptr;
+    blocks = largest;
+    current = reinterpret_cast<char *>(largest + 1);
+    end = current + largest->size;
+    allocatedSize = 0;
+}
+
+std::size_t Arena::getCapacity() const {
+    std::size_t capacity = 0;
+    for (const Block *block = blocks; block; block = block->next) {
+        capacity += block->size;
+    }
+
+    return capacity;
+}
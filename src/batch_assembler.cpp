@@ -0,0 +1,138 @@
+#include <glsl_assembler/batch_assembler.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_loader.h>
+#include <glsl_assembler/source_buffer.h>
+#include <glsl_assembler/thread_pool.h>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    /**
+     * Forwards to another loader, keeping the loaded sources (and errors) so that each file is loaded only once. The
+     * graphs share the buffers, so the sources are not copied either.
+     */
+    class MemoizingModuleLoader : public ModuleLoader {
+    private:
+        ModuleLoader &moduleLoader;
+        std::unordered_map<std::string, std::shared_future<SourceBuffer>> sources;
+        std::mutex mutex;
+
+    public:
+        explicit MemoizingModuleLoader(ModuleLoader &moduleLoader)
+            : moduleLoader(moduleLoader) {
+        }
+
+        std::string load(const std::string &path) override {
+            return loadBuffer(path).str();
+        }
+
+        SourceBuffer loadBuffer(const std::string &path) override {
+            std::promise<SourceBuffer> promise;
+            std::shared_future<SourceBuffer> source;
+            bool loading = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const auto it = sources.find(path);
+                if (it != sources.end()) {
+                    source = it->second;
+                } else {
+                    source = promise.get_future().share();
+                    sources.emplace(path, source);
+                    loading = true;
+                }
+            }
+
+            // Load without holding the lock, other graphs needing the same file wait for it
+            if (loading) {
+                try {
+                    promise.set_value(moduleLoader.loadBuffer(path));
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+            }
+
+            // Rethrows the load error, if any
+            return source.get();
+        }
+
+        bool getVersion(const std::string &path, std::uint64_t &version) override {
+            return moduleLoader.getVersion(path, version);
+        }
+
+        bool isPath(const std::string &pathString) override {
+            return moduleLoader.isPath(pathString);
+        }
+
+        std::string extractPath(const std::string &pathName) override {
+            return moduleLoader.extractPath(pathName);
+        }
+
+        std::string join(const std::string &path, const std::string &pathName) override {
+            return moduleLoader.join(path, pathName);
+        }
+    };
+}
+
+BatchAssembler::BatchAssembler()
+    : moduleLoader(nullptr),
+      threadPool(nullptr),
+      moduleCache(nullptr),
+      profiler(nullptr) {
+}
+
+BatchAssembler::~BatchAssembler() {
+}
+
+std::vector<BatchAssembler::Result> BatchAssembler::assemble(const std::vector<std::string> &modulePaths) {
+    if (!moduleLoader) {
+        throw std::runtime_error("No module loader specified!");
+    }
+
+    ThreadPool *pool = threadPool;
+    if (!pool) {
+        if (!ownThreadPool) {
+            ownThreadPool.reset(new ThreadPool());
+        }
+
+        pool = ownThreadPool.get();
+    }
+
+    ModuleCache *cache = moduleCache;
+    if (!cache) {
+        if (!ownModuleCache) {
+            ownModuleCache.reset(new ModuleCache());
+        }
+
+        cache = ownModuleCache.get();
+    }
+
+    MemoizingModuleLoader batchLoader(*moduleLoader);
+    std::vector<Result> results(modulePaths.size());
+    pool->parallelFor(modulePaths.size(), [&](const int index) {
+        Result &result = results[index];
+        result.modulePath = modulePaths[index];
+        try {
+            // Each graph is loaded serially: the parallelism comes from the roots
+            std::unique_ptr<ModuleGraph> moduleGraph(new ModuleGraph());
+            moduleGraph->setModuleLoader(&batchLoader);
+            moduleGraph->setModuleCache(cache);
+            moduleGraph->setProfiler(profiler);
+            moduleGraph->setIncludeDir(includeDir);
+            moduleGraph->loadModule(result.modulePath);
+
+            // Neither the batch loader nor the internal cache outlive the results; the profiler only records the batch
+            moduleGraph->setModuleLoader(moduleLoader);
+            moduleGraph->setModuleCache(moduleCache);
+            moduleGraph->setProfiler(nullptr);
+            result.moduleGraph = std::move(moduleGraph);
+        } catch (const std::exception &e) {
+            result.error = e.what();
+        } catch (...) {
+            result.error = "Unknown error";
+        }
+    });
+
+    return results;
+}
@@ -0,0 +1,84 @@
+#include <glsl_assembler/directive_scanner.h>
+#include <glsl_assembler/string_utils.h>
+#include <cstring>
+
+namespace DirectiveScanner {
+    static bool startsWith(const char *begin, const char *end, const char *prefix, const std::size_t prefixLength) {
+        return static_cast<std::size_t>(end - begin) >= prefixLength && std::memcmp(begin, prefix, prefixLength) == 0;
+    }
+
+    // The include path can contain any character, but double quotes must be escaped with a backslash
+    static bool isValidIncludePath(const char *begin, const char *end) {
+        for (const char *ch = begin; ch != end; ch++) {
+            if (*ch == '"' && (ch == begin || *(ch - 1) != '\\')) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static bool scanInclude(const char *begin, const char *end, const char open, const char close, Directive &directive) {
+        static const char prefix[] = "#include ";
+        static const std::size_t prefixLength = sizeof(prefix) - 1;
+
+        // At least the prefix and the two delimiters
+        if (static_cast<std::size_t>(end - begin) < prefixLength + 2 ||
+            !startsWith(begin, end, prefix, prefixLength) ||
+            begin[prefixLength] != open ||
+            *(end - 1) != close) {
+            return false;
+        }
+
+        const char *pathBegin = begin + prefixLength + 1;
+        const char *pathEnd = end - 1;
+        if (!isValidIncludePath(pathBegin, pathEnd)) {
+            return false;
+        }
+
+        if (pathBegin == pathEnd) {
+            directive.type = DirectiveType::INVALID_INCLUDE;
+        } else {
+            directive.argument = pathBegin;
+            directive.argumentLength = pathEnd - pathBegin;
+        }
+
+        return true;
+    }
+
+    Directive scanLine(const char *begin, const char *end) {
+        Directive directive;
+
+        // Trim the line (in place)
+        begin = StringUtils::skipWhitespace(begin, end);
+        end = StringUtils::skipWhitespaceBackward(begin, end);
+
+        if (begin == end) {
+            return directive;
+        }
+
+        // Skip commented lines (block comments are not supported)
+        if (startsWith(begin, end, "//", 2)) {
+            directive.type = DirectiveType::COMMENT;
+            return directive;
+        }
+
+        if (*begin == '#') {
+            if (scanInclude(begin, end, '"', '"', directive)) {
+                if (directive.type == DirectiveType::NONE) {
+                    directive.type = DirectiveType::RELATIVE_INCLUDE;
+                }
+            } else if (scanInclude(begin, end, '<', '>', directive)) {
+                if (directive.type == DirectiveType::NONE) {
+                    directive.type = DirectiveType::ABSOLUTE_INCLUDE;
+                }
+            } else if (startsWith(begin, end, "#version", 8)) {
+                directive.type = DirectiveType::VERSION;
+            }
+        } else if (startsWith(begin, end, "precision", 9)) {
+            directive.type = DirectiveType::PRECISION;
+        }
+
+        return directive;
+    }
+}
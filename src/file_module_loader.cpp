@@ -0,0 +1,163 @@
+#include <glsl_assembler/file_module_loader.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t FileModuleLoader::DEFAULT_MMAP_THRESHOLD;
+
+namespace {
+    /**
+     * Closes a file descriptor when going out of scope.
+     */
+    class FileDescriptor {
+    private:
+        int fd;
+
+    public:
+        explicit FileDescriptor(const int fd)
+            : fd(fd) {
+        }
+
+        ~FileDescriptor() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+        int get() const { return fd; }
+
+        int release() {
+            const int released = fd;
+            fd = -1;
+            return released;
+        }
+    };
+
+    std::runtime_error fileError(const std::string &message, const std::string &path) {
+        return std::runtime_error(message + " " + path + ": " + std::strerror(errno));
+    }
+}
+
+FileModuleLoader::FileModuleLoader(const std::string &rootDir)
+    : rootDir(rootDir),
+      mmapThreshold(DEFAULT_MMAP_THRESHOLD),
+      keepMappings(false) {
+}
+
+std::string FileModuleLoader::getFilePath(const std::string &path) const {
+    if (rootDir.empty() || (!path.empty() && path[0] == '/')) {
+        return path;
+    }
+
+    return rootDir + "/" + path;
+}
+
+int FileModuleLoader::openFile(const std::string &filePath, std::size_t &size) const {
+    FileDescriptor file(open(filePath.c_str(), O_RDONLY | O_CLOEXEC));
+    if (file.get() < 0) {
+        throw fileError("Cannot open", filePath);
+    }
+
+    struct stat fileStat;
+    if (fstat(file.get(), &fileStat) != 0) {
+        throw fileError("Cannot stat", filePath);
+    }
+
+    if (!S_ISREG(fileStat.st_mode)) {
+        throw std::runtime_error("Not a regular file: " + filePath);
+    }
+
+    size = fileStat.st_size;
+    return file.release();
+}
+
+std::string FileModuleLoader::readFile(const int fd, const std::size_t size, const std::string &filePath) const {
+    if (size == 0) {
+        return std::string();
+    }
+
+    // A single read() into the result: mapping the file only to copy it would cost more
+    std::string source(size, '\0');
+    std::size_t offset = 0;
+    while (offset < size) {
+        const ssize_t count = read(fd, &source[offset], size - offset);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw fileError("Cannot read", filePath);
+        } else if (count == 0) {
+            // The file has been truncated meanwhile
+            source.resize(offset);
+            break;
+        }
+
+        offset += count;
+    }
+
+    return source;
+}
+
+std::string FileModuleLoader::load(const std::string &path) {
+    const std::string filePath = getFilePath(path);
+    std::size_t size;
+    FileDescriptor file(openFile(filePath, size));
+    return readFile(file.get(), size, filePath);
+}
+
+SourceBuffer FileModuleLoader::loadBuffer(const std::string &path) {
+    const std::string filePath = getFilePath(path);
+    std::size_t size;
+    FileDescriptor file(openFile(filePath, size));
+    if (!keepMappings || size == 0 || size < mmapThreshold) {
+        return SourceBuffer::fromString(readFile(file.get(), size, filePath));
+    }
+
+    // The mapping itself is the buffer: it is unmapped when the last buffer referring to it is destroyed
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+    if (mapping == MAP_FAILED) {
+        throw fileError("Cannot map", filePath);
+    }
+
+    std::shared_ptr<const void> owner(mapping, [size](void *mapping) {
+        munmap(mapping, size);
+    });
+
+    return SourceBuffer(static_cast<const char *>(mapping), size, owner);
+}
+
+bool FileModuleLoader::getVersion(const std::string &path, std::uint64_t &version) {
+    struct stat fileStat;
+    if (stat(getFilePath(path).c_str(), &fileStat) != 0) {
+        return false;
+    }
+
+    // Nanosecond modification time, mixed with the size to catch writes within the timestamp granularity
+    const std::uint64_t modificationTime = static_cast<std::uint64_t>(fileStat.st_mtim.tv_sec) * 1000000000ull + fileStat.st_mtim.tv_nsec;
+    version = modificationTime ^ (static_cast<std::uint64_t>(fileStat.st_size) << 40);
+    return true;
+}
+
+bool FileModuleLoader::isPath(const std::string &pathString) {
+    struct stat fileStat;
+    const std::string filePath = getFilePath(pathString);
+    return stat(filePath.empty() ? "." : filePath.c_str(), &fileStat) == 0 && S_ISDIR(fileStat.st_mode);
+}
+
+std::string FileModuleLoader::join(const std::string &path, const std::string &pathName) {
+    const std::string joined = SimpleModuleLoader::join(path, pathName);
+    if (path.empty() && !joined.empty() && joined[0] == '/') {
+        return joined.substr(1);
+    }
+
+    return joined;
+}
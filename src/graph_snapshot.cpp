@@ -0,0 +1,565 @@
+#include <glsl_assembler/graph_snapshot.h>
+#include <glsl_assembler/assembly_sink.h>
+#include <glsl_assembler/hash.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/source_buffer.h>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const std::uint32_t GraphSnapshot::FORMAT_VERSION;
+
+// File layout (little endian):
+// magic (8 bytes), format version (u32), options (u8: 1 = tree shaking, 2 = minify), program hash (u64),
+// assembled source size (u64), hoisted lines count (u32), root module id, include dir, module count (u32), modules,
+// toposort count (u32), module handles (u32), block count (u32), blocks, minifier state count (u32), minifier states
+// (u8: 1 = in block comment, 2 = continued), assembled source (u64 size, bytes), checksum of everything before (u64).
+// Module: id, source hash (u64), source, commented text, line count (u32), lines (offset u32, length u32), include
+// count (u32), includes, hoisted line count (u32), hoisted line indices (u32), versioned (u8), version (u64).
+// Include: line (u32), type (u8), path, dependency handle (u32).
+// Block: module handle (u32), module range (u32 begin, u32 end), assembled range (u32 begin, u32 end).
+// Strings: length (u32), bytes.
+static const char MAGIC[8] = { 'G', 'L', 'S', 'L', 'S', 'N', 'A', 'P' };
+
+static const std::uint64_t OPTION_TREE_SHAKING = 1;
+static const std::uint64_t OPTION_MINIFY = 2;
+
+namespace {
+    class Writer {
+    private:
+        std::string &buffer;
+
+    public:
+        explicit Writer(std::string &buffer)
+            : buffer(buffer) {
+        }
+
+        void write(const std::uint64_t value, const int size) {
+            for (int i = 0; i < size; i++) {
+                buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+            }
+        }
+
+        void writeBytes(const char *data, const std::size_t size) {
+            write(size, 4);
+            buffer.append(data, size);
+        }
+
+        void write(const std::string &str) {
+            writeBytes(str.data(), str.size());
+        }
+    };
+
+    /**
+     * Reads values from the snapshot, checking the bounds.
+     */
+    class Reader {
+    private:
+        const char *data;
+        std::size_t position;
+        std::size_t end;
+
+    public:
+        Reader(const char *data, const std::size_t begin, const std::size_t end)
+            : data(data),
+              position(begin),
+              end(end) {
+        }
+
+        bool read(std::uint64_t &value, const int size) {
+            if (end - position < static_cast<std::size_t>(size)) {
+                return false;
+            }
+
+            value = 0;
+            for (int i = 0; i < size; i++) {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[position++])) << (8 * i);
+            }
+
+            return true;
+        }
+
+        /**
+         * Reads a 32 bits value which must be lower than a limit.
+         */
+        bool readIndex(std::size_t &value, const std::uint64_t limit) {
+            std::uint64_t value64;
+            if (!read(value64, 4) || value64 >= limit) {
+                return false;
+            }
+
+            value = value64;
+            return true;
+        }
+
+        /**
+         * Reads a range of bytes, without copying them.
+         */
+        bool readRange(std::size_t &offset, std::size_t &size, const int sizeBytes = 4) {
+            std::uint64_t size64;
+            if (!read(size64, sizeBytes) || end - position < size64) {
+                return false;
+            }
+
+            offset = position;
+            size = size64;
+            position += size;
+            return true;
+        }
+
+        bool read(std::string &str) {
+            std::size_t offset, size;
+            if (!readRange(offset, size)) {
+                return false;
+            }
+
+            str.assign(data + offset, size);
+            return true;
+        }
+
+        /**
+         * @return true if the given number of items, of at least itemSize bytes each, fit in the remaining bytes.
+         */
+        bool fits(const std::uint64_t count, const std::size_t itemSize) const {
+            return count <= (end - position) / itemSize;
+        }
+
+        bool atEnd() const { return position == end; }
+    };
+
+    /**
+     * A module decoded from a snapshot, not yet added to the graph.
+     */
+    struct DecodedModule {
+        std::shared_ptr<const ParsedModule> parsedModule;
+        std::vector<ModuleRegistry::Handle> dependencyHandles;
+        std::uint64_t version = 0;
+        bool versioned = false;
+    };
+
+    /**
+     * A source block decoded from a snapshot.
+     */
+    struct DecodedBlock {
+        std::size_t moduleHandle;
+        ModuleGraph::SourceBlock block;
+    };
+
+    /**
+     * @return a unique temporary path next to a file, so that concurrent writers never write the same file.
+     */
+    std::string temporaryPathOf(const std::string &path) {
+        std::random_device random;
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", static_cast<unsigned int>(random()), static_cast<unsigned int>(random()));
+        return path + suffix;
+    }
+}
+
+std::string GraphSnapshot::encode(const ModuleGraph &moduleGraph) {
+    if (moduleGraph.toposort.empty()) {
+        throw std::runtime_error("Cannot snapshot an empty graph");
+    }
+
+    std::unordered_map<const Module *, ModuleRegistry::Handle> handles;
+    std::size_t capacity = 256 + moduleGraph.assembledSourceSize + moduleGraph.assembledSourceBlocks.size() * 20;
+    for (ModuleRegistry::Handle handle = 0; handle < moduleGraph.modules.size(); handle++) {
+        const Module *module = moduleGraph.modules.get(handle);
+        const ParsedModule &parsedModule = *module->getParsedModule();
+        handles[module] = handle;
+        capacity += 64 + module->getId().size() + parsedModule.source.size() + parsedModule.commentedText.size();
+        capacity += parsedModule.sourceLines.size() * 8;
+    }
+
+    std::string buffer(MAGIC, sizeof(MAGIC));
+    buffer.reserve(capacity);
+    Writer writer(buffer);
+    writer.write(FORMAT_VERSION, 4);
+    writer.write((moduleGraph.treeShaking ? OPTION_TREE_SHAKING : 0) | (moduleGraph.minify ? OPTION_MINIFY : 0), 1);
+    writer.write(moduleGraph.programHash, 8);
+    writer.write(moduleGraph.assembledSourceSize, 8);
+    writer.write(moduleGraph.hoistedLinesCount, 4);
+    writer.write(moduleGraph.rootModuleId);
+    writer.write(moduleGraph.includeDir);
+
+    writer.write(moduleGraph.modules.size(), 4);
+    for (ModuleRegistry::Handle handle = 0; handle < moduleGraph.modules.size(); handle++) {
+        const Module *module = moduleGraph.modules.get(handle);
+        const ParsedModule &parsedModule = *module->getParsedModule();
+
+        // Line offsets (which go past the source for the commented lines) are 32 bits
+        if (parsedModule.source.size() + parsedModule.commentedText.size() > UINT32_MAX) {
+            throw std::runtime_error("Module too large for a snapshot: " + module->getId());
+        }
+
+        writer.write(module->getId());
+        writer.write(parsedModule.sourceHash, 8);
+        writer.writeBytes(parsedModule.source.data(), parsedModule.source.size());
+        writer.write(parsedModule.commentedText);
+        writer.write(parsedModule.sourceLines.size(), 4);
+        for (const ParsedModule::Line &line : parsedModule.sourceLines) {
+            writer.write(line.offset, 4);
+            writer.write(line.length, 4);
+        }
+
+        // Dependencies are in the same order as the include directives
+        writer.write(parsedModule.includes.size(), 4);
+        for (int i = 0; i < parsedModule.includes.size(); i++) {
+            const ParsedModule::Include &include = parsedModule.includes[i];
+            writer.write(include.line, 4);
+            writer.write(include.type == ParsedModule::Include::Type::ABSOLUTE ? 0 : 1, 1);
+            writer.write(include.path);
+            writer.write(module->getDependency(i).moduleHandle, 4);
+        }
+
+        writer.write(parsedModule.hoistLines.size(), 4);
+        for (const ParsedModule::HoistedLine &hoistedLine : parsedModule.hoistLines) {
+            writer.write(hoistedLine.index, 4);
+        }
+
+        std::uint64_t version;
+        const bool versioned = module->getVersion(version);
+        writer.write(versioned ? 1 : 0, 1);
+        writer.write(versioned ? version : 0, 8);
+    }
+
+    writer.write(moduleGraph.toposort.size(), 4);
+    for (const Module *module : moduleGraph.toposort) {
+        writer.write(handles[module], 4);
+    }
+
+    writer.write(moduleGraph.assembledSourceBlocks.size(), 4);
+    for (const ModuleGraph::SourceBlock &block : moduleGraph.assembledSourceBlocks) {
+        writer.write(handles[block.module], 4);
+        writer.write(block.moduleRange.begin, 4);
+        writer.write(block.moduleRange.end, 4);
+        writer.write(block.assembledRange.begin, 4);
+        writer.write(block.assembledRange.end, 4);
+    }
+
+    writer.write(moduleGraph.minifiedBlockStates.size(), 4);
+    for (const SourceMinifier::State &state : moduleGraph.minifiedBlockStates) {
+        writer.write((state.inBlockComment ? 1 : 0) | (state.continued ? 2 : 0), 1);
+    }
+
+    // The assembled source is stored even if the graph does not keep it
+    writer.write(moduleGraph.assembledSourceSize, 8);
+    if (moduleGraph.keepAssembledSource) {
+        buffer += moduleGraph.assembledSource;
+    } else {
+        StringAssemblySink sink(buffer);
+        moduleGraph.writeAssembledSource(sink);
+    }
+
+    writer.write(Hash::xxh64(buffer), 8);
+    return buffer;
+}
+
+bool GraphSnapshot::decode(ModuleGraph &moduleGraph, const SourceBuffer &snapshot) {
+    const char *data = snapshot.data();
+    if (snapshot.size() < sizeof(MAGIC) + 4 + 8 || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    // Checksum first, so that corrupt snapshots are never decoded
+    const std::size_t contentSize = snapshot.size() - 8;
+    Reader checksumReader(data, contentSize, snapshot.size());
+    std::uint64_t checksum;
+    if (!checksumReader.read(checksum, 8) || checksum != Hash::xxh64(data, contentSize)) {
+        return false;
+    }
+
+    Reader reader(data, sizeof(MAGIC), contentSize);
+    std::uint64_t version, options, programHash, assembledSourceSize;
+    std::size_t hoistedLinesCount, moduleCount;
+    std::string rootModuleId, includeDir;
+    if (!reader.read(version, 4) || version != FORMAT_VERSION || !reader.read(options, 1) || options > 3 ||
+        !reader.read(programHash, 8) || !reader.read(assembledSourceSize, 8) || !reader.readIndex(hoistedLinesCount, INT_MAX) ||
+        !reader.read(rootModuleId) || !reader.read(includeDir) || !reader.readIndex(moduleCount, INT_MAX) ||
+        !reader.fits(moduleCount, 4)) {
+        return false;
+    }
+
+    // Decode everything before touching the graph
+    std::vector<DecodedModule> modules(moduleCount);
+    std::unordered_set<std::string> ids;
+    for (DecodedModule &decodedModule : modules) {
+        std::shared_ptr<ParsedModule> parsedModule(new ParsedModule());
+        std::size_t sourceOffset, sourceSize, lineCount, includeCount, hoistedLineCount;
+        std::uint64_t versioned;
+        if (!reader.read(parsedModule->id) || !ids.insert(parsedModule->id).second ||
+            !reader.read(parsedModule->sourceHash, 8) || !reader.readRange(sourceOffset, sourceSize) ||
+            !reader.read(parsedModule->commentedText) || !reader.readIndex(lineCount, INT_MAX) || !reader.fits(lineCount, 8)) {
+            return false;
+        }
+
+        parsedModule->source = SourceBuffer(data + sourceOffset, sourceSize, snapshot.getOwner());
+        parsedModule->sourceSize = sourceSize;
+        const std::size_t commentedSize = parsedModule->commentedText.size();
+        parsedModule->sourceLines.resize(lineCount);
+        for (ParsedModule::Line &line : parsedModule->sourceLines) {
+            std::uint64_t offset, length;
+            if (!reader.read(offset, 4) || !reader.read(length, 4)) {
+                return false;
+            }
+
+            // The line must lie entirely in the source, or entirely in the commented text
+            const bool inSource = offset < sourceSize && length <= sourceSize - offset;
+            const bool inCommentedText = offset >= sourceSize && offset - sourceSize <= commentedSize && length <= commentedSize - (offset - sourceSize);
+            if (!inSource && !inCommentedText) {
+                return false;
+            }
+
+            line.offset = offset;
+            line.length = length;
+        }
+
+        if (!reader.readIndex(includeCount, INT_MAX) || !reader.fits(includeCount, 13)) {
+            return false;
+        }
+
+        parsedModule->includes.resize(includeCount);
+        decodedModule.dependencyHandles.resize(includeCount);
+        for (int i = 0; i < includeCount; i++) {
+            ParsedModule::Include &include = parsedModule->includes[i];
+            std::size_t line, handle;
+            std::uint64_t type;
+            if (!reader.readIndex(line, lineCount) || !reader.read(type, 1) || type > 1 || !reader.read(include.path) ||
+                !reader.readIndex(handle, moduleCount)) {
+                return false;
+            }
+
+            include.line = line;
+            include.type = type == 0 ? ParsedModule::Include::Type::ABSOLUTE : ParsedModule::Include::Type::RELATIVE;
+            decodedModule.dependencyHandles[i] = handle;
+        }
+
+        if (!reader.readIndex(hoistedLineCount, INT_MAX) || !reader.fits(hoistedLineCount, 4)) {
+            return false;
+        }
+
+        // Hoisted lines are commented: the original line follows the comment prefix
+        parsedModule->hoistLines.resize(hoistedLineCount);
+        for (ParsedModule::HoistedLine &hoistedLine : parsedModule->hoistLines) {
+            std::size_t index;
+            if (!reader.readIndex(index, lineCount)) {
+                return false;
+            }
+
+            const StringView line = parsedModule->getSourceLine(index);
+            if (line.size() < 3 || std::memcmp(line.data(), "// ", 3) != 0) {
+                return false;
+            }
+
+            hoistedLine.index = index;
+            hoistedLine.line.assign(line.data() + 3, line.size() - 3);
+        }
+
+        if (!reader.read(versioned, 1) || versioned > 1 || !reader.read(decodedModule.version, 8)) {
+            return false;
+        }
+
+        decodedModule.versioned = versioned == 1;
+        decodedModule.parsedModule = parsedModule;
+    }
+
+    // The topological sort contains every module once
+    std::size_t toposortCount;
+    if (!reader.readIndex(toposortCount, moduleCount + 1) || toposortCount != moduleCount) {
+        return false;
+    }
+
+    std::vector<std::size_t> toposort(toposortCount);
+    std::vector<bool> sorted(moduleCount, false);
+    for (std::size_t &handle : toposort) {
+        if (!reader.readIndex(handle, moduleCount) || sorted[handle]) {
+            return false;
+        }
+
+        sorted[handle] = true;
+    }
+
+    // Blocks are sorted and disjoint (mapLine() binary searches them), and map existing module lines
+    std::size_t blockCount;
+    if (!reader.readIndex(blockCount, INT_MAX) || !reader.fits(blockCount, 20) || hoistedLinesCount > blockCount) {
+        return false;
+    }
+
+    std::vector<DecodedBlock> blocks(blockCount);
+    long long previousEnd = -1;
+    for (DecodedBlock &decodedBlock : blocks) {
+        std::size_t moduleBegin, moduleEnd, assembledBegin, assembledEnd;
+        if (!reader.readIndex(decodedBlock.moduleHandle, moduleCount)) {
+            return false;
+        }
+
+        const std::size_t lineCount = modules[decodedBlock.moduleHandle].parsedModule->getSourceLinesCount();
+        if (!reader.readIndex(moduleBegin, lineCount) || !reader.readIndex(moduleEnd, lineCount) || moduleBegin > moduleEnd ||
+            !reader.readIndex(assembledBegin, INT_MAX) || !reader.readIndex(assembledEnd, INT_MAX) || assembledBegin > assembledEnd ||
+            static_cast<long long>(assembledBegin) <= previousEnd) {
+            return false;
+        }
+
+        decodedBlock.block.moduleRange.begin = moduleBegin;
+        decodedBlock.block.moduleRange.end = moduleEnd;
+        decodedBlock.block.assembledRange.begin = assembledBegin;
+        decodedBlock.block.assembledRange.end = assembledEnd;
+        previousEnd = assembledEnd;
+    }
+
+    // With minify, one minifier state per block after the hoisted lines
+    std::size_t stateCount;
+    const std::size_t expectedStateCount = (options & OPTION_MINIFY) ? blockCount - hoistedLinesCount : 0;
+    if (!reader.readIndex(stateCount, INT_MAX) || stateCount != expectedStateCount || !reader.fits(stateCount, 1)) {
+        return false;
+    }
+
+    std::vector<SourceMinifier::State> minifiedBlockStates(stateCount);
+    for (SourceMinifier::State &state : minifiedBlockStates) {
+        std::uint64_t flags;
+        if (!reader.read(flags, 1) || flags > 3) {
+            return false;
+        }
+
+        state.inBlockComment = (flags & 1) != 0;
+        state.continued = (flags & 2) != 0;
+    }
+
+    std::size_t sourceOffset, sourceSize;
+    if (!reader.readRange(sourceOffset, sourceSize, 8) || sourceSize != assembledSourceSize || !reader.atEnd()) {
+        return false;
+    }
+
+    // Replace the graph
+    moduleGraph.destroy();
+    std::vector<Module *> created(moduleCount);
+    for (std::size_t handle = 0; handle < moduleCount; handle++) {
+        Module *module = Module::fromParsedModule(modules[handle].parsedModule, moduleGraph.arena);
+        if (modules[handle].versioned) {
+            module->setVersion(modules[handle].version);
+        }
+
+        moduleGraph.modules.add(module);
+        created[handle] = module;
+    }
+
+    for (std::size_t handle = 0; handle < moduleCount; handle++) {
+        for (int i = 0; i < created[handle]->getDependencyCount(); i++) {
+            Module::Dependency &dependency = created[handle]->getDependency(i);
+            dependency.moduleHandle = modules[handle].dependencyHandles[i];
+            dependency.module = created[dependency.moduleHandle];
+            dependency.moduleId = dependency.module->getId();
+        }
+    }
+
+    moduleGraph.toposort.reserve(toposort.size());
+    for (const std::size_t handle : toposort) {
+        moduleGraph.toposort.push_back(created[handle]);
+    }
+
+    moduleGraph.assembledSourceBlocks.reserve(blocks.size());
+    for (DecodedBlock &decodedBlock : blocks) {
+        decodedBlock.block.module = created[decodedBlock.moduleHandle];
+        moduleGraph.assembledSourceBlocks.push_back(decodedBlock.block);
+    }
+
+    for (int i = 0; i < moduleGraph.assembledSourceBlocks.size(); i++) {
+        moduleGraph.moduleSourceBlocks[moduleGraph.assembledSourceBlocks[i].module].push_back(i);
+    }
+
+    moduleGraph.minifiedBlockStates.swap(minifiedBlockStates);
+    moduleGraph.treeShaking = (options & OPTION_TREE_SHAKING) != 0;
+    moduleGraph.minify = (options & OPTION_MINIFY) != 0;
+    moduleGraph.programHash = programHash;
+    moduleGraph.assembledSourceSize = assembledSourceSize;
+    moduleGraph.hoistedLinesCount = hoistedLinesCount;
+    moduleGraph.rootModuleId = rootModuleId;
+    moduleGraph.failedModuleId.clear();
+    moduleGraph.includeDir = includeDir;
+    if (moduleGraph.keepAssembledSource) {
+        moduleGraph.assembledSource.assign(data + sourceOffset, sourceSize);
+    }
+
+    return true;
+}
+
+void GraphSnapshot::save(const ModuleGraph &moduleGraph, const std::string &path) {
+    const std::string buffer = encode(moduleGraph);
+
+    // Write a temporary file, then replace the snapshot file, so that readers (and mappings) never see a partial file
+    const std::string temporaryPath = temporaryPathOf(path);
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(buffer.data(), buffer.size());
+        file.close();
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Cannot write snapshot " + temporaryPath);
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        // Some platforms do not replace existing files
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::remove(temporaryPath.c_str());
+            throw std::runtime_error("Cannot write snapshot " + path);
+        }
+    }
+}
+
+bool GraphSnapshot::load(ModuleGraph &moduleGraph, const std::string &path) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return decode(moduleGraph, SourceBuffer::fromString(std::move(contents)));
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays alive as long as a restored module refers to it
+    const std::size_t size = fileStat.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const std::shared_ptr<const void> owner(mapping, [size](void *mapping) {
+        munmap(mapping, size);
+    });
+
+    return decode(moduleGraph, SourceBuffer(static_cast<const char *>(mapping), size, owner));
+#endif
+}
@@ -0,0 +1,110 @@
+#include <glsl_assembler/hash.h>
+#include <cstring>
+
+namespace Hash {
+    // https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+    static const std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    static const std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    static const std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    static const std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    static const std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    static inline std::uint64_t rotl(const std::uint64_t value, const int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // Little endian reads, whatever the platform
+    static inline std::uint64_t read64(const unsigned char *data) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined(_MSC_VER)
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+#else
+        std::uint64_t value = 0;
+        for (int i = 7; i >= 0; i--) {
+            value = (value << 8) | data[i];
+        }
+
+        return value;
+#endif
+    }
+
+    static inline std::uint64_t read32(const unsigned char *data) {
+        return static_cast<std::uint64_t>(data[0]) | static_cast<std::uint64_t>(data[1]) << 8 |
+               static_cast<std::uint64_t>(data[2]) << 16 | static_cast<std::uint64_t>(data[3]) << 24;
+    }
+
+    static inline std::uint64_t round(std::uint64_t accumulator, const std::uint64_t input) {
+        accumulator += input * PRIME64_2;
+        accumulator = rotl(accumulator, 31);
+        return accumulator * PRIME64_1;
+    }
+
+    static inline std::uint64_t mergeRound(std::uint64_t accumulator, const std::uint64_t value) {
+        accumulator ^= round(0, value);
+        return accumulator * PRIME64_1 + PRIME64_4;
+    }
+
+    std::uint64_t xxh64(const char *data, const std::size_t size, const std::uint64_t seed) {
+        const unsigned char *input = reinterpret_cast<const unsigned char *>(data);
+        const unsigned char *end = input + size;
+        std::uint64_t hash;
+
+        if (size >= 32) {
+            // 4 independent lanes of 8 bytes
+            std::uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+            std::uint64_t v2 = seed + PRIME64_2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - PRIME64_1;
+            const unsigned char *limit = end - 32;
+            do {
+                v1 = round(v1, read64(input));
+                v2 = round(v2, read64(input + 8));
+                v3 = round(v3, read64(input + 16));
+                v4 = round(v4, read64(input + 24));
+                input += 32;
+            } while (input <= limit);
+
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        } else {
+            hash = seed + PRIME64_5;
+        }
+
+        hash += size;
+
+        // Remaining bytes
+        while (input + 8 <= end) {
+            hash ^= round(0, read64(input));
+            hash = rotl(hash, 27) * PRIME64_1 + PRIME64_4;
+            input += 8;
+        }
+
+        if (input + 4 <= end) {
+            hash ^= read32(input) * PRIME64_1;
+            hash = rotl(hash, 23) * PRIME64_2 + PRIME64_3;
+            input += 4;
+        }
+
+        while (input < end) {
+            hash ^= *input * PRIME64_5;
+            hash = rotl(hash, 11) * PRIME64_1;
+            input++;
+        }
+
+        // Avalanche
+        hash ^= hash >> 33;
+        hash *= PRIME64_2;
+        hash ^= hash >> 29;
+        hash *= PRIME64_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    std::uint64_t combine(const std::uint64_t hash, const std::uint64_t value) {
+        return mergeRound(hash, value);
+    }
+}
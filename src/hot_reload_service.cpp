@@ -0,0 +1,297 @@
+#include <glsl_assembler/hot_reload_service.h>
+#include <glsl_assembler/file_module_loader.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+const int HotReloadService::DEFAULT_DEBOUNCE_MS;
+
+namespace {
+    // Writes, and files replaced or removed through their directory
+    const std::uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+    /**
+     * Splits a file path into its canonical directory and its name.
+     * @return the canonical directory, or an empty string if the directory does not exist
+     */
+    std::string canonicalDirectory(const std::string &filePath, std::string &name) {
+        const std::string::size_type separator = filePath.rfind('/');
+        std::string directory;
+        if (separator == std::string::npos) {
+            directory = ".";
+            name = filePath;
+        } else {
+            directory = separator == 0 ? "/" : filePath.substr(0, separator);
+            name = filePath.substr(separator + 1);
+        }
+
+        char canonical[PATH_MAX];
+        if (!realpath(directory.c_str(), canonical)) {
+            return "";
+        }
+
+        return canonical;
+    }
+
+    std::string joinPath(const std::string &directory, const std::string &name) {
+        return directory == "/" ? "/" + name : directory + "/" + name;
+    }
+
+    std::string directoryOf(const std::string &file) {
+        const std::string::size_type separator = file.rfind('/');
+        return separator == 0 ? "/" : file.substr(0, separator);
+    }
+}
+
+HotReloadService::HotReloadService()
+    : inotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+      debounce(std::chrono::milliseconds(DEFAULT_DEBOUNCE_MS)) {
+    if (inotifyFd < 0) {
+        throw std::runtime_error(std::string("Cannot initialize inotify: ") + std::strerror(errno));
+    }
+}
+
+HotReloadService::~HotReloadService() {
+    // Closing the descriptor removes all the watches
+    close(inotifyFd);
+}
+
+std::string HotReloadService::getFile(const ModuleGraph *moduleGraph, const std::string &moduleId) const {
+    const FileModuleLoader *fileLoader = dynamic_cast<const FileModuleLoader *>(moduleGraph->getModuleLoader());
+    const std::string filePath = fileLoader ? fileLoader->getFilePath(moduleId) : moduleId;
+    std::string name;
+    const std::string directoryPath = canonicalDirectory(filePath, name);
+    return directoryPath.empty() ? directoryPath : joinPath(directoryPath, name);
+}
+
+HotReloadService::Directory &HotReloadService::watchDirectory(const std::string &directoryPath) {
+    Directory &directory = directories[directoryPath];
+    if (directory.watch < 0) {
+        directory.watch = inotify_add_watch(inotifyFd, directoryPath.c_str(), WATCH_MASK);
+        if (directory.watch >= 0) {
+            watchDirectories[directory.watch] = directoryPath;
+        }
+    }
+
+    return directory;
+}
+
+void HotReloadService::watchFile(ModuleGraph *moduleGraph, const std::string &file) {
+    watchDirectory(directoryOf(file)).fileCount++;
+    fileGraphs[file].push_back(moduleGraph);
+}
+
+void HotReloadService::unwatchFile(ModuleGraph *moduleGraph, const std::string &file) {
+    const auto fileIt = fileGraphs.find(file);
+    std::vector<ModuleGraph *> &graphs = fileIt->second;
+    graphs.erase(std::find(graphs.begin(), graphs.end(), moduleGraph));
+    if (graphs.empty()) {
+        fileGraphs.erase(fileIt);
+    }
+
+    // Stop watching directories without files
+    const auto directoryIt = directories.find(directoryOf(file));
+    Directory &directory = directoryIt->second;
+    if (--directory.fileCount == 0) {
+        if (directory.watch >= 0) {
+            inotify_rm_watch(inotifyFd, directory.watch);
+            watchDirectories.erase(directory.watch);
+        }
+
+        directories.erase(directoryIt);
+    }
+}
+
+void HotReloadService::watchGraph(ModuleGraph *moduleGraph) {
+    std::vector<std::string> files;
+    for (const Module *module : *moduleGraph) {
+        std::string file = getFile(moduleGraph, module->getId());
+        if (!file.empty()) {
+            files.push_back(std::move(file));
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    // Watch the new files before unwatching the removed ones, so that shared directories keep their watch
+    std::vector<std::string> &oldFiles = graphFiles[moduleGraph];
+    std::vector<std::string> changedFiles;
+    std::set_difference(files.begin(), files.end(), oldFiles.begin(), oldFiles.end(), std::back_inserter(changedFiles));
+    for (const std::string &file : changedFiles) {
+        watchFile(moduleGraph, file);
+    }
+
+    changedFiles.clear();
+    std::set_difference(oldFiles.begin(), oldFiles.end(), files.begin(), files.end(), std::back_inserter(changedFiles));
+    for (const std::string &file : changedFiles) {
+        unwatchFile(moduleGraph, file);
+    }
+
+    // Watch again the directories which have been removed and created again
+    for (const std::string &file : files) {
+        watchDirectory(directoryOf(file));
+    }
+
+    oldFiles.swap(files);
+}
+
+void HotReloadService::unwatchGraph(ModuleGraph *moduleGraph) {
+    const auto it = graphFiles.find(moduleGraph);
+    if (it == graphFiles.end()) {
+        return;
+    }
+
+    for (const std::string &file : it->second) {
+        unwatchFile(moduleGraph, file);
+    }
+
+    graphFiles.erase(it);
+}
+
+void HotReloadService::addGraph(ModuleGraph *moduleGraph) {
+    unwatchGraph(moduleGraph);
+    watchGraph(moduleGraph);
+}
+
+void HotReloadService::removeGraph(ModuleGraph *moduleGraph) {
+    unwatchGraph(moduleGraph);
+    pendingGraphs.erase(moduleGraph);
+}
+
+void HotReloadService::fileChanged(const std::string &filePath, const Clock::time_point time) {
+    const auto it = fileGraphs.find(filePath);
+    if (it == fileGraphs.end()) {
+        return;
+    }
+
+    statistics.events++;
+    lastEventTime = time;
+    for (ModuleGraph *moduleGraph : it->second) {
+        // Keeps the time of the first event
+        pendingGraphs.emplace(moduleGraph, time);
+    }
+}
+
+void HotReloadService::readEvents(const Clock::duration timeout) {
+    if (timeout > Clock::duration::zero()) {
+        struct pollfd descriptor;
+        descriptor.fd = inotifyFd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        // Rounded up to milliseconds
+        const auto timeoutMs = std::chrono::duration_cast<std::chrono::milliseconds>(timeout + std::chrono::milliseconds(1) - Clock::duration(1));
+        ::poll(&descriptor, 1, timeoutMs.count());
+    }
+
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    while (true) {
+        const ssize_t size = read(inotifyFd, buffer, sizeof(buffer));
+        if (size <= 0) {
+            // EAGAIN: no more events
+            return;
+        }
+
+        const Clock::time_point now = Clock::now();
+        for (const char *pointer = buffer; pointer < buffer + size;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(pointer);
+            pointer += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events have been lost: reload everything
+                statistics.events++;
+                lastEventTime = now;
+                for (const auto &graph : graphFiles) {
+                    pendingGraphs.emplace(graph.first, now);
+                }
+            } else if (event->mask & IN_IGNORED) {
+                // The directory has been removed: it will be watched again by the next reload of its graphs
+                const auto it = watchDirectories.find(event->wd);
+                if (it != watchDirectories.end()) {
+                    directories[it->second].watch = -1;
+                    watchDirectories.erase(it);
+                }
+            } else if (event->len > 0) {
+                const auto it = watchDirectories.find(event->wd);
+                if (it != watchDirectories.end()) {
+                    fileChanged(joinPath(it->second, event->name), now);
+                }
+            }
+        }
+    }
+}
+
+int HotReloadService::reloadPendingGraphs() {
+    std::unordered_map<ModuleGraph *, Clock::time_point> graphs;
+    graphs.swap(pendingGraphs);
+
+    int count = 0;
+    for (const auto &pending : graphs) {
+        // The graph may have been removed by a callback
+        ModuleGraph *moduleGraph = pending.first;
+        if (graphFiles.find(moduleGraph) == graphFiles.end()) {
+            continue;
+        }
+
+        count++;
+        std::vector<std::string> touchedModules;
+        try {
+            if (moduleGraph->reload(touchedModules)) {
+                // Modules may have been added or removed, reclaim their memory
+                moduleGraph->compact();
+                watchGraph(moduleGraph);
+
+                const Clock::duration latency = Clock::now() - pending.second;
+                statistics.reloads++;
+                statistics.lastLatency = latency;
+                statistics.maxLatency = std::max(statistics.maxLatency, latency);
+                statistics.totalLatency += latency;
+                if (reloadCallback) {
+                    reloadCallback(moduleGraph, touchedModules);
+                }
+            }
+        } catch (const std::exception &e) {
+            // The files are still watched, so the graph is reloaded again on the next change. A module that could not
+            // be loaded (e.g. a missing include) is watched as well, so that creating it reloads the graph.
+            const std::string file = moduleGraph->getFailedModuleId().empty() ? std::string() : getFile(moduleGraph, moduleGraph->getFailedModuleId());
+            std::vector<std::string> &files = graphFiles[moduleGraph];
+            const auto position = std::lower_bound(files.begin(), files.end(), file);
+            if (!file.empty() && (position == files.end() || *position != file)) {
+                files.insert(position, file);
+                watchFile(moduleGraph, file);
+            }
+
+            statistics.failures++;
+            if (errorCallback) {
+                errorCallback(moduleGraph, e.what());
+            }
+        }
+    }
+
+    return count;
+}
+
+int HotReloadService::poll(const int timeoutMs) {
+    Clock::duration timeout = std::chrono::milliseconds(std::max(timeoutMs, 0));
+    if (!pendingGraphs.empty()) {
+        // Do not wait past the end of the debounce interval
+        const Clock::duration remaining = lastEventTime + debounce - Clock::now();
+        timeout = std::max(Clock::duration::zero(), std::min(timeout, remaining));
+    }
+
+    readEvents(timeout);
+    if (pendingGraphs.empty() || Clock::now() - lastEventTime < debounce) {
+        return 0;
+    }
+
+    return reloadPendingGraphs();
+}
@@ -0,0 +1,207 @@
+#include <glsl_assembler/info_log_rewriter.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/thread_pool.h>
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    bool isDigit(const char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    /**
+     * Characters which cannot surround a line reference: a number glued to them is part of something else
+     * (identifier, float, version...).
+     */
+    bool isWordCharacter(const char c) {
+        return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    /**
+     * Parses the digits starting at an offset, and moves the offset past them.
+     * @return false if there is no digit, or if the number does not fit in an int
+     */
+    bool parseNumber(const StringView &text, std::size_t &offset, int &value) {
+        const std::size_t begin = offset;
+        bool overflow = false;
+        value = 0;
+        for (; offset < text.size() && isDigit(text[offset]); offset++) {
+            const int digit = text[offset] - '0';
+            if (value > (INT_MAX - digit) / 10) {
+                overflow = true;
+            } else {
+                value = value * 10 + digit;
+            }
+        }
+
+        return offset != begin && !overflow;
+    }
+
+    /**
+     * Parses the line reference starting at an offset (<code>S(L)</code> or <code>S:L</code>).
+     * @param end will contain the offset past the reference, or past the parsed digits if it is not a reference
+     * @return true if a reference has been parsed
+     */
+    bool parseReference(const StringView &infoLog, const std::size_t offset, std::size_t &end, int &sourceString, int &line) {
+        end = offset;
+        if (!parseNumber(infoLog, end, sourceString) || end == infoLog.size()) {
+            return false;
+        }
+
+        std::size_t lineEnd = end + 1;
+        if (infoLog[end] == '(') {
+            if (!parseNumber(infoLog, lineEnd, line) || lineEnd == infoLog.size() || infoLog[lineEnd] != ')') {
+                return false;
+            }
+
+            end = lineEnd + 1;
+            return true;
+        }
+
+        if (infoLog[end] == ':') {
+            if (!parseNumber(infoLog, lineEnd, line)) {
+                return false;
+            }
+
+            // A float (0:1.5) or an identifier (0:1x) is not a reference
+            const bool glued = lineEnd < infoLog.size() && (isWordCharacter(infoLog[lineEnd])
+                || (infoLog[lineEnd] == '.' && lineEnd + 1 < infoLog.size() && isDigit(infoLog[lineEnd + 1])));
+            if (glued) {
+                return false;
+            }
+
+            end = lineEnd;
+            return true;
+        }
+
+        return false;
+    }
+}
+
+InfoLogRewriter::InfoLogRewriter(const ModuleGraph &moduleGraph)
+    : moduleGraph(moduleGraph) {
+}
+
+int InfoLogRewriter::findReferences(const StringView infoLog, std::vector<Reference> &references, const VariantAssembler::Variant *variant) const {
+    if (variant && variant->moduleGraph != &moduleGraph) {
+        throw std::runtime_error("The variant has not been assembled from the graph of the rewriter");
+    }
+
+    references.clear();
+    std::size_t offset = 0;
+    while (offset < infoLog.size()) {
+        if (!isDigit(infoLog[offset])) {
+            offset++;
+            continue;
+        }
+
+        // Digits within a word (vec4, 1.0...) never start a reference
+        const std::size_t begin = offset;
+        const bool boundary = begin == 0 || !(isWordCharacter(infoLog[begin - 1]) || infoLog[begin - 1] == '.');
+        int string;
+        int line;
+        const bool parsed = parseReference(infoLog, begin, offset, string, line);
+        if (boundary && parsed && string == sourceString && line > 0) {
+            Reference reference;
+            reference.offset = begin;
+            reference.length = offset - begin;
+            reference.line = line - 1;
+            references.push_back(reference);
+        }
+    }
+
+    // Lines of the graph source, sorted: the variant define lines have none
+    std::vector<std::pair<int, int>> sortedLines;
+    sortedLines.reserve(references.size());
+    for (int i = 0; i < references.size(); i++) {
+        int line = references[i].line;
+        if (variant) {
+            const int defineCount = static_cast<int>(variant->defines.size());
+            if (line >= variant->defineLinesBegin && line < variant->defineLinesBegin + defineCount) {
+                continue;
+            }
+
+            if (line >= variant->defineLinesBegin) {
+                line -= defineCount;
+            }
+        }
+
+        sortedLines.emplace_back(line, i);
+    }
+
+    if (!std::is_sorted(sortedLines.begin(), sortedLines.end())) {
+        std::sort(sortedLines.begin(), sortedLines.end());
+    }
+
+    // Single sweep: the blocks are sorted by assembled line and do not overlap
+    const int blockCount = moduleGraph.getSourceBlocksCount();
+    int mapped = 0;
+    int blockIndex = 0;
+    for (const std::pair<int, int> &sortedLine : sortedLines) {
+        const int line = sortedLine.first;
+        while (blockIndex + 1 < blockCount && moduleGraph.getSourceBlock(blockIndex + 1).assembledRange.begin <= line) {
+            blockIndex++;
+        }
+
+        if (blockIndex < blockCount) {
+            const ModuleGraph::SourceBlock &sourceBlock = moduleGraph.getSourceBlock(blockIndex);
+            if (sourceBlock.contains(line)) {
+                Reference &reference = references[sortedLine.second];
+                reference.module = sourceBlock.module;
+                reference.moduleLine = sourceBlock.mapLine(line);
+                mapped++;
+            }
+        }
+    }
+
+    return mapped;
+}
+
+std::string InfoLogRewriter::rewrite(const StringView infoLog, const VariantAssembler::Variant *variant) const {
+    std::vector<Reference> references;
+    if (findReferences(infoLog, references, variant) == 0) {
+        return infoLog.str();
+    }
+
+    std::string rewritten;
+    rewritten.reserve(infoLog.size() + infoLog.size() / 2);
+    std::size_t copied = 0;
+    for (const Reference &reference : references) {
+        if (!reference.module) {
+            continue;
+        }
+
+        rewritten.append(infoLog.data() + copied, reference.offset - copied);
+        rewritten += reference.module->getId();
+        rewritten += ':';
+        rewritten += std::to_string(reference.moduleLine + 1);
+        copied = reference.offset + reference.length;
+    }
+
+    rewritten.append(infoLog.data() + copied, infoLog.size() - copied);
+    return rewritten;
+}
+
+std::vector<std::string> InfoLogRewriter::rewriteAll(const std::vector<std::string> &infoLogs, const std::vector<VariantAssembler::Variant> &variants, ThreadPool *threadPool) const {
+    if (infoLogs.size() != variants.size()) {
+        throw std::runtime_error("Expected " + std::to_string(infoLogs.size()) + " variants, got " + std::to_string(variants.size()));
+    }
+
+    std::vector<std::string> rewrittenLogs(infoLogs.size());
+    const auto rewriteLog = [&](const int index) {
+        rewrittenLogs[index] = rewrite(infoLogs[index], &variants[index]);
+    };
+
+    if (threadPool) {
+        threadPool->parallelFor(infoLogs.size(), rewriteLog);
+    } else {
+        for (int i = 0; i < infoLogs.size(); i++) {
+            rewriteLog(i);
+        }
+    }
+
+    return rewrittenLogs;
+}
@@ -1,85 +1,39 @@
 #include <glsl_assembler/module.h>
-#include <glsl_assembler/string_utils.h>
-#include <regex>
 
-Module::Module() {
+Module::Module(Arena *arena)
+    : dependencies(ArenaAllocator<Dependency>(arena)) {
 }
 
 Module *Module::fromSource(const std::string &id, const std::string &source) {
-    Module *module = new Module();
-    module->sourceLines = StringUtils::splitLines(source);
-    module->id = id;
-    module->analyzeDependencies();
-
-    return module;
-}
-
-void Module::commentLine(int index) {
-    sourceLines[index] = "// " + sourceLines[index];
+    return fromParsedModule(ParsedModule::parse(id, source));
 }
 
-void Module::hoistLine(int index) {
-    HoistedLine hoistedLine;
-    hoistedLine.line = sourceLines[index];
-    hoistedLine.index = index;
-    hoistLines.push_back(hoistedLine);
+Module *Module::fromParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule) {
+    Module *module = new Module(nullptr);
+    module->setParsedModule(parsedModule);
 
-    commentLine(index);
+    return module;
 }
 
-void Module::analyzeDependencies() {
-    dependencies.clear();
-
-    const std::regex relativeRegex(R"(^#include \"((\\.|[^\"])*)\"$)");
-    const std::regex absoluteRegex(R"(^#include <((\\.|[^\"])*)>$)");
-    for (int i = 0; i < sourceLines.size(); i++) {
-        const std::string line = StringUtils::trim_copy(sourceLines[i]);
+Module *Module::fromParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule, Arena &arena) {
+    Module *module = new (arena.allocate(sizeof(Module), alignof(Module))) Module(&arena);
+    module->setParsedModule(parsedModule);
 
-        // Skip commented lines (block comments are not supported)
-        if (StringUtils::startsWith(line, "//")) {
-            continue;
-        }
+    return module;
+}
 
-        // Handle includes
-        auto relativeIncludesBegin = std::sregex_iterator(line.begin(), line.end(), relativeRegex);
-        auto relativeIncludesEnd = std::sregex_iterator();
-        if (relativeIncludesBegin != relativeIncludesEnd) {
-            for (std::sregex_iterator j = relativeIncludesBegin; j != relativeIncludesEnd; j++) {
-                const std::string relativeInclude = j->str(1);
-                if (!relativeInclude.empty()) {
-                    dependencies.emplace_back(Dependency::relative(relativeInclude, i));
-                    commentLine(i);
-                    break;
-                } else {
-                    throw std::runtime_error("Error '" + id + "'(" + std::to_string(i + 1) + "): invalid #include syntax.");
-                }
-            }
-        } else {
-            auto absoluteIncludesBegin = std::sregex_iterator(line.begin(), line.end(), absoluteRegex);
-            auto absoluteIncludesEnd = std::sregex_iterator();
-            if (absoluteIncludesBegin != absoluteIncludesEnd) {
-                for (std::sregex_iterator j = absoluteIncludesBegin; j != absoluteIncludesEnd; j++) {
-                    const std::string absoluteInclude = j->str(1);
-                    if (!absoluteInclude.empty()) {
-                        dependencies.emplace_back(Dependency::absolute(absoluteInclude, i));
-                        commentLine(i);
-                        break;
-                    } else {
-                        throw std::runtime_error("Error '" + id + "'(" + std::to_string(i + 1) + "): invalid #include syntax.");
-                    }
-                }
-            }
-        }
+void Module::setParsedModule(const std::shared_ptr<const ParsedModule> &parsedModule) {
+    this->parsedModule = parsedModule;
+    hasVersion = false;
 
-        // Handle hoisting
-        if (StringUtils::startsWith(line, "#version") || StringUtils::startsWith(line, "precision")) {
-            hoistLine(i);
-        }
+    dependencies.clear();
+    dependencies.reserve(parsedModule->getIncludeCount());
+    for (int i = 0; i < parsedModule->getIncludeCount(); i++) {
+        const ParsedModule::Include &include = parsedModule->getInclude(i);
+        dependencies.emplace_back(
+            include.type == ParsedModule::Include::Type::ABSOLUTE ?
+            Dependency::absolute(include.path, include.line) :
+            Dependency::relative(include.path, include.line)
+        );
     }
 }
-
-void Module::inject(std::vector<std::string> &lines) const {
-    lines.push_back("// MODULE BEGIN: " + id);
-    lines.insert(lines.end(), sourceLines.begin(), sourceLines.end());
-    lines.emplace_back("");
-}
@@ -0,0 +1,250 @@
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/hash.h>
+#include <algorithm>
+#include <iterator>
+
+ModuleCache::ModuleCache(const std::size_t memoryBudget)
+    : memoryBudget(memoryBudget) {
+}
+
+ModuleCache::EntryIterator ModuleCache::findEntry(const std::string &id, const std::uint64_t sourceHash, const std::size_t sourceSize) {
+    const auto it = index.find(id);
+    if (it != index.end()) {
+        for (const EntryIterator entry : it->second) {
+            if (entry->module->getSourceHash() == sourceHash && entry->module->getSourceSize() == sourceSize) {
+                return entry;
+            }
+        }
+    }
+
+    return entries.end();
+}
+
+void ModuleCache::touch(const EntryIterator entry) {
+    entries.splice(entries.begin(), entries, entry);
+}
+
+void ModuleCache::remove(const EntryIterator entry) {
+    const auto it = index.find(entry->module->getId());
+    std::vector<EntryIterator> &idEntries = it->second;
+    idEntries.erase(std::find(idEntries.begin(), idEntries.end(), entry));
+    if (idEntries.empty()) {
+        index.erase(it);
+    }
+
+    if (entry->superseded) {
+        supersededEntries.erase(std::find(supersededEntries.begin(), supersededEntries.end(), entry));
+    }
+
+    memoryUsage -= entry->memoryUsage;
+    entries.erase(entry);
+}
+
+void ModuleCache::supersede(const EntryIterator latest) {
+    // A previous source can become the latest one again (e.g. when an edit is reverted)
+    if (latest->superseded) {
+        latest->superseded = false;
+        supersededEntries.erase(std::find(supersededEntries.begin(), supersededEntries.end(), latest));
+    }
+
+    // Only the cache holds the modules which are not used anymore
+    std::vector<EntryIterator> unused;
+    for (const EntryIterator entry : index[latest->module->getId()]) {
+        if (entry == latest) {
+            continue;
+        }
+
+        if (entry->module.use_count() == 1) {
+            unused.push_back(entry);
+        } else if (!entry->superseded) {
+            entry->superseded = true;
+            supersededEntries.push_back(entry);
+        }
+    }
+
+    for (const EntryIterator entry : unused) {
+        remove(entry);
+        statistics.superseded++;
+    }
+}
+
+void ModuleCache::purge() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<EntryIterator> unused;
+    for (const EntryIterator entry : supersededEntries) {
+        if (entry->module.use_count() == 1) {
+            unused.push_back(entry);
+        }
+    }
+
+    for (const EntryIterator entry : unused) {
+        remove(entry);
+        statistics.superseded++;
+    }
+}
+
+void ModuleCache::evict() {
+    while (memoryBudget > 0 && memoryUsage > memoryBudget && entries.size() > 1) {
+        remove(std::prev(entries.end()));
+        statistics.evictions++;
+    }
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::acquire(const std::string &id, const SourceBuffer &source, const std::uint64_t *version) {
+    const std::uint64_t sourceHash = Hash::xxh64(source.data(), source.size());
+    const ParsingKey key(id, sourceHash, source.size());
+    std::promise<std::shared_ptr<const ParsedModule>> promise;
+    std::shared_future<std::shared_ptr<const ParsedModule>> future;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const EntryIterator entry = findEntry(id, sourceHash, source.size());
+        if (entry != entries.end()) {
+            if (version) {
+                entry->version = *version;
+                entry->hasVersion = true;
+            }
+
+            touch(entry);
+            supersede(entry);
+            statistics.hits++;
+            return entry->module;
+        }
+
+        const auto it = parsing.find(key);
+        if (it != parsing.end()) {
+            future = it->second;
+        } else {
+            parsing.emplace(key, promise.get_future().share());
+        }
+    }
+
+    // Another thread is parsing the same module: wait for it
+    if (future.valid()) {
+        std::shared_ptr<const ParsedModule> module = future.get();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.hits++;
+        const EntryIterator entry = findEntry(id, sourceHash, source.size());
+        if (entry != entries.end() && version) {
+            entry->version = *version;
+            entry->hasVersion = true;
+        }
+
+        return module;
+    }
+
+    // Parse without holding the lock
+    std::shared_ptr<const ParsedModule> module;
+    try {
+        module = ParsedModule::parse(id, source, getAnalysisCache());
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            statistics.misses++;
+            parsing.erase(key);
+        }
+
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        statistics.misses++;
+        parsing.erase(key);
+
+        entries.emplace_front();
+        const EntryIterator entry = entries.begin();
+        entry->module = module;
+        entry->memoryUsage = module->getMemoryUsage();
+        if (version) {
+            entry->version = *version;
+            entry->hasVersion = true;
+        }
+
+        index[id].push_back(entry);
+        memoryUsage += entry->memoryUsage;
+        supersede(entry);
+        evict();
+    }
+
+    promise.set_value(module);
+    return module;
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::acquire(const std::string &id, const std::string &source) {
+    return acquire(id, SourceBuffer::fromString(source), nullptr);
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::acquire(const std::string &id, const std::string &source, const std::uint64_t version) {
+    return acquire(id, SourceBuffer::fromString(source), &version);
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::acquire(const std::string &id, const SourceBuffer &source) {
+    return acquire(id, source, nullptr);
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::acquire(const std::string &id, const SourceBuffer &source, const std::uint64_t version) {
+    return acquire(id, source, &version);
+}
+
+std::shared_ptr<const ParsedModule> ModuleCache::find(const std::string &id, const std::uint64_t version) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = index.find(id);
+    if (it != index.end()) {
+        for (const EntryIterator entry : it->second) {
+            if (entry->hasVersion && entry->version == version) {
+                touch(entry);
+                supersede(entry);
+                statistics.hits++;
+                return entry->module;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+void ModuleCache::setMemoryBudget(const std::size_t memoryBudget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->memoryBudget = memoryBudget;
+    evict();
+}
+
+std::size_t ModuleCache::getMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryBudget;
+}
+
+std::size_t ModuleCache::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+}
+
+int ModuleCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+ModuleCache::Statistics ModuleCache::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void ModuleCache::setAnalysisCache(AnalysisCache *analysisCache) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->analysisCache = analysisCache;
+}
+
+AnalysisCache *ModuleCache::getAnalysisCache() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return analysisCache;
+}
+
+void ModuleCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    supersededEntries.clear();
+    memoryUsage = 0;
+}
@@ -1,12 +1,26 @@
 #include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/assembly_sink.h>
+#include <glsl_assembler/graph_snapshot.h>
+#include <glsl_assembler/hash.h>
 #include <glsl_assembler/module.h>
+#include <glsl_assembler/module_cache.h>
 #include <glsl_assembler/module_loader.h>
+#include <glsl_assembler/profiler.h>
+#include <glsl_assembler/source_buffer.h>
+#include <glsl_assembler/source_minifier.h>
 #include <glsl_assembler/string_utils.h>
-#include <queue>
+#include <glsl_assembler/thread_pool.h>
+#include <glsl_assembler/tree_shaker.h>
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
-ModuleGraph::ModuleGraph() {
+ModuleGraph::ModuleGraph()
+    : moduleLoader(nullptr),
+      moduleCache(nullptr),
+      threadPool(nullptr),
+      analysisCache(nullptr),
+      profiler(nullptr) {
 }
 
 ModuleGraph::~ModuleGraph() {
@@ -14,28 +28,36 @@ ModuleGraph::~ModuleGraph() {
 }
 
 void ModuleGraph::destroy() {
-    for (const Module *module : modules) {
-        delete module;
+    for (Module *module : modules) {
+        destroyModule(module);
     }
 
     modules.clear();
+    arena.release();
     toposort.clear();
     assembledSource = "";
+    assembledSourceSize = 0;
+    programHash = 0;
+    hoistedLinesCount = 0;
     assembledSourceBlocks.clear();
+    moduleSourceBlocks.clear();
 }
 
 Module *ModuleGraph::findModule(const std::string &id) {
-    for (Module *module : modules) {
-        if (module->getId() == id) {
-            return module;
-        }
-    }
-
-    return nullptr;
+    return getModule(modules.find(id));
 }
 
 Module *ModuleGraph::mapLine(const int assembledLine, int &moduleLine) const {
-    for (const SourceBlock &sourceBlock : assembledSourceBlocks) {
+    // Find the last block starting at or before the line
+    const auto it = std::upper_bound(
+        assembledSourceBlocks.begin(),
+        assembledSourceBlocks.end(),
+        assembledLine,
+        [](const int line, const SourceBlock &sourceBlock) { return line < sourceBlock.assembledRange.begin; }
+    );
+
+    if (it != assembledSourceBlocks.begin()) {
+        const SourceBlock &sourceBlock = *(it - 1);
         if (sourceBlock.contains(assembledLine)) {
             moduleLine = sourceBlock.mapLine(assembledLine);
             return sourceBlock.module;
@@ -46,6 +68,312 @@ Module *ModuleGraph::mapLine(const int assembledLine, int &moduleLine) const {
     return nullptr;
 }
 
+int ModuleGraph::mapModuleLine(const Module *module, const int moduleLine, std::vector<int> &assembledLines) const {
+    assembledLines.clear();
+
+    const auto it = moduleSourceBlocks.find(module);
+    if (it != moduleSourceBlocks.end()) {
+        for (const int blockIndex : it->second) {
+            const SourceBlock &sourceBlock = assembledSourceBlocks[blockIndex];
+            if (sourceBlock.moduleRange.contains(moduleLine)) {
+                assembledLines.push_back(sourceBlock.assembledRange.begin + moduleLine - sourceBlock.moduleRange.begin);
+            }
+        }
+    }
+
+    return assembledLines.size();
+}
+
+std::shared_ptr<const ParsedModule> ModuleGraph::parseModule(const std::string &id, const SourceBuffer &source, const std::uint64_t *version) {
+    if (!moduleCache) {
+        return ParsedModule::parse(id, source, analysisCache);
+    }
+
+    return version ? moduleCache->acquire(id, source, *version) : moduleCache->acquire(id, source);
+}
+
+void ModuleGraph::loadParsedModule(const std::string &id, LoadedModule &loadedModule) {
+    // The version is read before loading, so that a concurrent change is detected by the next reload
+    std::uint64_t &version = loadedModule.version;
+    const bool versioned = loadedModule.versioned = moduleLoader->getVersion(id, version);
+
+    // With a version stamp, a cached module can be used without loading it
+    std::shared_ptr<const ParsedModule> parsedModule;
+    if (versioned && moduleCache) {
+        parsedModule = moduleCache->find(id, version);
+    }
+
+    if (!parsedModule) {
+        SourceBuffer source;
+        {
+            Profiler::Scope scope(profiler, Profiler::Phase::LOAD, id);
+            source = moduleLoader->loadBuffer(id);
+        }
+
+        {
+            Profiler::Scope scope(profiler, Profiler::Phase::ANALYZE, id);
+            parsedModule = parseModule(id, source, versioned ? &version : nullptr);
+        }
+
+        if (profiler) {
+            Profiler::Counters counters;
+            counters.modulesLoaded = 1;
+            counters.bytesLoaded = source.size();
+            counters.linesProcessed = parsedModule->getSourceLinesCount();
+            profiler->count(counters);
+        }
+    } else if (profiler) {
+        Profiler::Counters counters;
+        counters.modulesReused = 1;
+        profiler->count(counters);
+    }
+
+    loadedModule.parsedModule = parsedModule;
+}
+
+Module *ModuleGraph::createModule(const LoadedModule &loadedModule) {
+    Module *module = Module::fromParsedModule(loadedModule.parsedModule, arena);
+    if (loadedModule.versioned) {
+        module->setVersion(loadedModule.version);
+    }
+
+    return module;
+}
+
+Module *ModuleGraph::createModule(const std::string &id) {
+    LoadedModule loadedModule;
+    loadParsedModule(id, loadedModule);
+    return createModule(loadedModule);
+}
+
+void ModuleGraph::destroyModule(Module *module) {
+    module->~Module();
+}
+
+void ModuleGraph::createModules(const std::vector<std::string> &ids, std::vector<Module *> &created, std::vector<std::exception_ptr> &errors) {
+    created.assign(ids.size(), nullptr);
+    errors.assign(ids.size(), nullptr);
+
+    std::vector<LoadedModule> loadedModules(ids.size());
+    const auto load = [&](const int i) {
+        try {
+            loadParsedModule(ids[i], loadedModules[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    if (threadPool && ids.size() > 1) {
+        threadPool->parallelFor(ids.size(), load);
+    } else {
+        // Stop at the first error
+        for (int i = 0; i < ids.size() && (i == 0 || !errors[i - 1]); i++) {
+            load(i);
+        }
+    }
+
+    // The arena is not threadsafe: the modules are created afterwards, in order
+    for (int i = 0; i < ids.size(); i++) {
+        if (loadedModules[i].parsedModule) {
+            created[i] = createModule(loadedModules[i]);
+        }
+    }
+}
+
+void ModuleGraph::resolveDependencies(std::vector<Module *> frontier) {
+    // Dependencies are resolved one BFS level (frontier) at a time: paths are resolved serially, while the new
+    // modules of the level are loaded (possibly in parallel) and then registered in discovery order
+    std::vector<std::string> pendingIds;
+    std::vector<std::pair<Module *, int>> pendingIncluders;
+    std::unordered_map<std::string, int> pendingIndices;
+    std::vector<std::pair<Module::Dependency *, int>> pendingDependencies;
+    std::vector<Module *> created;
+    std::vector<std::exception_ptr> errors;
+    while (!frontier.empty()) {
+        pendingIds.clear();
+        pendingIncluders.clear();
+        pendingIndices.clear();
+        pendingDependencies.clear();
+
+        // Resolve the paths of the dependencies, and find the new modules
+        {
+            Profiler::Scope scope(profiler, Profiler::Phase::RESOLVE, rootModuleId);
+            for (Module *module : frontier) {
+                for (Module::Dependency &dependency : *module) {
+                    // Build the full path
+                    if (dependency.type == Module::Dependency::Type::ABSOLUTE) {
+                        dependency.moduleId = pathResolver.join(includeDir, dependency.moduleId);
+                    } else {
+                        dependency.moduleId = pathResolver.join(pathResolver.extractPath(module->getId()), dependency.moduleId);
+                    }
+
+                    // Reuse an existing module
+                    dependency.moduleHandle = modules.find(dependency.moduleId);
+
+                    // If it's a new module, schedule its loading
+                    if (dependency.moduleHandle == ModuleRegistry::INVALID_HANDLE) {
+                        const auto inserted = pendingIndices.emplace(dependency.moduleId, pendingIds.size());
+                        if (inserted.second) {
+                            pendingIds.push_back(dependency.moduleId);
+                            pendingIncluders.emplace_back(module, dependency.includeLine);
+                        }
+
+                        pendingDependencies.emplace_back(&dependency, inserted.first->second);
+                    }
+                }
+            }
+        }
+
+        // Load the new modules
+        createModules(pendingIds, created, errors);
+        for (int i = 0; i < errors.size(); i++) {
+            if (errors[i]) {
+                std::cerr << pendingIncluders[i].first->getId() << " line " << (pendingIncluders[i].second + 1) << ": Could not load module " << pendingIds[i] << std::endl;
+                failedModuleId = pendingIds[i];
+                for (Module *module : created) {
+                    if (module) {
+                        destroyModule(module);
+                    }
+                }
+
+                std::rethrow_exception(errors[i]);
+            }
+        }
+
+        // Register them
+        const ModuleRegistry::Handle firstHandle = modules.size();
+        for (Module *module : created) {
+            modules.add(module);
+        }
+
+        for (const auto &pendingDependency : pendingDependencies) {
+            pendingDependency.first->moduleHandle = firstHandle + pendingDependency.second;
+        }
+
+        for (Module *module : frontier) {
+            for (Module::Dependency &dependency : *module) {
+                dependency.module = modules.get(dependency.moduleHandle);
+            }
+        }
+
+        frontier.swap(created);
+    }
+}
+
+void ModuleGraph::removeUnreachableModules(std::vector<std::string> &removedModules) {
+    // Visit the graph from the root module (which is always the first one)
+    std::vector<bool> reachable(modules.size(), false);
+    std::vector<ModuleRegistry::Handle> stack(1, 0);
+    reachable[0] = true;
+    int reachableCount = 1;
+    while (!stack.empty()) {
+        Module *module = modules.get(stack.back());
+        stack.pop_back();
+
+        for (const Module::Dependency &dependency : *module) {
+            if (!reachable[dependency.moduleHandle]) {
+                reachable[dependency.moduleHandle] = true;
+                reachableCount++;
+                stack.push_back(dependency.moduleHandle);
+            }
+        }
+    }
+
+    if (reachableCount == modules.size()) {
+        return;
+    }
+
+    // Register again the reachable modules, preserving their order
+    const std::vector<Module *> oldModules(modules.begin(), modules.end());
+    std::vector<ModuleRegistry::Handle> handles(oldModules.size(), ModuleRegistry::INVALID_HANDLE);
+    modules.clear();
+    for (int i = 0; i < oldModules.size(); i++) {
+        if (reachable[i]) {
+            handles[i] = modules.add(oldModules[i]);
+        } else {
+            removedModules.push_back(oldModules[i]->getId());
+            destroyModule(oldModules[i]);
+        }
+    }
+
+    for (Module *module : modules) {
+        for (Module::Dependency &dependency : *module) {
+            dependency.moduleHandle = handles[dependency.moduleHandle];
+        }
+    }
+}
+
+bool ModuleGraph::compact() {
+    std::size_t liveSize = 0;
+    for (const Module *module : modules) {
+        liveSize += sizeof(Module) + module->getDependencyCount() * sizeof(Module::Dependency);
+    }
+
+    if (arena.getAllocatedSize() <= 2 * liveSize) {
+        return false;
+    }
+
+    // Move the live state out of the arena
+    struct LiveModule {
+        std::shared_ptr<const ParsedModule> parsedModule;
+        std::uint64_t version;
+        bool versioned;
+        std::vector<Module::Dependency> dependencies;
+    };
+
+    std::vector<LiveModule> liveModules(modules.size());
+    std::unordered_map<const Module *, ModuleRegistry::Handle> handles;
+    for (ModuleRegistry::Handle handle = 0; handle < modules.size(); handle++) {
+        Module *module = modules.get(handle);
+        LiveModule &liveModule = liveModules[handle];
+        liveModule.parsedModule = module->getParsedModule();
+        liveModule.versioned = module->getVersion(liveModule.version);
+        liveModule.dependencies.assign(module->begin(), module->end());
+        handles[module] = handle;
+        destroyModule(module);
+    }
+
+    // Create the modules again, with the same handles
+    modules.clear();
+    arena.release();
+    for (const LiveModule &liveModule : liveModules) {
+        Module *module = Module::fromParsedModule(liveModule.parsedModule, arena);
+        if (liveModule.versioned) {
+            module->setVersion(liveModule.version);
+        }
+
+        modules.add(module);
+    }
+
+    for (ModuleRegistry::Handle handle = 0; handle < modules.size(); handle++) {
+        Module *module = modules.get(handle);
+        for (int i = 0; i < module->getDependencyCount(); i++) {
+            Module::Dependency &dependency = module->getDependency(i);
+            dependency = liveModules[handle].dependencies[i];
+            dependency.module = modules.get(dependency.moduleHandle);
+        }
+    }
+
+    // Update the references to the modules
+    for (Module *&module : toposort) {
+        module = modules.get(handles.at(module));
+    }
+
+    for (SourceBlock &sourceBlock : assembledSourceBlocks) {
+        if (sourceBlock.module) {
+            sourceBlock.module = modules.get(handles.at(sourceBlock.module));
+        }
+    }
+
+    std::unordered_map<const Module *, std::vector<int>> movedSourceBlocks;
+    for (auto &it : moduleSourceBlocks) {
+        movedSourceBlocks[modules.get(handles.at(it.first))].swap(it.second);
+    }
+
+    moduleSourceBlocks.swap(movedSourceBlocks);
+    return true;
+}
+
 const std::string &ModuleGraph::loadModule(const std::string &modulePath) {
     if (!moduleLoader) {
         throw std::runtime_error("No module loader specified!");
@@ -53,136 +381,614 @@ const std::string &ModuleGraph::loadModule(const std::string &modulePath) {
 
     // Destroy old data (if present)
     destroy();
+    if (moduleCache) {
+        moduleCache->purge();
+    }
+    rootModuleId = modulePath;
+    failedModuleId.clear();
+    Profiler::Scope scope(profiler, "loadModule", rootModuleId);
 
     // Load the root module and register it
     Module *rootModule;
     try {
-        rootModule = Module::fromSource(modulePath,moduleLoader->load(modulePath));
-        modules.push_back(rootModule);
+        rootModule = createModule(modulePath);
+        modules.add(rootModule);
     } catch (...) {
         std::cerr << "Could not load module " << modulePath << std::endl;
+        failedModuleId = modulePath;
         throw;
     }
 
-    // Expand to other modules
-    std::queue<Module *> queue;
-    queue.push(rootModule);
-    while (!queue.empty()) {
-        // Extract a module
-        Module *module = queue.front();
-        queue.pop();
+    try {
+        // Expand to other modules
+        resolveDependencies(std::vector<Module *>(1, rootModule));
 
-        // Handle its dependencies
-        for (Module::Dependency &dependency : *module) {
-            // Build the full path
-            if (dependency.type == Module::Dependency::Type::ABSOLUTE) {
-                dependency.moduleId = moduleLoader->join(includeDir, dependency.moduleId);
+        // Build the topological sort
+        buildTopologicalSort();
+
+        // Assemble the source
+        assembleSource();
+    } catch (...) {
+        // Leave the graph empty, so that reload() starts from scratch
+        destroy();
+        throw;
+    }
+
+    return assembledSource;
+}
+
+bool ModuleGraph::reload(std::vector<std::string> &touchedModules) {
+    touchedModules.clear();
+    if (!moduleLoader) {
+        throw std::runtime_error("No module loader specified!");
+    }
+
+    if (rootModuleId.empty()) {
+        throw std::runtime_error("No module loaded!");
+    }
+
+    Profiler::Scope scope(profiler, "reload", rootModuleId);
+    failedModuleId.clear();
+
+    // The previous (re)load failed, start from scratch
+    if (modules.size() == 0) {
+        loadModule(rootModuleId);
+        for (const Module *module : modules) {
+            touchedModules.push_back(module->getId());
+        }
+
+        return true;
+    }
+
+    // Parse the changed modules aside, so that the graph is left untouched on errors
+    struct Change {
+        Module *module;
+        std::shared_ptr<const ParsedModule> parsedModule;
+        bool versioned;
+        std::uint64_t version;
+    };
+
+    // Counters of the changed modules (new modules are counted by createModule())
+    Profiler::Counters counters;
+    std::vector<Change> changes;
+    for (Module *module : modules) {
+        try {
+            Change change;
+            change.module = module;
+            change.versioned = moduleLoader->getVersion(module->getId(), change.version);
+            if (change.versioned && module->isVersion(change.version)) {
+                counters.modulesReused++;
+                continue;
+            }
+
+            if (change.versioned && moduleCache) {
+                change.parsedModule = moduleCache->find(module->getId(), change.version);
+            }
+
+            if (!change.parsedModule) {
+                SourceBuffer source;
+                {
+                    Profiler::Scope loadScope(profiler, Profiler::Phase::LOAD, module->getId());
+                    source = moduleLoader->loadBuffer(module->getId());
+                }
+
+                counters.modulesLoaded++;
+                counters.bytesLoaded += source.size();
+
+                // Without a cache, avoid parsing unchanged sources
+                Profiler::Scope analyzeScope(profiler, Profiler::Phase::ANALYZE, module->getId());
+                if (moduleCache || Hash::xxh64(source.data(), source.size()) != module->getSourceHash()) {
+                    change.parsedModule = parseModule(module->getId(), source, change.versioned ? &change.version : nullptr);
+                    counters.linesProcessed += change.parsedModule->getSourceLinesCount();
+                }
             } else {
-                dependency.moduleId = moduleLoader->join(moduleLoader->extractPath(module->getId()), dependency.moduleId);
-            }
-
-            // Reuse an existing module
-            dependency.module = findModule(dependency.moduleId);
-
-            // If it's a new module
-            if (!dependency.module) {
-                // Load and store it
-                try {
-                    dependency.module = Module::fromSource(dependency.moduleId, moduleLoader->load(dependency.moduleId));
-                    modules.push_back(dependency.module);
-                    queue.push(dependency.module);
-                } catch (...) {
-                    std::cerr << module->getId() << " line " << (dependency.includeLine + 1) << ": Could not load module " << dependency.moduleId << std::endl;
-                    throw;
+                counters.modulesReused++;
+            }
+
+            if (!change.parsedModule ||
+                (change.parsedModule->getSourceHash() == module->getSourceHash() &&
+                 change.parsedModule->getSourceSize() == module->getParsedModule()->getSourceSize())) {
+                if (change.versioned) {
+                    module->setVersion(change.version);
                 }
+
+                continue;
             }
+
+            changes.push_back(change);
+        } catch (...) {
+            std::cerr << "Could not reload module " << module->getId() << std::endl;
+            failedModuleId = module->getId();
+            throw;
         }
     }
 
-    // Build the topological sort
-    buildTopologicalSort();
+    if (profiler) {
+        profiler->count(counters);
+    }
 
-    // Assemble the source
-    assembleSource();
+    if (changes.empty()) {
+        return false;
+    }
 
-    return assembledSource;
+    try {
+        // Replace the changed modules (in place, since other modules refer to them) and resolve their dependencies again
+        const int oldModuleCount = modules.size();
+        std::vector<std::vector<ModuleRegistry::Handle>> oldDependencies;
+        std::vector<Module *> frontier;
+        for (const Change &change : changes) {
+            Module *module = change.module;
+            oldDependencies.emplace_back();
+            for (const Module::Dependency &dependency : *module) {
+                oldDependencies.back().push_back(dependency.moduleHandle);
+            }
+
+            module->setParsedModule(change.parsedModule);
+            if (change.versioned) {
+                module->setVersion(change.version);
+            }
+
+            touchedModules.push_back(module->getId());
+            frontier.push_back(module);
+        }
+
+        resolveDependencies(frontier);
+
+        // Check whether the dependencies changed
+        bool dependenciesChanged = modules.size() != oldModuleCount;
+        for (int i = 0; i < changes.size() && !dependenciesChanged; i++) {
+            Module *module = changes[i].module;
+            dependenciesChanged = module->getDependencyCount() != oldDependencies[i].size();
+            for (int j = 0; j < module->getDependencyCount() && !dependenciesChanged; j++) {
+                dependenciesChanged = module->getDependency(j).moduleHandle != oldDependencies[i][j];
+            }
+        }
+
+        if (dependenciesChanged) {
+            for (ModuleRegistry::Handle handle = oldModuleCount; handle < modules.size(); handle++) {
+                touchedModules.push_back(modules.get(handle)->getId());
+            }
+
+            removeUnreachableModules(touchedModules);
+            buildTopologicalSort();
+        }
+
+        assembleSource();
+    } catch (...) {
+        destroy();
+        throw;
+    }
+
+    // The previous sources of the changed modules may not be used anymore
+    if (moduleCache) {
+        moduleCache->purge();
+    }
+
+    return true;
+}
+
+void ModuleGraph::saveSnapshot(const std::string &path) const {
+    GraphSnapshot::save(*this, path);
+}
+
+bool ModuleGraph::loadSnapshot(const std::string &path) {
+    return GraphSnapshot::load(*this, path);
 }
 
 void ModuleGraph::buildTopologicalSort() {
-    // Compute topological sort (Tarjan)
-    std::queue<Module *> queue;
+    Profiler::Scope scope(profiler, Profiler::Phase::SORT, rootModuleId);
+
     for (Module *module : modules) {
         module->setMark(Module::Mark::UNMARKED);
-        queue.push(module);
     }
 
-    std::vector<std::string> stack;
+    // Iterative depth first search (no recursion, so deep include chains cannot overflow the call stack): each frame
+    // is a module and the index of the next dependency to visit, so the stack is also the current path
+    std::vector<std::pair<ModuleRegistry::Handle, int>> stack;
     toposort.clear();
-    while (!queue.empty()) {
-        Module *curNode = queue.front();
-        queue.pop();
+    toposort.reserve(modules.size());
+    for (ModuleRegistry::Handle root = 0; root < modules.size(); root++) {
+        if (modules.get(root)->getMark() != Module::Mark::UNMARKED) {
+            continue;
+        }
 
-        stack.push_back(curNode->getId());
-        buildTopologicalSort(curNode, stack);
+        modules.get(root)->setMark(Module::Mark::TEMPORARY);
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            Module *module = modules.get(stack.back().first);
+            if (stack.back().second == module->getDependencyCount()) {
+                module->setMark(Module::Mark::PERMANENT);
+                toposort.push_back(module);
+                stack.pop_back();
+                continue;
+            }
+
+            const ModuleRegistry::Handle handle = module->getDependency(stack.back().second++).moduleHandle;
+            Module *dependency = modules.get(handle);
+            if (dependency->getMark() == Module::Mark::UNMARKED) {
+                dependency->setMark(Module::Mark::TEMPORARY);
+                stack.emplace_back(handle, 0);
+            } else if (dependency->getMark() == Module::Mark::TEMPORARY) {
+                // Back edge: the cycle is the part of the path starting at the dependency
+                std::vector<ModuleRegistry::Handle> cycle;
+                auto it = stack.begin();
+                while (it->first != handle) {
+                    ++it;
+                }
+
+                for (; it != stack.end(); ++it) {
+                    cycle.push_back(it->first);
+                }
+
+                cycle.push_back(handle);
+                throwDependencyCycles(cycle);
+            }
+        }
     }
 }
 
-void ModuleGraph::buildTopologicalSort(Module *module, std::vector<std::string> &stack) {
-    if (module->getMark() == Module::Mark::PERMANENT) {
-        return;
-    } else if (module->getMark() == Module::Mark::TEMPORARY) {
-        throw std::runtime_error("Dependency cycle: " + StringUtils::join(stack, " --> "));
+void ModuleGraph::findCycles(std::vector<std::vector<ModuleRegistry::Handle>> &components) const {
+    // Iterative Tarjan's algorithm
+    const int count = modules.size();
+    std::vector<int> indices(count, -1);
+    std::vector<int> lowLinks(count, 0);
+    std::vector<bool> onStack(count, false);
+    std::vector<ModuleRegistry::Handle> componentStack;
+    std::vector<std::pair<ModuleRegistry::Handle, int>> stack;
+    int nextIndex = 0;
+
+    const auto visit = [&](const ModuleRegistry::Handle handle) {
+        indices[handle] = lowLinks[handle] = nextIndex++;
+        componentStack.push_back(handle);
+        onStack[handle] = true;
+        stack.emplace_back(handle, 0);
+    };
+
+    for (ModuleRegistry::Handle root = 0; root < count; root++) {
+        if (indices[root] >= 0) {
+            continue;
+        }
+
+        visit(root);
+        while (!stack.empty()) {
+            const ModuleRegistry::Handle handle = stack.back().first;
+            const Module *module = modules.get(handle);
+            if (stack.back().second < module->getDependencyCount()) {
+                const ModuleRegistry::Handle dependency = module->getDependency(stack.back().second++).moduleHandle;
+                if (indices[dependency] < 0) {
+                    visit(dependency);
+                } else if (onStack[dependency]) {
+                    lowLinks[handle] = std::min(lowLinks[handle], indices[dependency]);
+                }
+
+                continue;
+            }
+
+            stack.pop_back();
+            if (!stack.empty()) {
+                lowLinks[stack.back().first] = std::min(lowLinks[stack.back().first], lowLinks[handle]);
+            }
+
+            if (lowLinks[handle] != indices[handle]) {
+                continue;
+            }
+
+            // The module is the root of a component
+            std::vector<ModuleRegistry::Handle> component;
+            ModuleRegistry::Handle member;
+            do {
+                member = componentStack.back();
+                componentStack.pop_back();
+                onStack[member] = false;
+                component.push_back(member);
+            } while (member != handle);
+
+            // Only components with a cycle (more than one module, or a module including itself)
+            bool cyclic = component.size() > 1;
+            for (int i = 0; i < module->getDependencyCount() && !cyclic; i++) {
+                cyclic = module->getDependency(i).moduleHandle == handle;
+            }
+
+            if (cyclic) {
+                std::sort(component.begin(), component.end());
+                components.push_back(std::move(component));
+            }
+        }
     }
-    module->setMark(Module::Mark::TEMPORARY);
 
-    for (Module::Dependency &dependency : *module) {
-        stack.push_back(dependency.moduleId);
-        buildTopologicalSort(dependency.module, stack);
-        stack.pop_back();
+    std::sort(components.begin(), components.end());
+}
+
+void ModuleGraph::findCycle(const std::vector<ModuleRegistry::Handle> &component, std::vector<ModuleRegistry::Handle> &cycle) const {
+    // Breadth first search inside the (sorted) component, from its first module back to itself
+    const ModuleRegistry::Handle start = component.front();
+    std::unordered_map<ModuleRegistry::Handle, ModuleRegistry::Handle> parents;
+    std::vector<ModuleRegistry::Handle> queue(1, start);
+    parents.emplace(start, start);
+    for (std::size_t i = 0; i < queue.size(); i++) {
+        for (const Module::Dependency &dependency : *modules.get(queue[i])) {
+            if (dependency.moduleHandle == start) {
+                // Follow the parents back to the start
+                cycle.assign(1, start);
+                for (ModuleRegistry::Handle handle = queue[i]; handle != start; handle = parents[handle]) {
+                    cycle.push_back(handle);
+                }
+
+                cycle.push_back(start);
+                std::reverse(cycle.begin(), cycle.end());
+                return;
+            }
+
+            if (std::binary_search(component.begin(), component.end(), dependency.moduleHandle) &&
+                parents.emplace(dependency.moduleHandle, queue[i]).second) {
+                queue.push_back(dependency.moduleHandle);
+            }
+        }
     }
+}
+
+void ModuleGraph::throwDependencyCycles(const std::vector<ModuleRegistry::Handle> &cycle) const {
+    // Module ids are only needed to report the cycles
+    const auto describe = [this](const std::vector<ModuleRegistry::Handle> &handles) {
+        std::vector<std::string> ids;
+        for (const ModuleRegistry::Handle handle : handles) {
+            ids.push_back(modules.get(handle)->getId());
+        }
 
-    module->setMark(Module::Mark::PERMANENT);
-    toposort.push_back(module);
+        return "Dependency cycle: " + StringUtils::join(ids, " --> ");
+    };
+
+    // The cycle found first, then one cycle for each other strongly connected component
+    std::string message = describe(cycle);
+    std::vector<std::vector<ModuleRegistry::Handle>> components;
+    findCycles(components);
+    std::vector<ModuleRegistry::Handle> otherCycle;
+    for (const std::vector<ModuleRegistry::Handle> &component : components) {
+        if (!std::binary_search(component.begin(), component.end(), cycle.front())) {
+            findCycle(component, otherCycle);
+            message += "\n" + describe(otherCycle);
+        }
+    }
+
+    throw std::runtime_error(message);
 }
 
+// Preamble of each module in the assembled source
+static const char MODULE_BEGIN[] = "// MODULE BEGIN: ";
+
+// Output options, combined into the program hash
+static const std::uint64_t OUTPUT_TREE_SHAKING = 1;
+static const std::uint64_t OUTPUT_MINIFY = 2;
+
 void ModuleGraph::assembleSource() {
-    std::vector<std::string> assembledSourceLines;
+    Profiler::Scope scope(profiler, Profiler::Phase::ASSEMBLE, rootModuleId);
+    assembledSourceBlocks.clear();
+    minifiedBlockStates.clear();
+    moduleSourceBlocks.clear();
+
+    // Only compute the layout (lines and size), the source is written by writeAssembledSource()
+    int lineCount = 0;
+    std::size_t size = 0;
+    SourceMinifier::State minifierState;
+    std::string minifiedLine;
 
     // First hoisted lines
     for (Module *module : toposort) {
         for (int i = 0; i < module->getHoistedLinesCount(); i++) {
             const Module::HoistedLine &hoistedLine = module->getHoistedLine(i);
-            assembledSourceLines.push_back(hoistedLine.line);
+            if (minify) {
+                minifierState = SourceMinifier::State();
+                SourceMinifier::minifyLine(hoistedLine.line, minifierState, minifiedLine);
+                if (minifiedLine.empty()) {
+                    continue;
+                }
+            }
+
+            size += minify ? minifiedLine.size() : hoistedLine.line.size();
 
             // Build the source block mapping for the hoisted line
             SourceBlock block;
             block.module = module;
             block.moduleRange.begin = block.moduleRange.end = hoistedLine.index;
-            block.assembledRange.begin = block.assembledRange.end = assembledSourceLines.size() - 1;
+            block.assembledRange.begin = block.assembledRange.end = lineCount;
             assembledSourceBlocks.push_back(block);
+            lineCount++;
         }
     }
 
-    // Then modules
-    for (Module *module : toposort) {
-        // Skip empty modules
-        if (!module->isEmpty()) {
-            const int begin = assembledSourceLines.size();
-            module->inject(assembledSourceLines);
-            const int end = assembledSourceLines.size() - 1;
+    hoistedLinesCount = assembledSourceBlocks.size();
+
+    // With tree shaking, only some line ranges of each module are kept
+    std::vector<std::vector<LineRange>> keptRanges;
+    if (treeShaking) {
+        TreeShaker::shake(toposort, keptRanges);
+    }
+
+    // Then modules: a comment preamble, the module source (or the kept line ranges) and an empty line; when minified,
+    // only the non-empty minified lines
+    std::vector<LineRange> wholeModule(1);
+    for (int m = 0; m < toposort.size(); m++) {
+        Module *module = toposort[m];
+        wholeModule[0].begin = 0;
+        wholeModule[0].end = module->getSourceLinesCount() - 1;
+        const std::vector<LineRange> &ranges = treeShaking ? keptRanges[m] : wholeModule;
+
+        // Skip empty (or entirely removed) modules
+        if (module->isEmpty() || ranges.empty()) {
+            continue;
+        }
 
-            // Build the source block mapping for the module
+        if (minify) {
+            // Kept ranges never start inside a comment
+            for (const LineRange &range : ranges) {
+                minifierState = SourceMinifier::State();
+                for (int i = range.begin; i <= range.end; i++) {
+                    const SourceMinifier::State lineState = minifierState;
+                    SourceMinifier::minifyLine(module->getSourceLine(i), minifierState, minifiedLine);
+                    if (minifiedLine.empty()) {
+                        continue;
+                    }
+
+                    // Extend the last block, or start a new one (recording the minifier state to replay it)
+                    size += minifiedLine.size();
+                    if (assembledSourceBlocks.size() > hoistedLinesCount &&
+                        assembledSourceBlocks.back().module == module &&
+                        assembledSourceBlocks.back().moduleRange.end == i - 1) {
+                        assembledSourceBlocks.back().moduleRange.end = i;
+                        assembledSourceBlocks.back().assembledRange.end = lineCount;
+                    } else {
+                        SourceBlock block;
+                        block.module = module;
+                        block.moduleRange.begin = block.moduleRange.end = i;
+                        block.assembledRange.begin = block.assembledRange.end = lineCount;
+                        assembledSourceBlocks.push_back(block);
+                        minifiedBlockStates.push_back(lineState);
+                    }
+
+                    lineCount++;
+                }
+            }
+
+            continue;
+        }
+
+        size += sizeof(MODULE_BEGIN) - 1 + module->getId().size();
+        int assembledLine = lineCount + 1; // skip the MODULE BEGIN comment
+        for (const LineRange &range : ranges) {
+            for (int i = range.begin; i <= range.end; i++) {
+                size += module->getSourceLine(i).size();
+            }
+
+            // Build the source block mapping for the range
             SourceBlock block;
             block.module = module;
-            block.moduleRange.begin = 0;
-            block.moduleRange.end = module->getSourceLinesCount() - 1;
-            block.assembledRange.begin = begin + 1; // skip the MODULE BEGIN comment
-            block.assembledRange.end = end - 1; // skip the empty line module separator
+            block.moduleRange = range;
+            block.assembledRange.begin = assembledLine;
+            block.assembledRange.end = assembledLine + range.end - range.begin;
             assembledSourceBlocks.push_back(block);
+            assembledLine = block.assembledRange.end + 1;
         }
+
+        lineCount = assembledLine + 1;
     }
 
-    assembledSource = StringUtils::join(assembledSourceLines, "\n");
+    // Lines are separated by a newline
+    assembledSourceSize = lineCount > 0 ? size + lineCount - 1 : 0;
+
+    // The assembled source only depends on the sorted modules ids and contents
+    programHash = 0;
+    if (!toposort.empty()) {
+        programHash = Hash::combine(Hash::xxh64(MODULE_BEGIN, sizeof(MODULE_BEGIN) - 1), toposort.size());
+        for (const Module *module : toposort) {
+            programHash = Hash::combine(programHash, Hash::xxh64(module->getId()));
+            programHash = Hash::combine(programHash, module->getSourceHash());
+            programHash = Hash::combine(programHash, module->getParsedModule()->getSourceSize());
+        }
+
+        // Options changing the output
+        if (treeShaking) {
+            programHash = Hash::combine(programHash, OUTPUT_TREE_SHAKING);
+        }
+
+        if (minify) {
+            programHash = Hash::combine(programHash, OUTPUT_MINIFY);
+        }
+    }
+
+    // Build the reverse mapping index
+    for (int i = 0; i < assembledSourceBlocks.size(); i++) {
+        moduleSourceBlocks[assembledSourceBlocks[i].module].push_back(i);
+    }
+
+    // A new string is allocated only once, with the exact size
+    std::string().swap(assembledSource);
+    if (keepAssembledSource) {
+        StringAssemblySink sink(assembledSource);
+        writeAssembledSource(sink);
+    }
+
+    if (profiler) {
+        Profiler::Counters counters;
+        counters.bytesAssembled = assembledSourceSize;
+        profiler->count(counters);
+    }
+}
+
+void ModuleGraph::writeAssembledSource(AssemblySink &sink) const {
+    sink.reserve(assembledSourceSize);
+
+    bool firstLine = true;
+    const auto beginLine = [&sink, &firstLine]() {
+        if (!firstLine) {
+            sink.write("\n", 1);
+        }
+
+        firstLine = false;
+    };
+
+    // Same layout as assembleSource(): first hoisted lines (one source block each)
+    SourceMinifier::State minifierState;
+    std::string minifiedLine;
+    int blockIndex = 0;
+    for (const Module *module : toposort) {
+        for (int i = 0; i < module->getHoistedLinesCount(); i++) {
+            const std::string &line = module->getHoistedLine(i).line;
+            if (minify) {
+                minifierState = SourceMinifier::State();
+                SourceMinifier::minifyLine(line, minifierState, minifiedLine);
+                if (!minifiedLine.empty()) {
+                    beginLine();
+                    sink.write(minifiedLine.data(), minifiedLine.size());
+                    blockIndex++;
+                }
+            } else {
+                beginLine();
+                sink.write(line.data(), line.size());
+                blockIndex++;
+            }
+        }
+    }
+
+    // Minified: the lines of the source blocks, replaying the minifier from the state recorded for each block
+    if (minify) {
+        for (; blockIndex < assembledSourceBlocks.size(); blockIndex++) {
+            const SourceBlock &block = assembledSourceBlocks[blockIndex];
+            minifierState = minifiedBlockStates[blockIndex - hoistedLinesCount];
+            for (int i = block.moduleRange.begin; i <= block.moduleRange.end; i++) {
+                SourceMinifier::minifyLine(block.module->getSourceLine(i), minifierState, minifiedLine);
+                beginLine();
+                sink.write(minifiedLine.data(), minifiedLine.size());
+            }
+        }
+
+        return;
+    }
+
+    // Then the source blocks of each module, after a preamble and followed by an empty line
+    const Module *previousModule = nullptr;
+    for (; blockIndex < assembledSourceBlocks.size(); blockIndex++) {
+        const SourceBlock &block = assembledSourceBlocks[blockIndex];
+        if (block.module != previousModule) {
+            if (previousModule) {
+                beginLine();
+            }
+
+            beginLine();
+            sink.write(MODULE_BEGIN, sizeof(MODULE_BEGIN) - 1);
+            sink.write(block.module->getId().data(), block.module->getId().size());
+            previousModule = block.module;
+        }
+
+        for (int i = block.moduleRange.begin; i <= block.moduleRange.end; i++) {
+            const StringView line = block.module->getSourceLine(i);
+            beginLine();
+            sink.write(line.data(), line.size());
+        }
+    }
+
+    if (previousModule) {
+        beginLine();
+    }
 }
 
 void ModuleGraph::setIncludeDir(const std::string &includeDir) {
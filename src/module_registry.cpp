@@ -0,0 +1,29 @@
+#include <glsl_assembler/module_registry.h>
+#include <glsl_assembler/module.h>
+#include <stdexcept>
+
+const ModuleRegistry::Handle ModuleRegistry::INVALID_HANDLE;
+
+ModuleRegistry::Handle ModuleRegistry::add(Module *module) {
+    const Handle handle = modules.size();
+    if (!handles.emplace(module->getId(), handle).second) {
+        throw std::runtime_error("Module " + module->getId() + " is already registered");
+    }
+
+    modules.push_back(module);
+    return handle;
+}
+
+ModuleRegistry::Handle ModuleRegistry::find(const std::string &id) const {
+    const auto it = handles.find(id);
+    if (it != handles.end()) {
+        return it->second;
+    }
+
+    return INVALID_HANDLE;
+}
+
+void ModuleRegistry::clear() {
+    handles.clear();
+    modules.clear();
+}
@@ -0,0 +1,209 @@
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/analysis_cache.h>
+#include <glsl_assembler/directive_scanner.h>
+#include <glsl_assembler/hash.h>
+#include <glsl_assembler/string_utils.h>
+#include <cstring>
+#include <stdexcept>
+
+ParsedModule::ParsedModule() {
+}
+
+std::shared_ptr<const ParsedModule> ParsedModule::parse(const std::string &id, const std::string &source) {
+    return parse(id, source, nullptr);
+}
+
+std::shared_ptr<const ParsedModule> ParsedModule::parse(const std::string &id, const std::string &source, AnalysisCache *analysisCache) {
+    return parse(id, SourceBuffer::fromString(source), analysisCache);
+}
+
+std::shared_ptr<const ParsedModule> ParsedModule::parse(const std::string &id, const SourceBuffer &source, AnalysisCache *analysisCache) {
+    std::shared_ptr<ParsedModule> module(new ParsedModule());
+    module->source = source;
+    module->splitLines();
+    module->id = id;
+    module->sourceHash = Hash::xxh64(source.data(), source.size());
+    module->sourceSize = source.size();
+
+    if (!analysisCache) {
+        module->analyzeDependencies();
+        return module;
+    }
+
+    AnalysisCache::Analysis analysis;
+    if (analysisCache->find(module->sourceHash, module->sourceSize, analysis) && module->applyAnalysis(analysis.includes, analysis.hoistedLines)) {
+        return module;
+    }
+
+    module->analyzeDependencies();
+    analysis.includes = module->includes;
+    analysis.hoistedLines.clear();
+    for (const HoistedLine &hoistedLine : module->hoistLines) {
+        analysis.hoistedLines.push_back(hoistedLine.index);
+    }
+
+    analysisCache->store(module->sourceHash, module->sourceSize, analysis);
+    return module;
+}
+
+void ParsedModule::splitLines() {
+    const char *data = source.data();
+    std::vector<std::size_t> newlines;
+    StringUtils::findNewlines(data, source.size(), newlines);
+
+    // Same lines as std::getline: a trailing newline does not start a new line
+    sourceLines.reserve(newlines.size() + 1);
+    std::size_t lineBegin = 0;
+    for (const std::size_t newline : newlines) {
+        Line line;
+        line.offset = lineBegin;
+        line.length = newline - lineBegin;
+
+        // \r\n newlines are normalized here, instead of copying the whole source
+        if (line.length > 0 && data[newline - 1] == '\r') {
+            line.length--;
+        }
+
+        sourceLines.push_back(line);
+        lineBegin = newline + 1;
+    }
+
+    if (lineBegin < source.size()) {
+        Line line;
+        line.offset = lineBegin;
+        line.length = source.size() - lineBegin;
+        sourceLines.push_back(line);
+    }
+}
+
+std::size_t ParsedModule::getMemoryUsage() const {
+    std::size_t usage = sizeof(ParsedModule) + id.capacity() + commentedText.capacity();
+
+    // Borrowed sources (e.g. embedded resources) are not held by the module
+    if (source.getOwner()) {
+        usage += source.size();
+    }
+
+    usage += sourceLines.capacity() * sizeof(Line);
+
+    usage += includes.capacity() * sizeof(Include);
+    for (const Include &include : includes) {
+        usage += include.path.capacity();
+    }
+
+    usage += hoistLines.capacity() * sizeof(HoistedLine);
+    for (const HoistedLine &hoistedLine : hoistLines) {
+        usage += hoistedLine.line.capacity();
+    }
+
+    return usage;
+}
+
+void ParsedModule::commentLine(int index) {
+    Line &line = sourceLines[index];
+    const std::size_t offset = source.size() + commentedText.size();
+    commentedText += "// ";
+    if (line.offset < source.size()) {
+        commentedText.append(source.data() + line.offset, line.length);
+    } else {
+        // Already commented: copied by position, since appending may reallocate the commented text
+        commentedText.append(commentedText, line.offset - source.size(), line.length);
+    }
+
+    line.offset = offset;
+    line.length += 3;
+}
+
+void ParsedModule::hoistLine(int index) {
+    HoistedLine hoistedLine;
+    hoistedLine.line = getSourceLine(index).str();
+    hoistedLine.index = index;
+    hoistLines.push_back(hoistedLine);
+
+    commentLine(index);
+}
+
+void ParsedModule::analyzeDependencies() {
+    includes.clear();
+
+    for (int i = 0; i < sourceLines.size(); i++) {
+        const StringView line = getSourceLine(i);
+        const DirectiveScanner::Directive directive = DirectiveScanner::scanLine(line.begin(), line.end());
+        switch (directive.type) {
+            // Handle includes
+            case DirectiveScanner::DirectiveType::RELATIVE_INCLUDE:
+            case DirectiveScanner::DirectiveType::ABSOLUTE_INCLUDE: {
+                Include include;
+                include.path.assign(directive.argument, directive.argumentLength);
+                include.line = i;
+                include.type = directive.type == DirectiveScanner::DirectiveType::RELATIVE_INCLUDE ? Include::Type::RELATIVE : Include::Type::ABSOLUTE;
+                includes.push_back(include);
+                commentLine(i);
+                break;
+            }
+
+            case DirectiveScanner::DirectiveType::INVALID_INCLUDE:
+                throw std::runtime_error("Error '" + id + "'(" + std::to_string(i + 1) + "): invalid #include syntax.");
+
+            // Handle hoisting
+            case DirectiveScanner::DirectiveType::VERSION:
+            case DirectiveScanner::DirectiveType::PRECISION:
+                hoistLine(i);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+bool ParsedModule::applyAnalysis(const std::vector<Include> &cachedIncludes, const std::vector<int> &cachedHoistedLines) {
+    // Guard against hash collisions and corrupt entries: the lines must exist, in ascending order, and a line cannot
+    // be both an include and a hoisted line (each line is commented once)
+    int previousLine = -1;
+    for (const Include &include : cachedIncludes) {
+        if (include.line <= previousLine || include.line >= sourceLines.size()) {
+            return false;
+        }
+
+        previousLine = include.line;
+    }
+
+    previousLine = -1;
+    auto include = cachedIncludes.begin();
+    for (const int index : cachedHoistedLines) {
+        if (index <= previousLine || index >= sourceLines.size()) {
+            return false;
+        }
+
+        while (include != cachedIncludes.end() && include->line < index) {
+            ++include;
+        }
+
+        if (include != cachedIncludes.end() && include->line == index) {
+            return false;
+        }
+
+        previousLine = index;
+    }
+
+    includes = cachedIncludes;
+    for (const Include &include : includes) {
+        commentLine(include.line);
+    }
+
+    for (const int index : cachedHoistedLines) {
+        hoistLine(index);
+    }
+
+    return true;
+}
+
+void ParsedModule::inject(std::vector<std::string> &lines) const {
+    lines.push_back("// MODULE BEGIN: " + id);
+    for (int i = 0; i < sourceLines.size(); i++) {
+        lines.push_back(getSourceLine(i).str());
+    }
+
+    lines.emplace_back("");
+}
@@ -0,0 +1,53 @@
+#include <glsl_assembler/path_resolver.h>
+#include <glsl_assembler/module_loader.h>
+
+PathResolver::PathResolver(ModuleLoader *moduleLoader)
+    : moduleLoader(moduleLoader) {
+}
+
+const std::string *PathResolver::intern(const std::string &path) {
+    return &*paths.insert(path).first;
+}
+
+const std::string &PathResolver::join(const std::string &path, const std::string &pathName) {
+    const auto directory = joinedPaths.find(path);
+    if (directory != joinedPaths.end()) {
+        const auto joined = directory->second.find(pathName);
+        if (joined != directory->second.end()) {
+            hits++;
+            return *joined->second;
+        }
+    }
+
+    // The loader may throw: nothing is inserted before it succeeds
+    const std::string *joined = intern(moduleLoader->join(path, pathName));
+    misses++;
+    joinedPaths[path].emplace(pathName, joined);
+    return *joined;
+}
+
+const std::string &PathResolver::extractPath(const std::string &pathName) {
+    const auto it = directories.find(pathName);
+    if (it != directories.end()) {
+        hits++;
+        return *it->second;
+    }
+
+    const std::string *directory = intern(moduleLoader->extractPath(pathName));
+    misses++;
+    directories.emplace(pathName, directory);
+    return *directory;
+}
+
+void PathResolver::clear() {
+    joinedPaths.clear();
+    directories.clear();
+    paths.clear();
+    hits = 0;
+    misses = 0;
+}
+
+void PathResolver::setModuleLoader(ModuleLoader *moduleLoader) {
+    this->moduleLoader = moduleLoader;
+    clear();
+}
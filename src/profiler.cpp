@@ -0,0 +1,182 @@
+#include <glsl_assembler/profiler.h>
+#include <cstdio>
+
+namespace {
+    /**
+     * Writes a JSON string literal.
+     */
+    void writeJsonString(std::ostream &stream, const std::string &str) {
+        stream << '"';
+        for (const char c : str) {
+            switch (c) {
+                case '"': stream << "\\\""; break;
+                case '\\': stream << "\\\\"; break;
+                case '\n': stream << "\\n"; break;
+                case '\r': stream << "\\r"; break;
+                case '\t': stream << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        stream << escaped;
+                    } else {
+                        stream << c;
+                    }
+            }
+        }
+
+        stream << '"';
+    }
+
+    /**
+     * @return the duration in microseconds (the unit of the Chrome trace format).
+     */
+    double toMicroseconds(const Profiler::Clock::duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    }
+}
+
+Profiler::Statistics::Statistics() {
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        phaseTimes[i] = Clock::duration::zero();
+        phaseAllocations[i] = 0;
+    }
+}
+
+Profiler::Scope::Scope(Profiler *profiler, const Phase phase, const std::string &module)
+    : profiler(profiler),
+      name(getPhaseName(phase)),
+      phase(static_cast<int>(phase)),
+      module(&module),
+      allocations(0) {
+    if (profiler) {
+        allocations = profiler->countAllocations();
+        begin = Clock::now();
+    }
+}
+
+Profiler::Scope::Scope(Profiler *profiler, const char *name, const std::string &module)
+    : profiler(profiler),
+      name(name),
+      phase(-1),
+      module(&module),
+      allocations(0) {
+    if (profiler) {
+        allocations = profiler->countAllocations();
+        begin = Clock::now();
+    }
+}
+
+Profiler::Scope::~Scope() {
+    if (profiler) {
+        const Clock::time_point end = Clock::now();
+        profiler->record(name, phase, *module, begin, end, profiler->countAllocations() - allocations);
+    }
+}
+
+Profiler::Profiler()
+    : origin(Clock::now()) {
+}
+
+const char *Profiler::getPhaseName(const Phase phase) {
+    switch (phase) {
+        case Phase::LOAD: return "load";
+        case Phase::ANALYZE: return "analyze";
+        case Phase::RESOLVE: return "resolve";
+        case Phase::SORT: return "sort";
+        case Phase::ASSEMBLE: return "assemble";
+    }
+
+    return "";
+}
+
+std::size_t Profiler::countAllocations() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocationCounter ? allocationCounter() : 0;
+}
+
+void Profiler::record(const char *name, const int phase, const std::string &module, const Clock::time_point begin, const Clock::time_point end, const std::size_t allocations) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (phase >= 0) {
+        statistics.phaseTimes[phase] += end - begin;
+        statistics.phaseAllocations[phase] += allocations;
+    }
+
+    if (recordEvents) {
+        const auto thread = threads.emplace(std::this_thread::get_id(), threads.size()).first;
+        events.emplace_back();
+        Event &event = events.back();
+        event.name = name;
+        event.module = module;
+        event.thread = thread->second;
+        event.begin = begin;
+        event.duration = end - begin;
+    }
+}
+
+void Profiler::count(const Counters &counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics.counters.modulesLoaded += counters.modulesLoaded;
+    statistics.counters.modulesReused += counters.modulesReused;
+    statistics.counters.bytesLoaded += counters.bytesLoaded;
+    statistics.counters.linesProcessed += counters.linesProcessed;
+    statistics.counters.bytesAssembled += counters.bytesAssembled;
+}
+
+Profiler::Statistics Profiler::getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+std::vector<Profiler::Event> Profiler::getEvents() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events;
+}
+
+void Profiler::writeChromeTrace(std::ostream &stream) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Complete events ("X"), with timestamps and durations in microseconds
+    const std::ios::fmtflags flags = stream.flags();
+    const std::streamsize precision = stream.precision();
+    stream.setf(std::ios::fixed, std::ios::floatfield);
+    stream.precision(3);
+    stream << "{\"traceEvents\":[";
+    for (std::size_t i = 0; i < events.size(); i++) {
+        const Event &event = events[i];
+        stream << (i > 0 ? ",\n" : "\n") << "{\"name\":";
+        writeJsonString(stream, event.name);
+        stream << ",\"cat\":\"glsl_assembler\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+        stream << ",\"ts\":" << toMicroseconds(event.begin - origin) << ",\"dur\":" << toMicroseconds(event.duration);
+        stream << ",\"args\":{\"module\":";
+        writeJsonString(stream, event.module);
+        stream << "}}";
+    }
+
+    stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+void Profiler::setRecordEvents(const bool recordEvents) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->recordEvents = recordEvents;
+}
+
+bool Profiler::isRecordEvents() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recordEvents;
+}
+
+void Profiler::setAllocationCounter(AllocationCounter allocationCounter) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->allocationCounter = std::move(allocationCounter);
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    statistics = Statistics();
+    events.clear();
+    threads.clear();
+    origin = Clock::now();
+}
@@ -0,0 +1,94 @@
+#include <glsl_assembler/source_minifier.h>
+
+namespace SourceMinifier {
+    static bool isSpace(const char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+    }
+
+    static bool isWordChar(const char ch) {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '.';
+    }
+
+    // Whether two characters separated by whitespace would form a different token once joined
+    static bool needsSpace(const char previous, const char next) {
+        if (isWordChar(previous) && isWordChar(next)) {
+            return true;
+        }
+
+        switch (next) {
+            case '=':
+                return previous == '+' || previous == '-' || previous == '*' || previous == '/' || previous == '%' ||
+                       previous == '<' || previous == '>' || previous == '=' || previous == '!' || previous == '&' ||
+                       previous == '|' || previous == '^';
+            case '+':
+            case '-':
+            case '<':
+            case '>':
+            case '&':
+            case '|':
+            case '^':
+                return previous == next;
+            case '*':
+            case '/':
+                return previous == '/';
+            default:
+                return false;
+        }
+    }
+
+    void minifyLine(const StringView &line, State &state, std::string &output) {
+        output.clear();
+
+        // Trim the line
+        std::size_t begin = 0;
+        std::size_t end = line.size();
+        while (begin < end && isSpace(line[begin])) {
+            begin++;
+        }
+
+        while (end > begin && isSpace(line[end - 1])) {
+            end--;
+        }
+
+        // Spliced lines (continued with a backslash) are kept as they are, since comments and whitespace can only be
+        // handled once they are joined
+        const bool spliced = state.continued || (!state.inBlockComment && end > begin && line[end - 1] == '\\');
+        if (spliced) {
+            if (state.continued) {
+                begin = 0;
+            }
+
+            output.assign(line.data() + begin, end - begin);
+            state.continued = end > begin && line[end - 1] == '\\';
+            return;
+        }
+
+        const bool directive = !state.inBlockComment && begin < end && line[begin] == '#';
+        bool pendingSpace = false;
+        for (std::size_t i = begin; i < end; i++) {
+            const char ch = line[i];
+            if (state.inBlockComment) {
+                if (ch == '*' && i + 1 < end && line[i + 1] == '/') {
+                    state.inBlockComment = false;
+                    pendingSpace = true;
+                    i++;
+                }
+            } else if (ch == '/' && i + 1 < end && line[i + 1] == '/') {
+                break;
+            } else if (ch == '/' && i + 1 < end && line[i + 1] == '*') {
+                state.inBlockComment = true;
+                i++;
+            } else if (isSpace(ch)) {
+                pendingSpace = true;
+            } else {
+                // A comment counts as whitespace
+                if (pendingSpace && !output.empty() && (directive || needsSpace(output.back(), ch))) {
+                    output += ' ';
+                }
+
+                pendingSpace = false;
+                output += ch;
+            }
+        }
+    }
+}
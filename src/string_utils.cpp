@@ -1,25 +1,297 @@
 #include <glsl_assembler/string_utils.h>
-#include <algorithm>
-#include <cctype>
-#include <locale>
-#include <sstream>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLSLASSEMBLER_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 functions are compiled for AVX2 even if the rest of the library is not, and only called if the CPU supports it
+#if defined(GLSLASSEMBLER_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GLSLASSEMBLER_TARGET_AVX2 __attribute__((target("avx2")))
+#define GLSLASSEMBLER_SIMD_AVX2
+#elif defined(GLSLASSEMBLER_SIMD_X86) && defined(_MSC_VER)
+#define GLSLASSEMBLER_TARGET_AVX2
+#define GLSLASSEMBLER_SIMD_AVX2
+#endif
 
 namespace StringUtils {
-    // https://stackoverflow.com/questions/216823/how-to-trim-a-stdstring
-    std::string ltrim_copy(std::string s) {
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-        return s;
+    namespace {
+        /**
+         * The scanning primitives for one instruction set.
+         */
+        struct Scanner {
+            SimdLevel level;
+            void (*findNewlines)(const char *data, std::size_t size, std::vector<std::size_t> &positions);
+            const char *(*skipWhitespace)(const char *begin, const char *end);
+            const char *(*skipWhitespaceBackward)(const char *begin, const char *end);
+        };
+
+        void findNewlinesScalar(const char *data, const std::size_t size, std::vector<std::size_t> &positions) {
+            const char *end = data + size;
+            for (const char *ch = data; (ch = static_cast<const char *>(std::memchr(ch, '\n', end - ch))); ch++) {
+                positions.push_back(ch - data);
+            }
+        }
+
+        const char *skipWhitespaceScalar(const char *begin, const char *end) {
+            while (begin != end && isSpace(*begin)) {
+                begin++;
+            }
+
+            return begin;
+        }
+
+        const char *skipWhitespaceBackwardScalar(const char *begin, const char *end) {
+            while (end != begin && isSpace(*(end - 1))) {
+                end--;
+            }
+
+            return end;
+        }
+
+        const Scanner scalarScanner = { SimdLevel::SCALAR, findNewlinesScalar, skipWhitespaceScalar, skipWhitespaceBackwardScalar };
+
+#ifdef GLSLASSEMBLER_SIMD_X86
+        int countTrailingZeros(const std::uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return static_cast<int>(index);
+#else
+            return __builtin_ctz(mask);
+#endif
+        }
+
+        int findLastSet(const std::uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanReverse(&index, mask);
+            return static_cast<int>(index);
+#else
+            return 31 - __builtin_clz(mask);
+#endif
+        }
+
+        void appendPositions(std::uint32_t mask, const std::size_t offset, std::vector<std::size_t> &positions) {
+            while (mask) {
+                positions.push_back(offset + countTrailingZeros(mask));
+                mask &= mask - 1;
+            }
+        }
+
+        // Chunks of 64 bytes have one newline or less most of the time (lines are usually longer), so the masks of the
+        // whole chunk are checked at once
+        void appendPositions(const std::uint32_t lowMask, const std::uint32_t highMask, const std::size_t offset, std::vector<std::size_t> &positions) {
+            if (lowMask | highMask) {
+                appendPositions(lowMask, offset, positions);
+                appendPositions(highMask, offset + 32, positions);
+            }
+        }
+
+        std::uint32_t newlineMask(const char *data, const __m128i newline) {
+            const __m128i low = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), newline);
+            const __m128i high = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)), newline);
+            return static_cast<std::uint32_t>(_mm_movemask_epi8(low)) | (static_cast<std::uint32_t>(_mm_movemask_epi8(high)) << 16);
+        }
+
+        // Whitespace is ' ' or '\t' to '\r': (ch - '\t') <= 4 as unsigned bytes
+        __m128i isSpace128(const __m128i chars) {
+            const __m128i shifted = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+            const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+            return _mm_or_si128(control, _mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')));
+        }
+
+        void findNewlinesSse2(const char *data, const std::size_t size, std::vector<std::size_t> &positions) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            std::size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                appendPositions(newlineMask(data + i, newline), newlineMask(data + i + 32, newline), i, positions);
+            }
+
+            for (; i < size; i++) {
+                if (data[i] == '\n') {
+                    positions.push_back(i);
+                }
+            }
+        }
+
+        const char *skipWhitespaceSse2(const char *begin, const char *end) {
+            for (; end - begin >= 16; begin += 16) {
+                const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                const std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(isSpace128(chars))) & 0xFFFF;
+                if (mask) {
+                    return begin + countTrailingZeros(mask);
+                }
+            }
+
+            return skipWhitespaceScalar(begin, end);
+        }
+
+        const char *skipWhitespaceBackwardSse2(const char *begin, const char *end) {
+            for (; end - begin >= 16; end -= 16) {
+                const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(end - 16));
+                const std::uint32_t mask = ~static_cast<std::uint32_t>(_mm_movemask_epi8(isSpace128(chars))) & 0xFFFF;
+                if (mask) {
+                    return end - 16 + findLastSet(mask) + 1;
+                }
+            }
+
+            return skipWhitespaceBackwardScalar(begin, end);
+        }
+
+        const Scanner sse2Scanner = { SimdLevel::SSE2, findNewlinesSse2, skipWhitespaceSse2, skipWhitespaceBackwardSse2 };
+#endif
+
+#ifdef GLSLASSEMBLER_SIMD_AVX2
+        GLSLASSEMBLER_TARGET_AVX2 __m256i isSpace256(const __m256i chars) {
+            const __m256i shifted = _mm256_sub_epi8(chars, _mm256_set1_epi8('\t'));
+            const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+            return _mm256_or_si256(control, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')));
+        }
+
+        GLSLASSEMBLER_TARGET_AVX2 void findNewlinesAvx2(const char *data, const std::size_t size, std::vector<std::size_t> &positions) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            std::size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+                appendPositions(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))),
+                                static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline))), i, positions);
+            }
+
+            for (; i < size; i++) {
+                if (data[i] == '\n') {
+                    positions.push_back(i);
+                }
+            }
+        }
+
+        // Indentation rarely exceeds 16 characters, so 16-byte blocks are checked before 32-byte ones
+        GLSLASSEMBLER_TARGET_AVX2 const char *skipWhitespaceAvx2(const char *begin, const char *end) {
+            if (end - begin < 32) {
+                return skipWhitespaceSse2(begin, end);
+            }
+
+            for (; end - begin >= 32; begin += 32) {
+                const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                const std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(isSpace256(chars)));
+                if (mask) {
+                    return begin + countTrailingZeros(mask);
+                }
+            }
+
+            return skipWhitespaceSse2(begin, end);
+        }
+
+        GLSLASSEMBLER_TARGET_AVX2 const char *skipWhitespaceBackwardAvx2(const char *begin, const char *end) {
+            if (end - begin < 32) {
+                return skipWhitespaceBackwardSse2(begin, end);
+            }
+
+            for (; end - begin >= 32; end -= 32) {
+                const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(end - 32));
+                const std::uint32_t mask = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(isSpace256(chars)));
+                if (mask) {
+                    return end - 32 + findLastSet(mask) + 1;
+                }
+            }
+
+            return skipWhitespaceBackwardSse2(begin, end);
+        }
+
+        const Scanner avx2Scanner = { SimdLevel::AVX2, findNewlinesAvx2, skipWhitespaceAvx2, skipWhitespaceBackwardAvx2 };
+
+        bool isAvx2Supported() {
+#if defined(_MSC_VER) && !defined(__clang__)
+            // AVX2 (CPUID leaf 7, EBX bit 5), with the AVX state enabled by the OS (OSXSAVE, then XCR0 bits 1 and 2)
+            int info[4];
+            __cpuid(info, 1);
+            if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+
+        const Scanner *getSupportedScanner() {
+#if defined(GLSLASSEMBLER_SIMD_AVX2)
+            static const Scanner *scanner = isAvx2Supported() ? &avx2Scanner : &sse2Scanner;
+            return scanner;
+#elif defined(GLSLASSEMBLER_SIMD_X86)
+            return &sse2Scanner;
+#else
+            return &scalarScanner;
+#endif
+        }
+
+        std::atomic<const Scanner *> currentScanner(getSupportedScanner());
     }
 
-    std::string rtrim_copy(std::string s) {
-        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
-        return s;
+    SimdLevel getSupportedSimdLevel() {
+        return getSupportedScanner()->level;
     }
 
-    std::string trim_copy(std::string s) {
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
-        return s;
+    SimdLevel getSimdLevel() {
+        return currentScanner.load(std::memory_order_relaxed)->level;
+    }
+
+    void setSimdLevel(const SimdLevel level) {
+        const Scanner *scanner = &scalarScanner;
+#ifdef GLSLASSEMBLER_SIMD_X86
+        if (level >= SimdLevel::SSE2) {
+            scanner = &sse2Scanner;
+        }
+#endif
+#ifdef GLSLASSEMBLER_SIMD_AVX2
+        if (level >= SimdLevel::AVX2) {
+            scanner = &avx2Scanner;
+        }
+#endif
+
+        if (scanner->level > getSupportedSimdLevel()) {
+            scanner = getSupportedScanner();
+        }
+
+        currentScanner.store(scanner, std::memory_order_relaxed);
+    }
+
+    void findNewlines(const char *data, const std::size_t size, std::vector<std::size_t> &positions) {
+        currentScanner.load(std::memory_order_relaxed)->findNewlines(data, size, positions);
+    }
+
+    const char *skipWhitespace(const char *begin, const char *end) {
+        return currentScanner.load(std::memory_order_relaxed)->skipWhitespace(begin, end);
+    }
+
+    const char *skipWhitespaceBackward(const char *begin, const char *end) {
+        return currentScanner.load(std::memory_order_relaxed)->skipWhitespaceBackward(begin, end);
+    }
+
+    std::string ltrim_copy(const std::string &s) {
+        const char *end = s.data() + s.size();
+        const char *begin = skipWhitespace(s.data(), end);
+        return std::string(begin, end);
+    }
+
+    std::string rtrim_copy(const std::string &s) {
+        const char *begin = s.data();
+        return std::string(begin, skipWhitespaceBackward(begin, begin + s.size()));
+    }
+
+    std::string trim_copy(const std::string &s) {
+        const char *begin = skipWhitespace(s.data(), s.data() + s.size());
+        return std::string(begin, skipWhitespaceBackward(begin, s.data() + s.size()));
     }
 
     std::string join(const std::vector<std::string> &list, const std::string &separator) {
@@ -32,13 +304,20 @@ namespace StringUtils {
     }
 
     std::vector<std::string> splitLines(const std::string &str) {
+        std::vector<std::size_t> newlines;
+        findNewlines(str.data(), str.size(), newlines);
+
+        // Same lines as std::getline: a trailing newline does not start a new line
         std::vector<std::string> result;
-        std::stringstream ss(str);
+        result.reserve(newlines.size() + 1);
+        std::size_t lineBegin = 0;
+        for (const std::size_t newline : newlines) {
+            result.emplace_back(str, lineBegin, newline - lineBegin);
+            lineBegin = newline + 1;
+        }
 
-        std::string line;
-        while (std::getline(ss, line)) {
-            // Note: std::getline removes the EOL terminator
-            result.push_back(line);
+        if (lineBegin < str.size()) {
+            result.emplace_back(str, lineBegin, std::string::npos);
         }
 
         return result;
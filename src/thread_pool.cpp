@@ -0,0 +1,177 @@
+#include <glsl_assembler/thread_pool.h>
+#include <algorithm>
+#include <exception>
+
+// The pool and the worker index of the calling thread
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+ThreadPool::ThreadPool(int threadCount)
+    : queuedTasks(0),
+      nextWorker(0) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back(new Worker());
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    condition.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+int ThreadPool::currentWorker() const {
+    return currentPool == this ? currentWorkerIndex : -1;
+}
+
+bool ThreadPool::popTask(const int workerIndex, std::function<void()> &task) {
+    // Own queue first (most recent task)
+    if (workerIndex >= 0) {
+        Worker &worker = *workers[workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    // Steal from the other queues (oldest task)
+    const int count = workers.size();
+    const int start = workerIndex >= 0 ? workerIndex + 1 : 0;
+    for (int i = 0; i < count; i++) {
+        Worker &worker = *workers[(start + i) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(const int workerIndex) {
+    currentPool = this;
+    currentWorkerIndex = workerIndex;
+
+    std::function<void()> task;
+    while (true) {
+        if (popTask(workerIndex, task)) {
+            try {
+                task();
+            } catch (...) {
+                // Ignored, see submit()
+            }
+
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return stopping || queuedTasks > 0; });
+        if (stopping && queuedTasks == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    int workerIndex = currentWorker();
+    if (workerIndex < 0) {
+        workerIndex = nextWorker++ % workers.size();
+    }
+
+    {
+        Worker &worker = *workers[workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        queuedTasks++;
+    }
+
+    // Lock the mutex so that a worker checking the queued tasks does not miss the notification
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+
+    condition.notify_one();
+}
+
+void ThreadPool::parallelFor(const int count, const std::function<void(int)> &function) {
+    if (count <= 0) {
+        return;
+    }
+
+    struct Group {
+        std::atomic<int> remaining;
+        std::vector<std::exception_ptr> exceptions;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    // The group outlives the tasks since this method waits for all of them
+    Group group;
+    group.remaining = count;
+    group.exceptions.resize(count);
+    for (int i = 0; i < count; i++) {
+        submit([&group, &function, i]() {
+            try {
+                function(i);
+            } catch (...) {
+                group.exceptions[i] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(group.mutex);
+            if (--group.remaining == 0) {
+                group.condition.notify_all();
+            }
+        });
+    }
+
+    // Help while waiting
+    const int workerIndex = currentWorker();
+    std::function<void()> task;
+    while (group.remaining > 0) {
+        if (popTask(workerIndex, task)) {
+            try {
+                task();
+            } catch (...) {
+                // Ignored, see submit()
+            }
+
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(group.mutex);
+        group.condition.wait(lock, [&group]() { return group.remaining == 0; });
+    }
+
+    // Make sure the last task released the group mutex before destroying it
+    {
+        std::lock_guard<std::mutex> lock(group.mutex);
+    }
+
+    for (const std::exception_ptr &exception : group.exceptions) {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+}
@@ -0,0 +1,449 @@
+#include <glsl_assembler/tree_shaker.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/string_view.h>
+#include <string>
+#include <unordered_map>
+
+namespace TreeShaker {
+    /**
+     * A group of top-level declarations (usually one), with the lines belonging to it.
+     */
+    struct Item {
+        int firstLine = 0;
+        int lastLine = 0;
+
+        /**
+         * Whether the item is always kept.
+         */
+        bool root = false;
+
+        bool kept = false;
+
+        /**
+         * Names defined by the item.
+         */
+        std::vector<std::string> names;
+
+        /**
+         * Identifiers referenced by the item.
+         */
+        std::vector<std::string> references;
+    };
+
+    /**
+     * Splits the source of a module into items.
+     */
+    class ModuleScanner {
+    private:
+        enum class TokenType { NONE, IDENTIFIER, PUNCTUATION };
+
+        /**
+         * State of the declaration being scanned.
+         */
+        struct Declaration {
+            int tokenCount = 0;
+            bool isConst = false;
+            bool isStruct = false;
+            bool isFunction = false;
+            bool afterStructBody = false;
+            bool hasDeclarators = false;
+            bool sawEquals = false;
+            std::string name;
+            std::string lastIdentifier;
+            std::vector<std::string> names;
+        };
+
+        std::vector<Item> &items;
+
+        /**
+         * Index of the item being scanned (-1 if none).
+         */
+        int current = -1;
+
+        /**
+         * Whether the current item is complete (it can only be extended by a declaration on its last line).
+         */
+        bool currentEnded = false;
+
+        Declaration declaration;
+        int braceDepth = 0;
+        int parenDepth = 0;
+        int bracketDepth = 0;
+        bool inBlockComment = false;
+
+        /**
+         * Whether the block comment being scanned started on the last line of the current (complete) item: the
+         * comment belongs to it, up to the line where the comment ends.
+         */
+        bool inTrailingComment = false;
+
+        bool inDirective = false;
+        bool failed = false;
+
+        TokenType previousType = TokenType::NONE;
+        TokenType beforePreviousType = TokenType::NONE;
+        char previousPunctuation = 0;
+        std::string previousIdentifier;
+
+        static bool isIdentifierStart(const char ch) {
+            return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+        }
+
+        static bool isIdentifierChar(const char ch) {
+            return isIdentifierStart(ch) || (ch >= '0' && ch <= '9');
+        }
+
+        static bool isDigit(const char ch) {
+            return ch >= '0' && ch <= '9';
+        }
+
+        static bool isSpace(const char ch) {
+            return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+        }
+
+        bool isTopLevel() const {
+            return braceDepth == 0 && parenDepth == 0 && bracketDepth == 0;
+        }
+
+        /**
+         * Called before each token outside directives: starts a new item if needed.
+         */
+        void beginToken(const int line) {
+            if (current >= 0 && currentEnded && line > items[current].lastLine) {
+                current = -1;
+            }
+
+            if (current < 0) {
+                const int firstLine = items.empty() ? 0 : items.back().lastLine + 1;
+                items.emplace_back();
+                current = items.size() - 1;
+                items[current].firstLine = firstLine;
+                items[current].lastLine = line;
+            }
+
+            currentEnded = false;
+            declaration.tokenCount++;
+        }
+
+        void endDeclaration(const int line) {
+            Item &item = items[current];
+            if (declaration.isFunction) {
+                item.names.push_back(declaration.name);
+                item.root = item.root || declaration.name == "main";
+            } else if (declaration.isStruct && !declaration.hasDeclarators && !declaration.name.empty()) {
+                item.names.push_back(declaration.name);
+            } else if (declaration.isConst && !declaration.names.empty()) {
+                item.names.insert(item.names.end(), declaration.names.begin(), declaration.names.end());
+            } else if (declaration.tokenCount > 1) {
+                // Any other declaration is part of the interface (an empty declaration, i.e. a lone ';', is not)
+                item.root = true;
+            }
+
+            item.lastLine = line;
+            currentEnded = true;
+            declaration = Declaration();
+        }
+
+        void identifier(const std::string &name, const int line) {
+            beginToken(line);
+            items[current].references.push_back(name);
+
+            if (isTopLevel()) {
+                if (declaration.tokenCount == 1 && name == "struct") {
+                    declaration.isStruct = true;
+                } else if (name == "const" && !declaration.isFunction && !declaration.sawEquals) {
+                    declaration.isConst = true;
+                } else if (declaration.isStruct && declaration.afterStructBody) {
+                    declaration.hasDeclarators = true;
+                } else if (declaration.isStruct && declaration.name.empty() && previousType == TokenType::IDENTIFIER && previousIdentifier == "struct") {
+                    declaration.name = name;
+                }
+
+                declaration.lastIdentifier = name;
+            }
+
+            beforePreviousType = previousType;
+            previousType = TokenType::IDENTIFIER;
+            previousIdentifier = name;
+        }
+
+        void punctuation(const char ch, const int line) {
+            beginToken(line);
+            switch (ch) {
+                case '(':
+                    // A function: a name preceded by a type (or an array type) before any initializer
+                    if (isTopLevel() && !declaration.isFunction && !declaration.isStruct && !declaration.isConst && !declaration.sawEquals &&
+                        previousType == TokenType::IDENTIFIER &&
+                        (beforePreviousType == TokenType::IDENTIFIER || (beforePreviousType == TokenType::PUNCTUATION && previousPunctuation == ']'))) {
+                        declaration.isFunction = true;
+                        declaration.name = previousIdentifier;
+                    }
+
+                    parenDepth++;
+                    break;
+                case ')':
+                    parenDepth--;
+                    break;
+                case '[':
+                    bracketDepth++;
+                    break;
+                case ']':
+                    bracketDepth--;
+                    break;
+                case '=':
+                    if (isTopLevel()) {
+                        if (declaration.isConst && !declaration.lastIdentifier.empty()) {
+                            declaration.names.push_back(declaration.lastIdentifier);
+                        }
+
+                        declaration.sawEquals = true;
+                    }
+                    break;
+                case '{':
+                    braceDepth++;
+                    break;
+                case '}':
+                    braceDepth--;
+                    if (braceDepth == 0 && parenDepth == 0 && bracketDepth == 0) {
+                        if (declaration.isFunction) {
+                            endDeclaration(line);
+                        } else if (declaration.isStruct) {
+                            declaration.afterStructBody = true;
+                        }
+                    }
+                    break;
+                case ';':
+                    if (isTopLevel()) {
+                        endDeclaration(line);
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            failed = failed || braceDepth < 0 || parenDepth < 0 || bracketDepth < 0;
+            beforePreviousType = previousType;
+            previousType = TokenType::PUNCTUATION;
+            previousPunctuation = ch;
+        }
+
+        /**
+         * Scans a preprocessor directive line (or a continuation line).
+         */
+        void directive(const StringView &text, const int line) {
+            // Inside a declaration, the directive belongs to it; otherwise it is an item on its own (along with its
+            // continuation lines), always kept
+            const bool inDeclaration = current >= 0 && !currentEnded;
+            if (!inDeclaration && !(inDirective && current >= 0)) {
+                const int firstLine = items.empty() ? 0 : items.back().lastLine + 1;
+                items.emplace_back();
+                current = items.size() - 1;
+                items[current].firstLine = firstLine;
+                items[current].root = true;
+            }
+
+            Item &item = items[current];
+            for (std::size_t i = 0; i < text.size();) {
+                if (inBlockComment) {
+                    if (text[i] == '*' && i + 1 < text.size() && text[i + 1] == '/') {
+                        inBlockComment = false;
+                        i += 2;
+                    } else {
+                        i++;
+                    }
+                } else if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+                    break;
+                } else if (text[i] == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+                    inBlockComment = true;
+                    i += 2;
+                } else if (isIdentifierStart(text[i])) {
+                    const std::size_t begin = i;
+                    while (i < text.size() && isIdentifierChar(text[i])) {
+                        i++;
+                    }
+
+                    item.references.emplace_back(text.data() + begin, i - begin);
+                } else {
+                    i++;
+                }
+            }
+
+            inDirective = text.size() > 0 && text[text.size() - 1] == '\\';
+            if (!inDeclaration) {
+                item.lastLine = line;
+                currentEnded = true;
+                if (!inDirective && !inBlockComment) {
+                    current = -1;
+                }
+            }
+
+            inTrailingComment = inBlockComment && !inDeclaration;
+        }
+
+    public:
+        explicit ModuleScanner(std::vector<Item> &items)
+            : items(items) {
+        }
+
+        void scanLine(const StringView &text, const int line) {
+            std::size_t i = 0;
+            if (!inBlockComment) {
+                while (i < text.size() && isSpace(text[i])) {
+                    i++;
+                }
+
+                if (inDirective || (i < text.size() && text[i] == '#')) {
+                    directive(text, line);
+                    return;
+                }
+            }
+
+            while (i < text.size()) {
+                const char ch = text[i];
+                if (inBlockComment) {
+                    if (ch == '*' && i + 1 < text.size() && text[i + 1] == '/') {
+                        inBlockComment = false;
+                        i += 2;
+                        if (inTrailingComment) {
+                            items[current].lastLine = line;
+                            inTrailingComment = false;
+                        }
+                    } else {
+                        i++;
+                    }
+                } else if (isSpace(ch)) {
+                    i++;
+                } else if (ch == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+                    break;
+                } else if (ch == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+                    inBlockComment = true;
+                    i += 2;
+                } else if (isIdentifierStart(ch)) {
+                    const std::size_t begin = i;
+                    while (i < text.size() && isIdentifierChar(text[i])) {
+                        i++;
+                    }
+
+                    identifier(std::string(text.data() + begin, i - begin), line);
+                } else if (isDigit(ch) || (ch == '.' && i + 1 < text.size() && isDigit(text[i + 1]))) {
+                    // Numbers, including exponents and suffixes
+                    i++;
+                    while (i < text.size() && (isIdentifierChar(text[i]) || text[i] == '.' ||
+                                               ((text[i] == '+' || text[i] == '-') && (text[i - 1] == 'e' || text[i - 1] == 'E')))) {
+                        i++;
+                    }
+                } else if ((ch == '=' || ch == '!' || ch == '<' || ch == '>') && i + 1 < text.size() && text[i + 1] == '=') {
+                    // Comparison operators are not assignments (and have no effect on the declaration structure)
+                    punctuation(0, line);
+                    i += 2;
+                } else {
+                    punctuation(ch, line);
+                    i++;
+                }
+            }
+
+            // A block comment continuing after the end of an item must not be split from it
+            if (inBlockComment && !inTrailingComment && current >= 0 && currentEnded && items[current].lastLine == line) {
+                inTrailingComment = true;
+            }
+        }
+
+        /**
+         * Completes the scan.
+         * @param lineCount the number of lines of the module
+         * @return false if the module could not be split into declarations
+         */
+        bool finish(const int lineCount) {
+            if (failed || braceDepth != 0 || parenDepth != 0 || bracketDepth != 0 || (current >= 0 && !currentEnded)) {
+                return false;
+            }
+
+            // Trailing comments belong to the last item
+            if (!items.empty()) {
+                items.back().lastLine = lineCount - 1;
+            }
+
+            return true;
+        }
+    };
+
+    void shake(const std::vector<Module *> &modules, std::vector<std::vector<ModuleGraph::LineRange>> &keptRanges) {
+        // Split the modules into items
+        std::vector<std::vector<Item>> moduleItems(modules.size());
+        for (std::size_t m = 0; m < modules.size(); m++) {
+            const Module *module = modules[m];
+            std::vector<Item> &items = moduleItems[m];
+            ModuleScanner scanner(items);
+            for (int i = 0; i < module->getSourceLinesCount(); i++) {
+                scanner.scanLine(module->getSourceLine(i), i);
+            }
+
+            if (!scanner.finish(module->getSourceLinesCount()) || items.empty()) {
+                // Keep the whole module, referencing all its identifiers
+                Item item;
+                item.lastLine = module->getSourceLinesCount() - 1;
+                item.root = true;
+                for (const Item &scannedItem : items) {
+                    item.references.insert(item.references.end(), scannedItem.references.begin(), scannedItem.references.end());
+                }
+
+                items.assign(1, item);
+            }
+        }
+
+        // Index the items by the names they define
+        std::unordered_map<std::string, std::vector<Item *>> definitions;
+        std::vector<Item *> pending;
+        for (std::vector<Item> &items : moduleItems) {
+            for (Item &item : items) {
+                for (const std::string &name : item.names) {
+                    definitions[name].push_back(&item);
+                }
+
+                if (item.root) {
+                    item.kept = true;
+                    pending.push_back(&item);
+                }
+            }
+        }
+
+        // Keep everything reachable from the roots
+        while (!pending.empty()) {
+            const Item *item = pending.back();
+            pending.pop_back();
+            for (const std::string &reference : item->references) {
+                const auto it = definitions.find(reference);
+                if (it == definitions.end()) {
+                    continue;
+                }
+
+                for (Item *definition : it->second) {
+                    if (!definition->kept) {
+                        definition->kept = true;
+                        pending.push_back(definition);
+                    }
+                }
+            }
+        }
+
+        // Merge the kept items into line ranges
+        keptRanges.assign(modules.size(), std::vector<ModuleGraph::LineRange>());
+        for (std::size_t m = 0; m < modules.size(); m++) {
+            std::vector<ModuleGraph::LineRange> &ranges = keptRanges[m];
+            for (const Item &item : moduleItems[m]) {
+                if (!item.kept || item.lastLine < item.firstLine) {
+                    continue;
+                }
+
+                if (!ranges.empty() && ranges.back().end + 1 == item.firstLine) {
+                    ranges.back().end = item.lastLine;
+                } else {
+                    ModuleGraph::LineRange range;
+                    range.begin = item.firstLine;
+                    range.end = item.lastLine;
+                    ranges.push_back(range);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,190 @@
+#include <glsl_assembler/variant_assembler.h>
+#include <glsl_assembler/assembly_sink.h>
+#include <glsl_assembler/hash.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/thread_pool.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    /**
+     * Builds the define lines of a variant, each one followed by a newline.
+     */
+    std::string buildDefineBlock(const std::vector<VariantAssembler::Define> &defines) {
+        std::string block;
+        for (const VariantAssembler::Define &define : defines) {
+            if (define.name.empty() || define.name.find('\n') != std::string::npos || define.value.find('\n') != std::string::npos) {
+                throw std::runtime_error("Invalid define: '" + define.name + "'");
+            }
+
+            block += "#define ";
+            block += define.name;
+            if (!define.value.empty()) {
+                block += ' ';
+                block += define.value;
+            }
+
+            block += '\n';
+        }
+
+        return block;
+    }
+
+    /**
+     * Forwards the assembled source of the graph to another sink, inserting the define lines after the hoisted lines.
+     */
+    class DefineInsertingSink : public AssemblySink {
+    private:
+        AssemblySink &sink;
+        const std::string &defineBlock;
+
+        /**
+         * Number of newlines to forward before inserting the define lines.
+         */
+        int newlinesBefore;
+
+        bool inserted = false;
+
+    public:
+        DefineInsertingSink(AssemblySink &sink, const std::string &defineBlock, const int hoistedLinesCount)
+            : sink(sink),
+              defineBlock(defineBlock),
+              newlinesBefore(hoistedLinesCount) {
+        }
+
+        void reserve(const std::size_t size) override {
+            sink.reserve(size + defineBlock.size());
+        }
+
+        void write(const char *data, const std::size_t size) override {
+            if (inserted) {
+                sink.write(data, size);
+                return;
+            }
+
+            // The define lines go right after the newline ending the last hoisted line
+            const char *end = data + size;
+            const char *split = data;
+            while (newlinesBefore > 0) {
+                const char *newline = static_cast<const char *>(std::memchr(split, '\n', end - split));
+                if (!newline) {
+                    sink.write(data, size);
+                    return;
+                }
+
+                split = newline + 1;
+                newlinesBefore--;
+            }
+
+            if (split != data) {
+                sink.write(data, split - data);
+            }
+
+            sink.write(defineBlock.data(), defineBlock.size());
+            inserted = true;
+            if (split != end) {
+                sink.write(split, end - split);
+            }
+        }
+
+        /**
+         * Inserts the define lines if the source ended before (empty source, or only hoisted lines).
+         */
+        void finish() {
+            if (inserted || defineBlock.empty()) {
+                return;
+            }
+
+            if (newlinesBefore > 0) {
+                // The last hoisted line has no newline: the define lines go after it, without a trailing newline
+                sink.write("\n", 1);
+                sink.write(defineBlock.data(), defineBlock.size() - 1);
+            } else {
+                sink.write(defineBlock.data(), defineBlock.size());
+            }
+
+            inserted = true;
+        }
+    };
+
+    void writeVariantSource(const ModuleGraph &moduleGraph, const std::string &defineBlock, AssemblySink &sink) {
+        DefineInsertingSink insertingSink(sink, defineBlock, moduleGraph.getHoistedLinesCount());
+
+        // The stored source is copied in a single chunk, otherwise it is written again from the modules
+        const std::string &assembledSource = moduleGraph.getAssembledSource();
+        if (moduleGraph.isKeepAssembledSource() && assembledSource.size() == moduleGraph.getAssembledSourceSize()) {
+            insertingSink.reserve(assembledSource.size());
+            if (!assembledSource.empty()) {
+                insertingSink.write(assembledSource.data(), assembledSource.size());
+            }
+        } else {
+            moduleGraph.writeAssembledSource(insertingSink);
+        }
+
+        insertingSink.finish();
+    }
+}
+
+Module *VariantAssembler::Variant::mapLine(const int line, int &moduleLine) const {
+    const int defineLinesEnd = defineLinesBegin + static_cast<int>(defines.size());
+    if (line >= defineLinesBegin && line < defineLinesEnd) {
+        moduleLine = -1;
+        return nullptr;
+    }
+
+    return moduleGraph->mapLine(line < defineLinesBegin ? line : line - static_cast<int>(defines.size()), moduleLine);
+}
+
+int VariantAssembler::Variant::mapModuleLine(const Module *module, const int moduleLine, std::vector<int> &lines) const {
+    moduleGraph->mapModuleLine(module, moduleLine, lines);
+    for (int &line : lines) {
+        if (line >= defineLinesBegin) {
+            line += defines.size();
+        }
+    }
+
+    return lines.size();
+}
+
+VariantAssembler::VariantAssembler(const ModuleGraph &moduleGraph)
+    : moduleGraph(moduleGraph) {
+}
+
+VariantAssembler::Variant VariantAssembler::assemble(const std::vector<Define> &defines) const {
+    const std::string defineBlock = buildDefineBlock(defines);
+    Variant variant;
+    variant.defines = defines;
+    variant.programHash = Hash::combine(moduleGraph.getProgramHash(), Hash::xxh64(defineBlock));
+    variant.defineLinesBegin = moduleGraph.getHoistedLinesCount();
+    variant.moduleGraph = &moduleGraph;
+
+    StringAssemblySink sink(variant.source);
+    writeVariantSource(moduleGraph, defineBlock, sink);
+    return variant;
+}
+
+std::vector<VariantAssembler::Variant> VariantAssembler::assembleAll(const std::vector<std::vector<Define>> &defineSets, ThreadPool *threadPool) const {
+    std::vector<Variant> variants(defineSets.size());
+    const auto assembleVariant = [&](const int index) {
+        variants[index] = assemble(defineSets[index]);
+    };
+
+    if (threadPool) {
+        threadPool->parallelFor(defineSets.size(), assembleVariant);
+    } else {
+        for (int i = 0; i < defineSets.size(); i++) {
+            assembleVariant(i);
+        }
+    }
+
+    return variants;
+}
+
+void VariantAssembler::writeSource(const std::vector<Define> &defines, AssemblySink &sink) const {
+    writeVariantSource(moduleGraph, buildDefineBlock(defines), sink);
+}
+
+std::uint64_t VariantAssembler::getProgramHash(const std::vector<Define> &defines) const {
+    const std::string defineBlock = buildDefineBlock(defines);
+    return Hash::combine(moduleGraph.getProgramHash(), Hash::xxh64(defineBlock));
+}
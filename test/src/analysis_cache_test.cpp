@@ -0,0 +1,201 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/analysis_cache.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+class AnalysisTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        return files.at(path);
+    }
+};
+
+static void requireSameModule(const ParsedModule &actual, const ParsedModule &expected) {
+    REQUIRE(actual.getSourceLinesCount() == expected.getSourceLinesCount());
+    for (int i = 0; i < expected.getSourceLinesCount(); i++) {
+        REQUIRE(actual.getSourceLine(i) == expected.getSourceLine(i));
+    }
+
+    REQUIRE(actual.getIncludeCount() == expected.getIncludeCount());
+    for (int i = 0; i < expected.getIncludeCount(); i++) {
+        REQUIRE(actual.getInclude(i).path == expected.getInclude(i).path);
+        REQUIRE(actual.getInclude(i).line == expected.getInclude(i).line);
+        REQUIRE(actual.getInclude(i).type == expected.getInclude(i).type);
+    }
+
+    REQUIRE(actual.getHoistedLinesCount() == expected.getHoistedLinesCount());
+    for (int i = 0; i < expected.getHoistedLinesCount(); i++) {
+        REQUIRE(actual.getHoistedLine(i).line == expected.getHoistedLine(i).line);
+        REQUIRE(actual.getHoistedLine(i).index == expected.getHoistedLine(i).index);
+    }
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+SCENARIO("AnalysisCache works", "[analysis_cache_test.cpp]") {
+    const std::string path = "analysis_cache_test.bin";
+    std::remove(path.c_str());
+
+    const std::string source = "#version 330\n#include <a.glsl>\nvoid main() {}\n#include \"b/c.glsl\"\nprecision highp float;\n";
+    AnalysisCache analysisCache(path);
+    REQUIRE(!analysisCache.load());
+
+    // A miss stores the analysis, a hit gives the same module
+    const std::shared_ptr<const ParsedModule> expected = ParsedModule::parse("main.glsl", source);
+    requireSameModule(*ParsedModule::parse("main.glsl", source, &analysisCache), *expected);
+    REQUIRE(analysisCache.size() == 1);
+    REQUIRE(analysisCache.getStatistics().misses == 1);
+    requireSameModule(*ParsedModule::parse("other.glsl", source, &analysisCache), *expected);
+    REQUIRE(analysisCache.getStatistics().hits == 1);
+    REQUIRE_THROWS(ParsedModule::parse("invalid.glsl", "#include <>\n", &analysisCache));
+    REQUIRE(analysisCache.size() == 1);
+
+    // Round trip through the file
+    analysisCache.save();
+    AnalysisCache loadedCache(path);
+    REQUIRE(loadedCache.load());
+    REQUIRE(loadedCache.size() == 1);
+    requireSameModule(*ParsedModule::parse("main.glsl", source, &loadedCache), *expected);
+    REQUIRE(loadedCache.getStatistics().hits == 1);
+
+    // Entries are keyed by contents
+    AnalysisCache::Analysis analysis;
+    REQUIRE(!loadedCache.find(expected->getSourceHash(), expected->getSourceSize() + 1, analysis));
+    REQUIRE(loadedCache.find(expected->getSourceHash(), expected->getSourceSize(), analysis));
+    REQUIRE(analysis.includes.size() == 2);
+    REQUIRE(analysis.hoistedLines.size() == 2);
+
+    // Analyses that do not fit the source are ignored: lines out of range, repeated, unordered, or both an include
+    // and a hoisted line
+    std::vector<AnalysisCache::Analysis> invalidAnalyses(5, analysis);
+    invalidAnalyses[0].hoistedLines.push_back(100);
+    invalidAnalyses[1].includes.push_back(analysis.includes[1]);
+    invalidAnalyses[2].hoistedLines = { 4, 0 };
+    invalidAnalyses[3].hoistedLines = { 0, 3, 4 };
+    invalidAnalyses[4].includes = { analysis.includes[0], analysis.includes[0] };
+    for (const AnalysisCache::Analysis &invalidAnalysis : invalidAnalyses) {
+        loadedCache.store(expected->getSourceHash(), expected->getSourceSize(), invalidAnalysis);
+        requireSameModule(*ParsedModule::parse("main.glsl", source, &loadedCache), *expected);
+    }
+
+    // Corrupt, truncated and stale files are ignored
+    const std::string contents = readFile(path);
+    std::string corrupt = contents;
+    corrupt[20] ^= 1;
+    writeFile(path, corrupt);
+    REQUIRE(!loadedCache.load());
+    REQUIRE(loadedCache.size() == 0);
+    writeFile(path, contents.substr(0, contents.size() - 1));
+    REQUIRE(!loadedCache.load());
+    writeFile(path, "");
+    REQUIRE(!loadedCache.load());
+    std::string stale = contents;
+    stale[8] = AnalysisCache::FORMAT_VERSION + 1;
+    writeFile(path, stale);
+    REQUIRE(!loadedCache.load());
+    writeFile(path, contents);
+    REQUIRE(loadedCache.load());
+    REQUIRE(loadedCache.size() == 1);
+
+    std::remove(path.c_str());
+}
+
+SCENARIO("AnalysisCache evicts the least recently used entries", "[analysis_cache_test.cpp]") {
+    const std::string path = "analysis_cache_eviction_test.bin";
+    std::remove(path.c_str());
+
+    AnalysisCache analysisCache(path, 3);
+    REQUIRE(analysisCache.getMaxEntries() == 3);
+    AnalysisCache::Analysis analysis;
+    for (std::uint64_t hash = 1; hash <= 3; hash++) {
+        analysisCache.store(hash, 10, analysis);
+    }
+
+    // Entry 1 is used again, so entries 2 and 3 are evicted first
+    REQUIRE(analysisCache.find(1, 10, analysis));
+    analysisCache.store(4, 10, analysis);
+    analysisCache.store(5, 10, analysis);
+    REQUIRE(analysisCache.size() == 3);
+    REQUIRE(analysisCache.getStatistics().evictions == 2);
+    REQUIRE(!analysisCache.find(2, 10, analysis));
+    REQUIRE(!analysisCache.find(3, 10, analysis));
+    REQUIRE(analysisCache.find(1, 10, analysis));
+    REQUIRE(analysisCache.find(4, 10, analysis));
+    REQUIRE(analysisCache.find(5, 10, analysis));
+
+    // The order is saved: entry 1 is now the least recently used
+    analysisCache.save();
+    AnalysisCache loadedCache(path, 2);
+    REQUIRE(loadedCache.load());
+    REQUIRE(loadedCache.size() == 2);
+    REQUIRE(!loadedCache.find(1, 10, analysis));
+    REQUIRE(loadedCache.find(4, 10, analysis));
+
+    // Lowering the maximum evicts, zero means unlimited
+    loadedCache.setMaxEntries(1);
+    REQUIRE(loadedCache.size() == 1);
+    REQUIRE(loadedCache.find(4, 10, analysis));
+    loadedCache.setMaxEntries(0);
+    for (std::uint64_t hash = 10; hash < 20; hash++) {
+        loadedCache.store(hash, 10, analysis);
+    }
+    REQUIRE(loadedCache.size() == 11);
+
+    std::remove(path.c_str());
+}
+
+SCENARIO("AnalysisCache with ModuleGraph", "[analysis_cache_test.cpp]") {
+    const std::string path = "analysis_cache_graph_test.bin";
+    std::remove(path.c_str());
+
+    AnalysisTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#version 330\n#include <a.glsl>\nvoid main() { a(); }\n";
+    loader.files["shaders/a.glsl"] = "precision mediump float;\nvoid a() {}\n";
+
+    ModuleGraph expected;
+    expected.setModuleLoader(&loader);
+    expected.setIncludeDir("shaders");
+    expected.loadModule("shaders/main.glsl");
+
+    {
+        AnalysisCache analysisCache(path);
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&loader);
+        moduleGraph.setAnalysisCache(&analysisCache);
+        moduleGraph.setIncludeDir("shaders");
+        REQUIRE(moduleGraph.loadModule("shaders/main.glsl") == expected.getAssembledSource());
+        REQUIRE(analysisCache.getStatistics().misses == 2);
+        analysisCache.save();
+    }
+
+    // Next run: everything comes from the analysis cache, also through a module cache
+    AnalysisCache analysisCache(path);
+    REQUIRE(analysisCache.load());
+    ModuleCache moduleCache;
+    moduleCache.setAnalysisCache(&analysisCache);
+    REQUIRE(moduleCache.getAnalysisCache() == &analysisCache);
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setModuleCache(&moduleCache);
+    moduleGraph.setIncludeDir("shaders");
+    REQUIRE(moduleGraph.loadModule("shaders/main.glsl") == expected.getAssembledSource());
+    REQUIRE(analysisCache.getStatistics().hits == 2);
+    REQUIRE(analysisCache.getStatistics().misses == 0);
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/arena.h>
+#include <glsl_assembler/module.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+SCENARIO("Arena works", "[arena_test.cpp]") {
+    Arena arena(256);
+    REQUIRE(arena.getCapacity() == 0);
+
+    // Aligned allocations, packed in the same block
+    char *first = static_cast<char *>(arena.allocate(3, 1));
+    char *second = static_cast<char *>(arena.allocate(8, 8));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(second) % 8 == 0);
+    REQUIRE(second > first);
+    REQUIRE(second - first < 16);
+    REQUIRE(arena.getCapacity() == 256);
+    REQUIRE(arena.getAllocatedSize() >= 11);
+
+    // New blocks when full, and a dedicated block for large allocations
+    for (int i = 0; i < 100; i++) {
+        std::int64_t *value = arena.create<std::int64_t>(i);
+        REQUIRE(*value == i);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(value) % alignof(std::int64_t) == 0);
+    }
+
+    REQUIRE(arena.getCapacity() > 256);
+    const std::size_t capacity = arena.getCapacity();
+    char *large = static_cast<char *>(arena.allocate(4 * 1024 * 1024, 1));
+    large[4 * 1024 * 1024 - 1] = 'x';
+    REQUIRE(arena.getCapacity() >= capacity + 4 * 1024 * 1024);
+    REQUIRE(arena.create<std::int64_t>(7) != nullptr);
+    REQUIRE(arena.getCapacity() >= capacity + 4 * 1024 * 1024);
+
+    // Release keeps the largest block, which is reused
+    arena.release();
+    REQUIRE(arena.getAllocatedSize() == 0);
+    REQUIRE(arena.getCapacity() >= 4 * 1024 * 1024);
+    REQUIRE(arena.getCapacity() < capacity + 4 * 1024 * 1024);
+    REQUIRE(arena.allocate(16) == large);
+}
+
+SCENARIO("ArenaAllocator works", "[arena_test.cpp]") {
+    Arena arena;
+    std::vector<std::string, ArenaAllocator<std::string>> strings{ ArenaAllocator<std::string>(&arena) };
+    for (int i = 0; i < 1000; i++) {
+        strings.push_back(std::to_string(i));
+    }
+
+    REQUIRE(strings[999] == "999");
+    REQUIRE(arena.getAllocatedSize() >= 1000 * sizeof(std::string));
+    REQUIRE(strings.get_allocator().getArena() == &arena);
+    REQUIRE(ArenaAllocator<int>(&arena) == ArenaAllocator<char>(&arena));
+    REQUIRE(ArenaAllocator<int>() != ArenaAllocator<char>(&arena));
+
+    // Without an arena, the heap is used
+    std::vector<int, ArenaAllocator<int>> values(100, 1);
+    REQUIRE(values.get_allocator().getArena() == nullptr);
+    REQUIRE(values[99] == 1);
+
+    // Modules created in an arena keep their dependency records in it
+    const std::size_t allocatedSize = arena.getAllocatedSize();
+    Module *module = Module::fromParsedModule(ParsedModule::parse("a.glsl", "#include \"b.glsl\"\n#include <c.glsl>\n"), arena);
+    REQUIRE(module->getDependencyCount() == 2);
+    REQUIRE(module->getDependency(1).moduleId == "c.glsl");
+    REQUIRE(arena.getAllocatedSize() >= allocatedSize + sizeof(Module) + 2 * sizeof(Module::Dependency));
+    module->~Module();
+}
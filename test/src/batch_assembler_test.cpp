@@ -0,0 +1,139 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/batch_assembler.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/thread_pool.h>
+#include <atomic>
+#include <map>
+#include <stdexcept>
+
+class BatchTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+    std::atomic<int> loadCount;
+
+    BatchTestModuleLoader()
+        : loadCount(0) {
+    }
+
+    std::string load(const std::string &path) override {
+        loadCount++;
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+};
+
+SCENARIO("BatchAssembler works", "[batch_assembler_test.cpp]") {
+    BatchTestModuleLoader loader;
+    loader.files["shaders/common.glsl"] = "#version 330\nvoid common() {}\n";
+    loader.files["shaders/lighting.glsl"] = "#include <common.glsl>\nvoid lighting() { common(); }\n";
+    std::vector<std::string> modulePaths;
+    for (int i = 0; i < 32; i++) {
+        const std::string path = "shaders/root" + std::to_string(i) + ".glsl";
+        loader.files[path] = "#include <lighting.glsl>\n#include \"common.glsl\"\nvoid main() { lighting(); }\n";
+        modulePaths.push_back(path);
+    }
+
+    modulePaths.push_back("shaders/missing.glsl");
+    modulePaths.push_back("shaders/broken.glsl");
+    loader.files["shaders/broken.glsl"] = "#include <lighting.glsl>\n#include <missing.glsl>\n";
+
+    ThreadPool threadPool(4);
+    ModuleCache moduleCache;
+    BatchAssembler batchAssembler;
+    batchAssembler.setModuleLoader(&loader);
+    batchAssembler.setIncludeDir("shaders");
+    batchAssembler.setThreadPool(&threadPool);
+    batchAssembler.setModuleCache(&moduleCache);
+    const std::vector<BatchAssembler::Result> results = batchAssembler.assemble(modulePaths);
+    REQUIRE(results.size() == modulePaths.size());
+
+    for (int i = 0; i < 32; i++) {
+        const BatchAssembler::Result &result = results[i];
+        REQUIRE(result.modulePath == modulePaths[i]);
+        REQUIRE(result.succeeded());
+        REQUIRE(result.error.empty());
+
+        ModuleGraph serial;
+        serial.setModuleLoader(&loader);
+        serial.setIncludeDir("shaders");
+        serial.loadModule(modulePaths[i]);
+        REQUIRE(result.moduleGraph->getAssembledSource() == serial.getAssembledSource());
+        REQUIRE(result.moduleGraph->getSourceBlocksCount() == serial.getSourceBlocksCount());
+        REQUIRE(result.moduleGraph->getModuleLoader() == &loader);
+    }
+
+    // Errors are reported per root
+    REQUIRE(!results[32].succeeded());
+    REQUIRE(results[32].error == "Not found: shaders/missing.glsl");
+    REQUIRE(!results[33].succeeded());
+    REQUIRE(results[33].error == "Not found: shaders/missing.glsl");
+
+    // Each file is loaded and parsed once (the serial graphs above loaded 32 * 3 files)
+    REQUIRE(loader.loadCount == 36 + 32 * 3);
+    REQUIRE(moduleCache.size() == 35);
+    REQUIRE(moduleCache.getStatistics().misses == 35);
+
+    // The cache is kept across batches
+    loader.loadCount = 0;
+    const std::vector<BatchAssembler::Result> again = batchAssembler.assemble(std::vector<std::string>(1, modulePaths[0]));
+    REQUIRE(again[0].moduleGraph->getAssembledSource() == results[0].moduleGraph->getAssembledSource());
+    REQUIRE(moduleCache.getStatistics().misses == 35);
+    REQUIRE(loader.loadCount == 3);
+}
+
+SCENARIO("BatchAssembler uses internal pool and cache", "[batch_assembler_test.cpp]") {
+    BatchTestModuleLoader loader;
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\nvoid main() { a(); }\n";
+
+    BatchAssembler batchAssembler;
+    REQUIRE_THROWS(batchAssembler.assemble(std::vector<std::string>(1, "shaders/main.glsl")));
+
+    batchAssembler.setModuleLoader(&loader);
+    batchAssembler.setIncludeDir("shaders");
+    const std::vector<BatchAssembler::Result> results = batchAssembler.assemble(std::vector<std::string>(3, "shaders/main.glsl"));
+    REQUIRE(results.size() == 3);
+    for (const BatchAssembler::Result &result : results) {
+        REQUIRE(result.succeeded());
+        REQUIRE(result.moduleGraph->getModuleCount() == 2);
+    }
+
+    // Sources are memoized for the duration of the batch
+    REQUIRE(loader.loadCount == 2);
+    REQUIRE(batchAssembler.assemble(std::vector<std::string>()).empty());
+}
+
+SCENARIO("BatchAssembler results outlive the assembler", "[batch_assembler_test.cpp]") {
+    BatchTestModuleLoader loader;
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\nvoid main() { a(); }\n";
+
+    std::vector<BatchAssembler::Result> results;
+    {
+        BatchAssembler batchAssembler;
+        batchAssembler.setModuleLoader(&loader);
+        batchAssembler.setIncludeDir("shaders");
+        results = batchAssembler.assemble(std::vector<std::string>(2, "shaders/main.glsl"));
+    }
+
+    // The internal cache is gone: the graphs reload without it
+    loader.files["shaders/a.glsl"] = "void a() { }\n";
+    for (BatchAssembler::Result &result : results) {
+        REQUIRE(result.succeeded());
+        REQUIRE(result.moduleGraph->getModuleCache() == nullptr);
+        REQUIRE(result.moduleGraph->getProfiler() == nullptr);
+        REQUIRE(result.moduleGraph->getModuleLoader() == &loader);
+
+        std::vector<std::string> touchedModules;
+        REQUIRE(result.moduleGraph->reload(touchedModules));
+        REQUIRE(touchedModules == std::vector<std::string>{ "shaders/a.glsl" });
+        REQUIRE(result.moduleGraph->findModule("shaders/a.glsl")->getSourceLine(0) == "void a() { }");
+    }
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/directive_scanner.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/string_utils.h>
+#include <regex>
+
+using namespace DirectiveScanner;
+
+static Directive scan(const std::string &line) {
+    return scanLine(line.data(), line.data() + line.size());
+}
+
+static std::string argument(const Directive &directive) {
+    return std::string(directive.argument, directive.argumentLength);
+}
+
+// Reference implementation, i.e. the regular expressions previously used by Module
+static DirectiveType scanWithRegex(const std::string &sourceLine, std::string &include) {
+    const std::regex relativeRegex(R"(^#include \"((\\.|[^\"])*)\"$)");
+    const std::regex absoluteRegex(R"(^#include <((\\.|[^\"])*)>$)");
+    const std::string line = StringUtils::trim_copy(sourceLine);
+    std::smatch match;
+    if (StringUtils::startsWith(line, "//")) {
+        return DirectiveType::COMMENT;
+    } else if (std::regex_search(line, match, relativeRegex)) {
+        include = match.str(1);
+        return include.empty() ? DirectiveType::INVALID_INCLUDE : DirectiveType::RELATIVE_INCLUDE;
+    } else if (std::regex_search(line, match, absoluteRegex)) {
+        include = match.str(1);
+        return include.empty() ? DirectiveType::INVALID_INCLUDE : DirectiveType::ABSOLUTE_INCLUDE;
+    } else if (StringUtils::startsWith(line, "#version")) {
+        return DirectiveType::VERSION;
+    } else if (StringUtils::startsWith(line, "precision")) {
+        return DirectiveType::PRECISION;
+    }
+
+    return DirectiveType::NONE;
+}
+
+SCENARIO("DirectiveScanner works", "[directive_scanner_test.cpp]") {
+    REQUIRE(scan("").type == DirectiveType::NONE);
+    REQUIRE(scan("  \t ").type == DirectiveType::NONE);
+    REQUIRE(scan("void main() {").type == DirectiveType::NONE);
+    REQUIRE(scan("  // #include <a.glsl>").type == DirectiveType::COMMENT);
+
+    REQUIRE(scan("#include \"a.glsl\"").type == DirectiveType::RELATIVE_INCLUDE);
+    REQUIRE(argument(scan("#include \"a.glsl\"")) == "a.glsl");
+    REQUIRE(argument(scan("\t #include \"../a.glsl\"  \r")) == "../a.glsl");
+    REQUIRE(scan("#include <utils/a.glsl>").type == DirectiveType::ABSOLUTE_INCLUDE);
+    REQUIRE(argument(scan("#include <utils/a.glsl>")) == "utils/a.glsl");
+
+    REQUIRE(scan("#include \"\"").type == DirectiveType::INVALID_INCLUDE);
+    REQUIRE(scan("#include <>").type == DirectiveType::INVALID_INCLUDE);
+    REQUIRE(scan("#include  <a.glsl>").type == DirectiveType::NONE);
+    REQUIRE(scan("#include <a.glsl> // comment").type == DirectiveType::NONE);
+    REQUIRE(scan("#include \"a.glsl>").type == DirectiveType::NONE);
+
+    REQUIRE(scan("#version 300 es").type == DirectiveType::VERSION);
+    REQUIRE(scan("  precision mediump float;").type == DirectiveType::PRECISION);
+    REQUIRE(scan("#version 300 es").isHoisted());
+    REQUIRE(!scan("#include <a.glsl>").isHoisted());
+    REQUIRE(scan("#include <a.glsl>").isInclude());
+}
+
+SCENARIO("DirectiveScanner matches the regex implementation", "[directive_scanner_test.cpp]") {
+    const std::vector<std::string> lines = {
+        "", " ", "#include", "#include ", "#include \"", "#include \"\"", "#include <", "#include <>",
+        "#include \"a\"", "#include <a>", "  #include \"a.glsl\"\t", "#include \"a\\\"b\"", "#include \"a\"b\"",
+        "#include \"a\\\"", "#include <a\"b>", "#include <a\\\"b>", "#include <a>b>", "#include <\\>",
+        "#include\t<a>", "#include  \"a\"", "# include <a>", "#include <a> ", "x #include <a>", "//#include <a>",
+        "/ #include <a>", "#version 300 es", "#versionx", " precision highp float;", "precisionx", "#pragma once",
+        "#include \"\\\"\"", "#include <a\\\\\"b>", "#include \"a\\\rb\""
+    };
+
+    for (const std::string &line : lines) {
+        std::string include;
+        const DirectiveType expected = scanWithRegex(line, include);
+        const Directive directive = scan(line);
+        INFO(line);
+        REQUIRE(directive.type == expected);
+        if (directive.isInclude()) {
+            REQUIRE(argument(directive) == include);
+        }
+    }
+}
+
+SCENARIO("Module reports invalid includes", "[directive_scanner_test.cpp]") {
+    REQUIRE_THROWS_WITH(
+        Module::fromSource("main.glsl", "void f();\n#include \"\"\n"),
+        "Error 'main.glsl'(2): invalid #include syntax."
+    );
+}
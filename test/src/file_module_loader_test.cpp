@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/file_module_loader.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void writeFile(const std::string &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+SCENARIO("FileModuleLoader works", "[file_module_loader_test.cpp]") {
+    char rootTemplate[] = "/tmp/glsl_assembler_test_XXXXXX";
+    const std::string rootDir = mkdtemp(rootTemplate);
+    REQUIRE(mkdir((rootDir + "/shaders").c_str(), 0700) == 0);
+    REQUIRE(mkdir((rootDir + "/shaders/utils").c_str(), 0700) == 0);
+
+    std::string large;
+    for (int i = 0; i < 2000; i++) {
+        large += "float large" + std::to_string(i) + " = 1.0;\n";
+    }
+
+    writeFile(rootDir + "/shaders/main.glsl", "#include <utils/large.glsl>\n#include \"utils/small.glsl\"\nvoid main() {}\n");
+    writeFile(rootDir + "/shaders/utils/small.glsl", "#include \"../empty.glsl\"\nvoid small() {}\n");
+    writeFile(rootDir + "/shaders/utils/large.glsl", large);
+    writeFile(rootDir + "/shaders/empty.glsl", "");
+
+    FileModuleLoader loader(rootDir);
+    REQUIRE(loader.getRootDir() == rootDir);
+    REQUIRE(loader.getMmapThreshold() == FileModuleLoader::DEFAULT_MMAP_THRESHOLD);
+    REQUIRE(large.size() > loader.getMmapThreshold());
+
+    // Files are read whatever their size (the threshold only applies to kept mappings)
+    REQUIRE(loader.load("shaders/utils/small.glsl") == "#include \"../empty.glsl\"\nvoid small() {}\n");
+    REQUIRE(loader.load("shaders/utils/large.glsl") == large);
+    REQUIRE(loader.load("shaders/empty.glsl").empty());
+    loader.setMmapThreshold(0);
+    REQUIRE(loader.load("shaders/utils/small.glsl") == "#include \"../empty.glsl\"\nvoid small() {}\n");
+    REQUIRE(loader.load(rootDir + "/shaders/utils/large.glsl") == large);
+    REQUIRE_THROWS(loader.load("shaders/missing.glsl"));
+    REQUIRE_THROWS(loader.load("shaders"));
+
+    // Paths
+    REQUIRE(loader.isPath(""));
+    REQUIRE(loader.isPath("shaders/utils"));
+    REQUIRE(!loader.isPath("shaders/main.glsl"));
+    REQUIRE(!loader.isPath("missing"));
+    REQUIRE(loader.join("", "main.glsl") == "main.glsl");
+    REQUIRE(loader.join("shaders/utils", "../main.glsl") == "shaders/main.glsl");
+
+    // Version stamps
+    std::uint64_t version = 0;
+    std::uint64_t newVersion = 0;
+    REQUIRE(!loader.getVersion("shaders/missing.glsl", version));
+    REQUIRE(loader.getVersion("shaders/utils/small.glsl", version));
+    writeFile(rootDir + "/shaders/utils/small.glsl", "void small() { }\n");
+    REQUIRE(loader.getVersion("shaders/utils/small.glsl", newVersion));
+    REQUIRE(version != newVersion);
+
+    // Full graph
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getModuleCount() == 3);
+    REQUIRE(moduleGraph.findModule("shaders/utils/large.glsl") != nullptr);
+
+    // Buffers are copies, unless the mappings are kept
+    loader.setMmapThreshold(FileModuleLoader::DEFAULT_MMAP_THRESHOLD);
+    REQUIRE(!loader.isKeepMappings());
+    REQUIRE(loader.loadBuffer("shaders/utils/large.glsl").view() == large);
+    loader.setKeepMappings(true);
+    REQUIRE(loader.isKeepMappings());
+    const SourceBuffer mapped = loader.loadBuffer("shaders/utils/large.glsl");
+    REQUIRE(mapped.view() == large);
+    REQUIRE(mapped.getOwner() != nullptr);
+    REQUIRE(loader.loadBuffer("shaders/utils/small.glsl").view() == "void small() { }\n");
+    REQUIRE(loader.loadBuffer("shaders/empty.glsl").empty());
+    REQUIRE_THROWS(loader.loadBuffer("shaders/missing.glsl"));
+
+    // A mapping outlives its file, as long as the parsed module refers to it
+    moduleGraph.loadModule("shaders/main.glsl");
+    unlink((rootDir + "/shaders/utils/large.glsl").c_str());
+    const Module *largeModule = moduleGraph.findModule("shaders/utils/large.glsl");
+    REQUIRE(largeModule->getSourceLine(1999) == "float large1999 = 1.0;");
+    REQUIRE(moduleGraph.getAssembledSource().find("float large1999 = 1.0;\n") != std::string::npos);
+
+    // Module paths relative to the current directory
+    FileModuleLoader cwdLoader;
+    REQUIRE(cwdLoader.load(rootDir + "/shaders/empty.glsl").empty());
+
+    unlink((rootDir + "/shaders/utils/small.glsl").c_str());
+    unlink((rootDir + "/shaders/main.glsl").c_str());
+    unlink((rootDir + "/shaders/empty.glsl").c_str());
+    rmdir((rootDir + "/shaders/utils").c_str());
+    rmdir((rootDir + "/shaders").c_str());
+    rmdir(rootDir.c_str());
+}
@@ -0,0 +1,237 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/assembly_sink.h>
+#include <glsl_assembler/graph_snapshot.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/source_buffer.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+class SnapshotTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        return files.at(path);
+    }
+};
+
+static std::string readFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+static void requireSameGraph(const ModuleGraph &actual, const ModuleGraph &expected) {
+    REQUIRE(actual.getAssembledSource() == expected.getAssembledSource());
+    REQUIRE(actual.getAssembledSourceSize() == expected.getAssembledSourceSize());
+    REQUIRE(actual.getProgramHash() == expected.getProgramHash());
+    REQUIRE(actual.getHoistedLinesCount() == expected.getHoistedLinesCount());
+    REQUIRE(actual.getIncludeDir() == expected.getIncludeDir());
+
+    REQUIRE(actual.getModuleCount() == expected.getModuleCount());
+    for (int i = 0; i < expected.getModuleCount(); i++) {
+        const Module *actualModule = actual.getSortedModule(i);
+        const Module *expectedModule = expected.getSortedModule(i);
+        REQUIRE(actualModule->getId() == expectedModule->getId());
+        REQUIRE(actualModule->getSourceHash() == expectedModule->getSourceHash());
+
+        REQUIRE(actualModule->getSourceLinesCount() == expectedModule->getSourceLinesCount());
+        for (int line = 0; line < expectedModule->getSourceLinesCount(); line++) {
+            REQUIRE(actualModule->getSourceLine(line) == expectedModule->getSourceLine(line));
+        }
+
+        REQUIRE(actualModule->getHoistedLinesCount() == expectedModule->getHoistedLinesCount());
+        for (int hoisted = 0; hoisted < expectedModule->getHoistedLinesCount(); hoisted++) {
+            REQUIRE(actualModule->getHoistedLine(hoisted).line == expectedModule->getHoistedLine(hoisted).line);
+            REQUIRE(actualModule->getHoistedLine(hoisted).index == expectedModule->getHoistedLine(hoisted).index);
+        }
+
+        REQUIRE(actualModule->getDependencyCount() == expectedModule->getDependencyCount());
+        for (int dependency = 0; dependency < expectedModule->getDependencyCount(); dependency++) {
+            const Module::Dependency &actualDependency = actualModule->getDependency(dependency);
+            REQUIRE(actualDependency.moduleId == expectedModule->getDependency(dependency).moduleId);
+            REQUIRE(actualDependency.includeLine == expectedModule->getDependency(dependency).includeLine);
+            REQUIRE(actual.getModule(actualDependency.moduleHandle) == actualDependency.module);
+            REQUIRE(actualDependency.module->getId() == actualDependency.moduleId);
+        }
+    }
+
+    REQUIRE(actual.getSourceBlocksCount() == expected.getSourceBlocksCount());
+    int assembledLines = 0;
+    for (int i = 0; i < expected.getSourceBlocksCount(); i++) {
+        REQUIRE(actual.getSourceBlock(i).assembledRange.begin == expected.getSourceBlock(i).assembledRange.begin);
+        REQUIRE(actual.getSourceBlock(i).assembledRange.end == expected.getSourceBlock(i).assembledRange.end);
+        assembledLines = expected.getSourceBlock(i).assembledRange.end;
+    }
+
+    for (int line = 0; line <= assembledLines; line++) {
+        int actualLine = -1;
+        int expectedLine = -1;
+        const Module *actualModule = actual.mapLine(line, actualLine);
+        const Module *expectedModule = expected.mapLine(line, expectedLine);
+        REQUIRE((actualModule == nullptr) == (expectedModule == nullptr));
+        if (expectedModule != nullptr) {
+            REQUIRE(actualModule->getId() == expectedModule->getId());
+            REQUIRE(actualLine == expectedLine);
+
+            std::vector<int> actualLines;
+            std::vector<int> expectedLines;
+            REQUIRE(actual.mapModuleLine(actualModule, actualLine, actualLines) == expected.mapModuleLine(expectedModule, expectedLine, expectedLines));
+            REQUIRE(actualLines == expectedLines);
+        }
+    }
+
+    std::string actualWritten;
+    StringAssemblySink actualSink(actualWritten);
+    actual.writeAssembledSource(actualSink);
+    std::string expectedWritten;
+    StringAssemblySink expectedSink(expectedWritten);
+    expected.writeAssembledSource(expectedSink);
+    REQUIRE(actualWritten == expectedWritten);
+}
+
+static void fillLoader(SnapshotTestModuleLoader &loader) {
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\n#include \"lib/b.glsl\"\n\n#version 300 es\nprecision mediump float;\nvoid main() { a(); b(); }\n";
+    loader.files["shaders/a.glsl"] = "// a\nvoid a() {}\n\nvoid unused() {}\n";
+    loader.files["shaders/lib/b.glsl"] = "#include <a.glsl>\n#extension GL_EXT_shader_io_blocks : enable\nvoid b() { a(); }\n";
+}
+
+SCENARIO("GraphSnapshot works", "[graph_snapshot_test.cpp]") {
+    const std::string path = "graph_snapshot_test.bin";
+    std::remove(path.c_str());
+
+    SnapshotTestModuleLoader loader;
+    fillLoader(loader);
+    for (int options = 0; options < 4; options++) {
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&loader);
+        moduleGraph.setIncludeDir("shaders");
+        moduleGraph.setTreeShaking((options & 1) != 0);
+        moduleGraph.setMinify((options & 2) != 0);
+        moduleGraph.loadModule("shaders/main.glsl");
+        REQUIRE(moduleGraph.getHoistedLinesCount() == 2);
+        moduleGraph.saveSnapshot(path);
+
+        // The restored graph needs no loader
+        ModuleGraph restoredGraph;
+        REQUIRE(restoredGraph.loadSnapshot(path));
+        REQUIRE(restoredGraph.isTreeShaking() == moduleGraph.isTreeShaking());
+        REQUIRE(restoredGraph.isMinify() == moduleGraph.isMinify());
+        requireSameGraph(restoredGraph, moduleGraph);
+
+        // The mapping outlives the file
+        std::remove(path.c_str());
+        requireSameGraph(restoredGraph, moduleGraph);
+
+        // In memory, without keeping the assembled source
+        const std::string snapshot = GraphSnapshot::encode(moduleGraph);
+        ModuleGraph streamedGraph;
+        streamedGraph.setKeepAssembledSource(false);
+        REQUIRE(GraphSnapshot::decode(streamedGraph, SourceBuffer::borrow(snapshot.data(), snapshot.size())));
+        REQUIRE(streamedGraph.getAssembledSource().empty());
+        REQUIRE(streamedGraph.getAssembledSourceSize() == moduleGraph.getAssembledSourceSize());
+        std::string streamed;
+        StringAssemblySink streamedSink(streamed);
+        streamedGraph.writeAssembledSource(streamedSink);
+        REQUIRE(streamed == moduleGraph.getAssembledSource());
+    }
+
+    // Encoding is deterministic
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(GraphSnapshot::encode(moduleGraph) == GraphSnapshot::encode(moduleGraph));
+
+    // Empty graphs cannot be encoded
+    ModuleGraph emptyGraph;
+    REQUIRE_THROWS(GraphSnapshot::encode(emptyGraph));
+    REQUIRE_THROWS(emptyGraph.saveSnapshot(path));
+}
+
+SCENARIO("GraphSnapshot rejects stale and corrupt snapshots", "[graph_snapshot_test.cpp]") {
+    const std::string path = "graph_snapshot_test.bin";
+    std::remove(path.c_str());
+
+    SnapshotTestModuleLoader loader;
+    fillLoader(loader);
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::string snapshot = GraphSnapshot::encode(moduleGraph);
+
+    loader.files["other/main.glsl"] = "void other() {}\n";
+    ModuleGraph targetGraph;
+    targetGraph.setModuleLoader(&loader);
+    targetGraph.loadModule("other/main.glsl");
+    const std::string assembledSource = targetGraph.getAssembledSource();
+
+    // Missing file
+    REQUIRE(!targetGraph.loadSnapshot(path));
+    REQUIRE(targetGraph.getAssembledSource() == assembledSource);
+
+    // Every truncation, and a flipped bit in every byte
+    for (std::size_t size = 0; size < snapshot.size(); size++) {
+        REQUIRE(!GraphSnapshot::decode(targetGraph, SourceBuffer::borrow(snapshot.data(), size)));
+    }
+    for (std::size_t i = 0; i < snapshot.size(); i++) {
+        std::string corrupt = snapshot;
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x10);
+        REQUIRE(!GraphSnapshot::decode(targetGraph, SourceBuffer::borrow(corrupt.data(), corrupt.size())));
+    }
+    REQUIRE(targetGraph.getModuleCount() == 1);
+    REQUIRE(targetGraph.getAssembledSource() == assembledSource);
+
+    // Trailing bytes and another format version
+    const std::string trailing = snapshot + '\0';
+    REQUIRE(!GraphSnapshot::decode(targetGraph, SourceBuffer::borrow(trailing.data(), trailing.size())));
+    std::string otherVersion = snapshot;
+    otherVersion[8] = static_cast<char>(GraphSnapshot::FORMAT_VERSION + 1);
+    REQUIRE(!GraphSnapshot::decode(targetGraph, SourceBuffer::borrow(otherVersion.data(), otherVersion.size())));
+    writeFile(path, otherVersion);
+    REQUIRE(!targetGraph.loadSnapshot(path));
+    REQUIRE(targetGraph.getAssembledSource() == assembledSource);
+
+    writeFile(path, snapshot);
+    REQUIRE(readFile(path) == snapshot);
+    REQUIRE(targetGraph.loadSnapshot(path));
+    requireSameGraph(targetGraph, moduleGraph);
+    std::remove(path.c_str());
+}
+
+SCENARIO("GraphSnapshot restored graphs reload", "[graph_snapshot_test.cpp]") {
+    SnapshotTestModuleLoader loader;
+    fillLoader(loader);
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::string snapshot = GraphSnapshot::encode(moduleGraph);
+
+    ModuleGraph restoredGraph;
+    restoredGraph.setModuleLoader(&loader);
+    REQUIRE(GraphSnapshot::decode(restoredGraph, SourceBuffer::fromString(snapshot)));
+
+    // Unchanged sources are not parsed again
+    std::vector<std::string> touchedModules;
+    REQUIRE(!restoredGraph.reload(touchedModules));
+    REQUIRE(touchedModules.empty());
+    requireSameGraph(restoredGraph, moduleGraph);
+
+    // Changed sources are, and the dependencies are resolved again
+    loader.files["shaders/lib/b.glsl"] = "#include \"../a.glsl\"\n#include \"c.glsl\"\nvoid b() { a(); c(); }\n";
+    loader.files["shaders/lib/c.glsl"] = "void c() {}\n";
+    REQUIRE(restoredGraph.reload(touchedModules));
+    REQUIRE(touchedModules == std::vector<std::string>{ "shaders/lib/b.glsl", "shaders/lib/c.glsl" });
+    REQUIRE(moduleGraph.reload(touchedModules));
+    requireSameGraph(restoredGraph, moduleGraph);
+}
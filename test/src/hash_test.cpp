@@ -0,0 +1,23 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/hash.h>
+
+SCENARIO("Hash works", "[hash_test.cpp]") {
+    // Reference values of XXH64
+    REQUIRE(Hash::xxh64("") == 0xEF46DB3751D8E999ULL);
+    REQUIRE(Hash::xxh64("abc") == 0x44BC2CF5AD770999ULL);
+    REQUIRE(Hash::xxh64("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ULL);
+
+    // All the input sizes and alignments are hashed consistently
+    std::string data;
+    for (int i = 0; i < 100; i++) {
+        data.push_back(static_cast<char>(i * 7));
+    }
+
+    for (std::size_t size = 0; size < 80; size++) {
+        REQUIRE(Hash::xxh64(data.data() + 1, size) == Hash::xxh64(data.substr(1, size)));
+        REQUIRE(Hash::xxh64(data.data(), size) != Hash::xxh64(data.data(), size + 1));
+        REQUIRE(Hash::xxh64(data.data(), size, 1) != Hash::xxh64(data.data(), size));
+    }
+
+    REQUIRE(Hash::combine(Hash::combine(0, 1), 2) != Hash::combine(Hash::combine(0, 2), 1));
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/file_module_loader.h>
+#include <glsl_assembler/hot_reload_service.h>
+#include <glsl_assembler/module_graph.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void writeFile(const std::string &path, const std::string &contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+// Polls until some graph is reloaded (or a timeout expires)
+static int pollReload(HotReloadService &service) {
+    for (int i = 0; i < 100; i++) {
+        const int reloaded = service.poll(20);
+        if (reloaded > 0) {
+            return reloaded;
+        }
+    }
+
+    return 0;
+}
+
+SCENARIO("HotReloadService works", "[hot_reload_service_test.cpp]") {
+    char rootTemplate[] = "/tmp/glsl_assembler_test_XXXXXX";
+    const std::string rootDir = mkdtemp(rootTemplate);
+    REQUIRE(mkdir((rootDir + "/shaders").c_str(), 0700) == 0);
+    writeFile(rootDir + "/shaders/first.glsl", "#include <common.glsl>\nvoid main() {}\n");
+    writeFile(rootDir + "/shaders/second.glsl", "#include <common.glsl>\nvoid main() { common(); }\n");
+    writeFile(rootDir + "/shaders/common.glsl", "void common() {}\n");
+    writeFile(rootDir + "/shaders/other.glsl", "void other() {}\n");
+
+    FileModuleLoader loader(rootDir);
+    ModuleGraph first;
+    first.setModuleLoader(&loader);
+    first.setIncludeDir("shaders");
+    first.loadModule("shaders/first.glsl");
+    ModuleGraph second;
+    second.setModuleLoader(&loader);
+    second.setIncludeDir("shaders");
+    second.loadModule("shaders/second.glsl");
+
+    HotReloadService service;
+    service.setDebounce(std::chrono::milliseconds(10));
+    std::vector<ModuleGraph *> reloadedGraphs;
+    std::vector<std::string> errors;
+    service.setReloadCallback([&reloadedGraphs](ModuleGraph *moduleGraph, const std::vector<std::string> &touchedModules) {
+        reloadedGraphs.push_back(moduleGraph);
+    });
+    service.setErrorCallback([&errors](ModuleGraph *moduleGraph, const std::string &error) {
+        errors.push_back(error);
+    });
+    service.addGraph(&first);
+    service.addGraph(&second);
+    REQUIRE(service.getWatchedFilesCount() == 3);
+    REQUIRE(service.poll() == 0);
+
+    // A burst of writes to a shared file reloads both graphs once
+    writeFile(rootDir + "/shaders/common.glsl", "void common() { }\n");
+    writeFile(rootDir + "/shaders/common.glsl", "void common() { return; }\n");
+    REQUIRE(pollReload(service) == 2);
+    REQUIRE(reloadedGraphs.size() == 2);
+    REQUIRE(first.getAssembledSource().find("void common() { return; }") != std::string::npos);
+    REQUIRE(second.getAssembledSource().find("void common() { return; }") != std::string::npos);
+    REQUIRE(service.getStatistics().reloads == 2);
+    REQUIRE(service.getStatistics().lastLatency >= service.getDebounce());
+    REQUIRE(service.getStatistics().maxLatency >= service.getStatistics().lastLatency);
+
+    // Unrelated files are ignored
+    writeFile(rootDir + "/shaders/other.glsl", "void other() { }\n");
+    REQUIRE(service.poll(50) == 0);
+    REQUIRE(service.getPendingGraphsCount() == 0);
+
+    // Saving through a temporary file and a rename, the new dependency becomes watched
+    reloadedGraphs.clear();
+    writeFile(rootDir + "/shaders/first.tmp", "#include <common.glsl>\n#include <other.glsl>\nvoid main() {}\n");
+    REQUIRE(std::rename((rootDir + "/shaders/first.tmp").c_str(), (rootDir + "/shaders/first.glsl").c_str()) == 0);
+    REQUIRE(pollReload(service) == 1);
+    REQUIRE(reloadedGraphs.size() == 1);
+    REQUIRE(reloadedGraphs[0] == &first);
+    REQUIRE(first.getModuleCount() == 3);
+    REQUIRE(service.getWatchedFilesCount() == 4);
+
+    // Errors are reported, and the files are still watched
+    writeFile(rootDir + "/shaders/other.glsl", "#include <missing.glsl>\n");
+    REQUIRE(pollReload(service) == 1);
+    REQUIRE(errors.size() == 1);
+    REQUIRE(service.getStatistics().failures == 1);
+    REQUIRE(first.getFailedModuleId() == "shaders/missing.glsl");
+
+    // The missing include is watched, creating it reloads the graph
+    REQUIRE(service.getWatchedFilesCount() == 5);
+    writeFile(rootDir + "/shaders/missing.glsl", "void missing() {}\n");
+    REQUIRE(pollReload(service) == 1);
+    REQUIRE(errors.size() == 1);
+    REQUIRE(first.getFailedModuleId().empty());
+    REQUIRE(first.getModuleCount() == 4);
+    REQUIRE(service.getWatchedFilesCount() == 5);
+
+    // Files no longer included are not watched anymore
+    writeFile(rootDir + "/shaders/other.glsl", "void other() {}\n");
+    REQUIRE(pollReload(service) == 1);
+    REQUIRE(first.getModuleCount() == 3);
+    REQUIRE(service.getWatchedFilesCount() == 4);
+    writeFile(rootDir + "/shaders/missing.glsl", "void missing() { }\n");
+    REQUIRE(service.poll(50) == 0);
+
+    // Removed graphs are not reloaded
+    service.removeGraph(&first);
+    service.removeGraph(&second);
+    REQUIRE(service.getWatchedFilesCount() == 0);
+    writeFile(rootDir + "/shaders/common.glsl", "void common() {}\n");
+    REQUIRE(service.poll(50) == 0);
+
+    unlink((rootDir + "/shaders/first.glsl").c_str());
+    unlink((rootDir + "/shaders/second.glsl").c_str());
+    unlink((rootDir + "/shaders/common.glsl").c_str());
+    unlink((rootDir + "/shaders/other.glsl").c_str());
+    unlink((rootDir + "/shaders/missing.glsl").c_str());
+    rmdir((rootDir + "/shaders").c_str());
+    rmdir(rootDir.c_str());
+}
@@ -0,0 +1,159 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/info_log_rewriter.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/thread_pool.h>
+#include <glsl_assembler/variant_assembler.h>
+#include <algorithm>
+#include <map>
+
+class InfoLogTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        return files.at(path);
+    }
+};
+
+static void fillLoader(InfoLogTestModuleLoader &loader) {
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\n#include <b.glsl>\n\n#version 300 es\nprecision mediump float;\nout vec4 color;\nvoid main() {\n    color = a() + b();\n}\n";
+    loader.files["shaders/a.glsl"] = "vec4 a() {\n    return vec4(1.0);\n}\n";
+    loader.files["shaders/b.glsl"] = "vec4 b() {\n    return vec4(0.0);\n}\n";
+}
+
+SCENARIO("InfoLogRewriter works", "[info_log_rewriter_test.cpp]") {
+    InfoLogTestModuleLoader loader;
+    fillLoader(loader);
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const InfoLogRewriter rewriter(moduleGraph);
+
+    // Every driver line maps as ModuleGraph::mapLine()
+    const int lines = moduleGraph.getSourceBlock(moduleGraph.getSourceBlocksCount() - 1).assembledRange.end + 1;
+    std::string infoLog;
+    for (int line = lines + 1; line > 0; line--) {
+        infoLog += "0(" + std::to_string(line) + ") : error C0000: syntax error\n";
+    }
+
+    std::vector<InfoLogRewriter::Reference> references;
+    int mapped = 0;
+    REQUIRE(rewriter.findReferences(infoLog, references) > 0);
+    REQUIRE(references.size() == lines + 1);
+    for (const InfoLogRewriter::Reference &reference : references) {
+        int moduleLine;
+        REQUIRE(reference.module == moduleGraph.mapLine(reference.line, moduleLine));
+        REQUIRE(reference.moduleLine == moduleLine);
+        REQUIRE(infoLog.substr(reference.offset, reference.length) == "0(" + std::to_string(reference.line + 1) + ")");
+        mapped += reference.module != nullptr;
+    }
+    REQUIRE(rewriter.findReferences(infoLog, references) == mapped);
+
+    // Hoisted lines map to the including module
+    REQUIRE(rewriter.rewrite("0(1) : error C0000: bad version\n") == "shaders/main.glsl:4 : error C0000: bad version\n");
+
+    // NVIDIA, Mesa and AMD formats
+    int aLine = -1;
+    std::vector<int> assembledLines;
+    REQUIRE(moduleGraph.mapModuleLine(moduleGraph.findModule("shaders/a.glsl"), 1, assembledLines) == 1);
+    aLine = assembledLines[0] + 1;
+    REQUIRE(moduleGraph.mapModuleLine(moduleGraph.findModule("shaders/main.glsl"), 7, assembledLines) == 1);
+    const int mainLine = assembledLines[0] + 1;
+    const std::string a = std::to_string(aLine);
+    const std::string main = std::to_string(mainLine);
+    REQUIRE(rewriter.rewrite("0(" + a + ") : error C1008: undefined variable \"x\"") == "shaders/a.glsl:2 : error C1008: undefined variable \"x\"");
+    REQUIRE(rewriter.rewrite("0:" + a + "(12): error: `x' undeclared\n0:" + main + "(5): error: type mismatch\n")
+        == "shaders/a.glsl:2(12): error: `x' undeclared\nshaders/main.glsl:8(5): error: type mismatch\n");
+    REQUIRE(rewriter.rewrite("ERROR: 0:" + main + ": '+' : wrong operand types\nERROR: 2 compilation errors.  No code generated.\n")
+        == "ERROR: shaders/main.glsl:8: '+' : wrong operand types\nERROR: 2 compilation errors.  No code generated.\n");
+
+    // Other text is left as it is
+    const std::vector<std::string> untouched = {
+        "",
+        "no reference",
+        "vec4(" + a + ") and vec2:" + a,
+        "0:" + a + ".5 and 0:" + a + "x and 1.0:" + a,
+        "1(" + a + ") : other source string",
+        "0(0) 0() 0( " + a + ") 0: " + a + " 0(" + a,
+        "0(99999999999999999999) 0:4294967297",
+        "0(" + std::to_string(lines + 100) + ") : out of range",
+    };
+    for (const std::string &log : untouched) {
+        REQUIRE(rewriter.rewrite(log) == log);
+    }
+
+    // References at the bounds of the log
+    REQUIRE(rewriter.rewrite("0:" + a) == "shaders/a.glsl:2");
+    REQUIRE(rewriter.rewrite("(0:" + a + ")") == "(shaders/a.glsl:2)");
+
+    // Another source string
+    InfoLogRewriter prefixedRewriter(moduleGraph);
+    prefixedRewriter.setSourceString(1);
+    REQUIRE(prefixedRewriter.getSourceString() == 1);
+    REQUIRE(prefixedRewriter.rewrite("0(" + a + ") 1(" + a + ")") == "0(" + a + ") shaders/a.glsl:2");
+}
+
+SCENARIO("InfoLogRewriter maps variant lines", "[info_log_rewriter_test.cpp]") {
+    InfoLogTestModuleLoader loader;
+    fillLoader(loader);
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const InfoLogRewriter rewriter(moduleGraph);
+
+    const VariantAssembler variantAssembler(moduleGraph);
+    const std::vector<std::vector<VariantAssembler::Define>> defineSets = {
+        {},
+        { { "A" } },
+        { { "A" }, { "B", "2" }, { "C" } },
+    };
+    const std::vector<VariantAssembler::Variant> variants = variantAssembler.assembleAll(defineSets);
+
+    std::vector<std::string> infoLogs;
+    for (const VariantAssembler::Variant &variant : variants) {
+        const int lines = static_cast<int>(std::count(variant.source.begin(), variant.source.end(), '\n'));
+        std::string infoLog;
+        for (int line = 1; line <= lines; line++) {
+            infoLog += "ERROR: 0:" + std::to_string(line) + ": error\n";
+        }
+
+        // Same as Variant::mapLine(), define lines are left as they are
+        std::vector<InfoLogRewriter::Reference> references;
+        rewriter.findReferences(infoLog, references, &variant);
+        REQUIRE(references.size() == lines);
+        std::string expected;
+        for (const InfoLogRewriter::Reference &reference : references) {
+            int moduleLine;
+            Module *module = variant.mapLine(reference.line, moduleLine);
+            REQUIRE(reference.module == module);
+            REQUIRE(reference.moduleLine == moduleLine);
+            expected += "ERROR: " + (module ? module->getId() + ":" + std::to_string(moduleLine + 1) : "0:" + std::to_string(reference.line + 1)) + ": error\n";
+        }
+
+        REQUIRE(rewriter.rewrite(infoLog, &variant) == expected);
+        infoLogs.push_back(infoLog);
+    }
+
+    // All the logs at once, with and without a thread pool
+    const std::vector<std::string> rewritten = rewriter.rewriteAll(infoLogs, variants);
+    REQUIRE(rewritten.size() == variants.size());
+    for (int i = 0; i < variants.size(); i++) {
+        REQUIRE(rewritten[i] == rewriter.rewrite(infoLogs[i], &variants[i]));
+    }
+
+    ThreadPool threadPool(2);
+    REQUIRE(rewriter.rewriteAll(infoLogs, variants, &threadPool) == rewritten);
+    REQUIRE_THROWS(rewriter.rewriteAll(infoLogs, std::vector<VariantAssembler::Variant>()));
+
+    // Variants of another graph are rejected
+    ModuleGraph otherGraph;
+    otherGraph.setModuleLoader(&loader);
+    otherGraph.setIncludeDir("shaders");
+    otherGraph.loadModule("shaders/main.glsl");
+    const VariantAssembler::Variant otherVariant = VariantAssembler(otherGraph).assemble({});
+    REQUIRE_THROWS(rewriter.rewrite(infoLogs[0], &otherVariant));
+}
@@ -0,0 +1,172 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <map>
+
+class CacheTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+    int loadCount = 0;
+
+    std::string load(const std::string &path) override {
+        loadCount++;
+        return files.at(path);
+    }
+
+    bool getVersion(const std::string &path, std::uint64_t &version) override {
+        version = files.at(path).size();
+        return true;
+    }
+};
+
+SCENARIO("ModuleCache works", "[module_cache_test.cpp]") {
+    ModuleCache cache;
+    std::shared_ptr<const ParsedModule> a = cache.acquire("a.glsl", "void a() {}\n");
+    REQUIRE(a->getId() == "a.glsl");
+    REQUIRE(cache.acquire("a.glsl", "void a() {}\n") == a);
+    REQUIRE(cache.acquire("a.glsl", "void a() { }\n") != a);
+    REQUIRE(cache.acquire("b.glsl", "void a() {}\n") != a);
+    REQUIRE(cache.size() == 3);
+    REQUIRE(cache.getStatistics().hits == 1);
+    REQUIRE(cache.getStatistics().misses == 3);
+
+    // Lookup by version stamp
+    REQUIRE(cache.find("a.glsl", 1) == nullptr);
+    REQUIRE(cache.acquire("a.glsl", "void a() {}\n", 1) == a);
+    REQUIRE(cache.find("a.glsl", 1) == a);
+    REQUIRE(cache.find("b.glsl", 1) == nullptr);
+
+    // Using a again dropped the other (unused) source of a.glsl
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getStatistics().superseded == 1);
+
+    // Parse errors are not cached
+    REQUIRE_THROWS(cache.acquire("c.glsl", "#include <>\n"));
+    REQUIRE(cache.size() == 2);
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.getMemoryUsage() == 0);
+    REQUIRE(a->getSourceLinesCount() == 1);
+}
+
+SCENARIO("ModuleCache evicts the least recently used modules", "[module_cache_test.cpp]") {
+    ModuleCache cache;
+    std::shared_ptr<const ParsedModule> a = cache.acquire("a.glsl", "void a() {}\n");
+    std::shared_ptr<const ParsedModule> b = cache.acquire("b.glsl", "void b() {}\n");
+    std::shared_ptr<const ParsedModule> c = cache.acquire("c.glsl", "void c() {}\n");
+    REQUIRE(cache.getMemoryUsage() == a->getMemoryUsage() + b->getMemoryUsage() + c->getMemoryUsage());
+
+    // a becomes the most recently used, so b is evicted first
+    REQUIRE(cache.acquire("a.glsl", "void a() {}\n") == a);
+    cache.setMemoryBudget(a->getMemoryUsage() + c->getMemoryUsage());
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getStatistics().evictions == 1);
+    REQUIRE(cache.acquire("c.glsl", "void c() {}\n") == c);
+    REQUIRE(cache.acquire("a.glsl", "void a() {}\n") == a);
+
+    // Evicted modules are still usable
+    REQUIRE(b->getSourceLine(0) == "void b() {}");
+    REQUIRE(cache.acquire("b.glsl", "void b() {}\n") != b);
+    REQUIRE(cache.size() == 2);
+
+    // The most recently used module is never evicted
+    cache.setMemoryBudget(1);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.getMemoryBudget() == 1);
+}
+
+SCENARIO("ModuleCache shared by many ModuleGraph", "[module_cache_test.cpp]") {
+    CacheTestModuleLoader loader;
+    loader.files["shaders/first.glsl"] = "#include <common.glsl>\nvoid main() {}\n";
+    loader.files["shaders/second.glsl"] = "#include <common.glsl>\nvoid main() { common(); }\n";
+    loader.files["shaders/common.glsl"] = "void common() {}\n";
+
+    ModuleCache cache;
+    ModuleGraph first;
+    first.setModuleLoader(&loader);
+    first.setModuleCache(&cache);
+    first.setIncludeDir("shaders");
+    first.loadModule("shaders/first.glsl");
+
+    ModuleGraph second;
+    second.setModuleLoader(&loader);
+    second.setModuleCache(&cache);
+    second.setIncludeDir("shaders");
+    second.loadModule("shaders/second.glsl");
+
+    // The common module is loaded and parsed once, but each graph has its own Module
+    REQUIRE(loader.loadCount == 3);
+    REQUIRE(cache.size() == 3);
+    Module *firstCommon = first.findModule("shaders/common.glsl");
+    Module *secondCommon = second.findModule("shaders/common.glsl");
+    REQUIRE(firstCommon != secondCommon);
+    REQUIRE(firstCommon->getParsedModule() == secondCommon->getParsedModule());
+
+    // Reloading a graph does not affect the other one
+    loader.files["shaders/common.glsl"] = "void common() { }\n";
+    std::vector<std::string> touchedModules;
+    REQUIRE(first.reload(touchedModules));
+    REQUIRE(touchedModules == std::vector<std::string>{ "shaders/common.glsl" });
+    REQUIRE(firstCommon->getParsedModule() != secondCommon->getParsedModule());
+    REQUIRE(secondCommon->getSourceLine(0) == "void common() {}");
+
+    // The second graph finds the new version in the cache, without loading it
+    const int loadCount = loader.loadCount;
+    REQUIRE(second.reload(touchedModules));
+    REQUIRE(loader.loadCount == loadCount);
+    REQUIRE(firstCommon->getParsedModule() == secondCommon->getParsedModule());
+}
+
+SCENARIO("ModuleCache drops the previous sources of a module", "[module_cache_test.cpp]") {
+    ModuleCache cache;
+    std::shared_ptr<const ParsedModule> first = cache.acquire("a.glsl", "void a() {}\n");
+
+    // Superseded sources are kept as long as they are used
+    std::shared_ptr<const ParsedModule> second = cache.acquire("a.glsl", "void a() { }\n");
+    REQUIRE(cache.size() == 2);
+    first.reset();
+    std::shared_ptr<const ParsedModule> third = cache.acquire("a.glsl", "void a() {  }\n");
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getStatistics().superseded == 1);
+    second.reset();
+    third.reset();
+    REQUIRE(cache.acquire("b.glsl", "void b() {}\n")->getId() == "b.glsl");
+    REQUIRE(cache.size() == 3);
+
+    // Superseded sources are dropped by purge() once released
+    cache.purge();
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getStatistics().superseded == 2);
+    std::shared_ptr<const ParsedModule> fourth = cache.acquire("b.glsl", "void b() { }\n");
+    std::shared_ptr<const ParsedModule> fifth = cache.acquire("b.glsl", "void b() {  }\n");
+    REQUIRE(cache.size() == 3);
+    cache.purge();
+    REQUIRE(cache.size() == 3);
+    fourth.reset();
+    cache.purge();
+    REQUIRE(cache.size() == 2);
+
+    // Hot reloading the same module many times: only the sources used by the graph are kept
+    ModuleCache reloadCache;
+    CacheTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\nvoid main() { a(); }\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setModuleCache(&reloadCache);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+
+    std::vector<std::string> touchedModules;
+    for (int i = 0; i < 100; i++) {
+        loader.files["shaders/a.glsl"] = "void a() {" + std::string(i + 1, ' ') + "}\n";
+        REQUIRE(moduleGraph.reload(touchedModules));
+        REQUIRE(reloadCache.size() == 2);
+    }
+
+    REQUIRE(moduleGraph.findModule("shaders/a.glsl")->getSourceLine(0) == "void a() {" + std::string(100, ' ') + "}");
+    REQUIRE(reloadCache.getStatistics().superseded == 100);
+}
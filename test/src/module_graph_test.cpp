@@ -1,9 +1,14 @@
 #include <catch2/catch.hpp>
+#include <glsl_assembler/assembly_sink.h>
 #include <glsl_assembler/module.h>
 #include <glsl_assembler/module_loader.h>
 #include <glsl_assembler/simple_module_loader.h>
 #include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/thread_pool.h>
 #include <cmrc/cmrc.hpp>
+#include <atomic>
+#include <map>
+#include <sstream>
 
 CMRC_DECLARE(GLSLAssemblerTests);
 
@@ -18,6 +23,13 @@ public:
     std::string load(const std::string &path) override {
         return StringUtils::replaceAll(loadFile(path), "\r\n", "\n");
     }
+
+    // Embedded resources are parsed in place, \r\n newlines included
+    SourceBuffer loadBuffer(const std::string &path) override {
+        static cmrc::embedded_filesystem fs = cmrc::GLSLAssemblerTests::get_filesystem();
+        cmrc::file resource = fs.open(path);
+        return SourceBuffer::borrow(resource.begin(), resource.size());
+    }
 };
 
 SCENARIO("ModuleGraph simple", "[module_graph_test.cpp]") {
@@ -41,6 +53,10 @@ SCENARIO("ModuleGraph simple", "[module_graph_test.cpp]") {
     REQUIRE(mainModule->getDependencyCount() == 2);
     REQUIRE(mainModule->getDependency(0).module == aModule);
     REQUIRE(mainModule->getDependency(1).module == bModule);
+    REQUIRE(moduleGraph.getModule(mainModule->getDependency(0).moduleHandle) == aModule);
+    REQUIRE(moduleGraph.getModule(mainModule->getDependency(1).moduleHandle) == bModule);
+    REQUIRE(moduleGraph.findModule("resources/shaders/simple/b.glsl") == bModule);
+    REQUIRE(moduleGraph.findModule("resources/shaders/simple/missing.glsl") == nullptr);
 
     REQUIRE(moduleGraph.getSourceBlocksCount() == 3);
     REQUIRE(moduleGraph.getSourceBlock(0).assembledRange.begin == 1);
@@ -62,6 +78,19 @@ SCENARIO("ModuleGraph simple", "[module_graph_test.cpp]") {
 
     REQUIRE(moduleGraph.mapLine(19, moduleLine) == mainModule);
     REQUIRE(moduleLine == 4);
+
+    REQUIRE(moduleGraph.mapLine(0, moduleLine) == nullptr);
+    REQUIRE(moduleLine == -1);
+    REQUIRE(moduleGraph.mapLine(6, moduleLine) == nullptr);
+    REQUIRE(moduleGraph.mapLine(22, moduleLine) == nullptr);
+
+    std::vector<int> assembledLines;
+    REQUIRE(moduleGraph.mapModuleLine(bModule, 3, assembledLines) == 1);
+    REQUIRE(assembledLines == std::vector<int>{ 11 });
+    REQUIRE(moduleGraph.mapModuleLine(mainModule, 4, assembledLines) == 1);
+    REQUIRE(assembledLines == std::vector<int>{ 19 });
+    REQUIRE(moduleGraph.mapModuleLine(mainModule, 100, assembledLines) == 0);
+    REQUIRE(assembledLines.empty());
 }
 
 SCENARIO("ModuleGraph cycle", "[module_graph_test.cpp]") {
@@ -110,4 +139,414 @@ SCENARIO("ModuleGraph hoisting", "[module_graph_test.cpp]") {
     moduleGraph.setIncludeDir("resources/shaders/hoisting");
     moduleGraph.loadModule("resources/shaders/hoisting/main.glsl");
     REQUIRE(moduleGraph.getAssembledSource() == loader.load("resources/shaders/hoisting/assembled.glsl"));
+
+    // Hoisted lines are mapped both at the top and inside the module
+    Module *mainModule = moduleGraph.findModule("resources/shaders/hoisting/main.glsl");
+    int moduleLine;
+    REQUIRE(moduleGraph.mapLine(0, moduleLine) == mainModule);
+    REQUIRE(moduleLine == 3);
+    REQUIRE(moduleGraph.mapLine(1, moduleLine) == mainModule);
+    REQUIRE(moduleLine == 4);
+    REQUIRE(moduleGraph.mapLine(20, moduleLine) == mainModule);
+    REQUIRE(moduleLine == 3);
+
+    std::vector<int> assembledLines;
+    REQUIRE(moduleGraph.mapModuleLine(mainModule, 3, assembledLines) == 2);
+    REQUIRE(assembledLines == std::vector<int>{ 0, 20 });
+}
+
+class MemoryModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+    std::map<std::string, std::uint64_t> versions;
+    std::atomic<int> loadCount;
+
+    MemoryModuleLoader()
+        : loadCount(0) {
+    }
+
+    std::string load(const std::string &path) override {
+        loadCount++;
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+
+    bool getVersion(const std::string &path, std::uint64_t &version) override {
+        const auto it = versions.find(path);
+        if (it == versions.end()) {
+            return false;
+        }
+
+        version = it->second;
+        return true;
+    }
+};
+
+static std::string assemble(MemoryModuleLoader &loader, const std::string &modulePath) {
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    return moduleGraph.loadModule(modulePath);
+}
+
+SCENARIO("ModuleGraph normalizes CRLF newlines", "[module_graph_test.cpp]") {
+    MemoryModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#version 330\n#include <a.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    const std::string expected = assemble(loader, "shaders/main.glsl");
+
+    for (auto &file : loader.files) {
+        file.second = StringUtils::replaceAll(file.second, "\n", "\r\n");
+    }
+
+    REQUIRE(assemble(loader, "shaders/main.glsl") == expected);
+}
+
+SCENARIO("ModuleGraph reload", "[module_graph_test.cpp]") {
+    MemoryModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\n#include \"b.glsl\"\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    loader.files["shaders/b.glsl"] = "#include <a.glsl>\nvoid b() {}\n";
+    loader.files["shaders/c.glsl"] = "void c() {}\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    std::vector<std::string> touchedModules;
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    moduleGraph.loadModule("shaders/main.glsl");
+    Module *aModule = moduleGraph.findModule("shaders/a.glsl");
+
+    REQUIRE(!moduleGraph.reload(touchedModules));
+    REQUIRE(touchedModules.empty());
+
+    // Only the changed module is parsed again
+    loader.files["shaders/b.glsl"] = "#include <a.glsl>\nvoid b() { a(); }\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(touchedModules == std::vector<std::string>{ "shaders/b.glsl" });
+    REQUIRE(moduleGraph.findModule("shaders/a.glsl") == aModule);
+    REQUIRE(moduleGraph.getAssembledSource() == assemble(loader, "shaders/main.glsl"));
+
+    // Changed dependencies: c is added, b (and then a) are removed
+    loader.files["shaders/main.glsl"] = "#include <c.glsl>\nvoid main() {}\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(touchedModules == std::vector<std::string>{ "shaders/main.glsl", "shaders/c.glsl", "shaders/a.glsl", "shaders/b.glsl" });
+    REQUIRE(moduleGraph.getModuleCount() == 2);
+    REQUIRE(moduleGraph.findModule("shaders/a.glsl") == nullptr);
+    REQUIRE(moduleGraph.getModule(moduleGraph.getSortedModule(1)->getDependency(0).moduleHandle) == moduleGraph.findModule("shaders/c.glsl"));
+    REQUIRE(moduleGraph.getAssembledSource() == assemble(loader, "shaders/main.glsl"));
+
+    // Parse errors leave the graph untouched
+    const std::string assembledSource = moduleGraph.getAssembledSource();
+    loader.files["shaders/c.glsl"] = "#include <>\n";
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getAssembledSource() == assembledSource);
+
+    // Missing dependencies empty the graph, the next reload starts from scratch
+    loader.files["shaders/c.glsl"] = "#include <missing.glsl>\n";
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getModuleCount() == 0);
+    loader.files["shaders/c.glsl"] = "void c() {}\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(touchedModules.size() == 2);
+    REQUIRE(moduleGraph.getAssembledSource() == assembledSource);
+
+    // Reloading from scratch can fail again, the graph is still emptied
+    loader.files["shaders/c.glsl"] = "#include <missing.glsl>\n";
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getModuleCount() == 0);
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getModuleCount() == 0);
+    REQUIRE(moduleGraph.getFailedModuleId() == "shaders/missing.glsl");
+    loader.files["shaders/c.glsl"] = "#include <main.glsl>\n";
+    REQUIRE_THROWS(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getModuleCount() == 0);
+    loader.files["shaders/c.glsl"] = "void c() {}\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getFailedModuleId().empty());
+    REQUIRE(moduleGraph.getAssembledSource() == assembledSource);
+}
+
+SCENARIO("ModuleGraph reload with version stamps", "[module_graph_test.cpp]") {
+    MemoryModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    loader.versions["shaders/main.glsl"] = 1;
+    loader.versions["shaders/a.glsl"] = 1;
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+
+    // Unchanged stamps: nothing is loaded
+    std::vector<std::string> touchedModules;
+    loader.loadCount = 0;
+    REQUIRE(!moduleGraph.reload(touchedModules));
+    REQUIRE(loader.loadCount == 0);
+
+    // Changed stamp but same contents: loaded, but not parsed again
+    loader.versions["shaders/a.glsl"] = 2;
+    REQUIRE(!moduleGraph.reload(touchedModules));
+    REQUIRE(loader.loadCount == 1);
+    REQUIRE(!moduleGraph.reload(touchedModules));
+    REQUIRE(loader.loadCount == 1);
+
+    loader.files["shaders/a.glsl"] = "void a() { }\n";
+    loader.versions["shaders/a.glsl"] = 3;
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(touchedModules == std::vector<std::string>{ "shaders/a.glsl" });
+    REQUIRE(moduleGraph.getAssembledSource() == assemble(loader, "shaders/main.glsl"));
+}
+
+SCENARIO("ModuleGraph reload reclaims the memory of removed modules", "[module_graph_test.cpp]") {
+    // main alternates between two sets of 20 modules
+    MemoryModuleLoader loader;
+    std::string includes[2];
+    for (int i = 0; i < 20; i++) {
+        for (int set = 0; set < 2; set++) {
+            const std::string name = "set" + std::to_string(set) + "_" + std::to_string(i) + ".glsl";
+            includes[set] += "#include <" + name + ">\n";
+            loader.files["shaders/" + name] = "void f" + std::to_string(set) + "_" + std::to_string(i) + "() {}\n";
+        }
+    }
+
+    loader.files["shaders/main.glsl"] = includes[0] + "void main() {}\n";
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::size_t loadedSize = moduleGraph.getArenaSize();
+    REQUIRE(!moduleGraph.compact());
+
+    // Reloading keeps the modules in place, the memory of the removed ones is reclaimed by compact()
+    Module *mainModule = moduleGraph.findModule("shaders/main.glsl");
+    std::vector<std::string> touchedModules;
+    for (int i = 1; i <= 100; i++) {
+        loader.files["shaders/main.glsl"] = includes[i % 2] + "void main() {}\n";
+        REQUIRE(moduleGraph.reload(touchedModules));
+        REQUIRE(touchedModules.size() == 41);
+        REQUIRE(moduleGraph.findModule("shaders/main.glsl") == mainModule);
+        if (i % 10 == 0) {
+            REQUIRE(moduleGraph.getArenaSize() > 3 * loadedSize);
+            REQUIRE(moduleGraph.compact());
+            REQUIRE(moduleGraph.getArenaSize() <= loadedSize);
+            REQUIRE(!moduleGraph.compact());
+            mainModule = moduleGraph.findModule("shaders/main.glsl");
+        }
+    }
+
+    // The moved modules are still consistent
+    REQUIRE(moduleGraph.getAssembledSource() == assemble(loader, "shaders/main.glsl"));
+    for (int i = 0; i < moduleGraph.getModuleCount(); i++) {
+        Module *module = moduleGraph.getModule(i);
+        REQUIRE(moduleGraph.findModule(module->getId()) == module);
+        for (const Module::Dependency &dependency : *module) {
+            REQUIRE(dependency.module == moduleGraph.getModule(dependency.moduleHandle));
+        }
+
+        std::vector<int> lines;
+        int moduleLine;
+        REQUIRE(moduleGraph.mapModuleLine(module, 0, lines) > 0);
+        REQUIRE(moduleGraph.mapLine(lines[0], moduleLine) == module);
+    }
+
+    loader.files["shaders/set0_0.glsl"] = "void f0_0() { }\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getAssembledSource() == assemble(loader, "shaders/main.glsl"));
+}
+
+static void requireSameGraph(const ModuleGraph &expected, const ModuleGraph &actual) {
+    REQUIRE(actual.getAssembledSource() == expected.getAssembledSource());
+    REQUIRE(actual.getModuleCount() == expected.getModuleCount());
+    for (int i = 0; i < expected.getModuleCount(); i++) {
+        REQUIRE(actual.getModule(i)->getId() == expected.getModule(i)->getId());
+        REQUIRE(actual.getSortedModule(i)->getId() == expected.getSortedModule(i)->getId());
+    }
+}
+
+SCENARIO("ModuleGraph parallel loading", "[module_graph_test.cpp]") {
+    // A wide graph: main includes 20 modules, each including a shared one and a private one
+    MemoryModuleLoader loader;
+    std::string main;
+    for (int i = 0; i < 20; i++) {
+        const std::string index = std::to_string(i);
+        main += "#include <level1_" + index + ".glsl>\n";
+        loader.files["shaders/level1_" + index + ".glsl"] = "#include <shared.glsl>\n#include \"level2_" + index + ".glsl\"\nvoid f" + index + "() {}\n";
+        loader.files["shaders/level2_" + index + ".glsl"] = "#include <shared.glsl>\nvoid g" + index + "() {}\n";
+    }
+    loader.files["shaders/main.glsl"] = main + "void main() {}\n";
+    loader.files["shaders/shared.glsl"] = "void shared() {}\n";
+
+    ThreadPool threadPool(4);
+    ModuleGraph serial;
+    serial.setModuleLoader(&loader);
+    serial.setIncludeDir("shaders");
+    serial.loadModule("shaders/main.glsl");
+    REQUIRE(serial.getModuleCount() == 42);
+
+    ModuleGraph parallel;
+    parallel.setModuleLoader(&loader);
+    parallel.setThreadPool(&threadPool);
+    parallel.setIncludeDir("shaders");
+    parallel.loadModule("shaders/main.glsl");
+    requireSameGraph(serial, parallel);
+
+    // Same results on the fixtures
+    const std::vector<std::string> fixtures = { "simple", "comment", "relative", "diamond", "hoisting" };
+    for (const std::string &fixture : fixtures) {
+        CMRCModuleLoader cmrcLoader;
+        ModuleGraph serialFixture;
+        serialFixture.setModuleLoader(&cmrcLoader);
+        serialFixture.setIncludeDir("resources/shaders/" + fixture);
+        serialFixture.loadModule("resources/shaders/" + fixture + "/main.glsl");
+
+        ModuleGraph parallelFixture;
+        parallelFixture.setModuleLoader(&cmrcLoader);
+        parallelFixture.setThreadPool(&threadPool);
+        parallelFixture.setIncludeDir("resources/shaders/" + fixture);
+        parallelFixture.loadModule("resources/shaders/" + fixture + "/main.glsl");
+        requireSameGraph(serialFixture, parallelFixture);
+    }
+
+    // Errors are reported for the first failing module in discovery order
+    loader.files.erase("shaders/level2_3.glsl");
+    loader.files.erase("shaders/level2_7.glsl");
+    REQUIRE_THROWS_WITH(parallel.loadModule("shaders/main.glsl"), "Not found: shaders/level2_3.glsl");
+}
+
+SCENARIO("ModuleGraph writes the assembled source to sinks", "[module_graph_test.cpp]") {
+    const std::vector<std::string> fixtures = { "simple", "comment", "relative", "diamond", "hoisting" };
+    for (const std::string &fixture : fixtures) {
+        CMRCModuleLoader loader;
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&loader);
+        moduleGraph.setIncludeDir("resources/shaders/" + fixture);
+        moduleGraph.loadModule("resources/shaders/" + fixture + "/main.glsl");
+        const std::string &assembledSource = moduleGraph.getAssembledSource();
+        REQUIRE(assembledSource == loader.load("resources/shaders/" + fixture + "/assembled.glsl"));
+        REQUIRE(moduleGraph.getAssembledSourceSize() == assembledSource.size());
+
+        std::string str = "prefix";
+        StringAssemblySink stringSink(str);
+        moduleGraph.writeAssembledSource(stringSink);
+        REQUIRE(str == "prefix" + assembledSource);
+
+        std::ostringstream stream;
+        StreamAssemblySink streamSink(stream);
+        moduleGraph.writeAssembledSource(streamSink);
+        REQUIRE(stream.str() == assembledSource);
+
+        std::string chunks;
+        std::size_t reserved = 0;
+        CallbackAssemblySink callbackSink(
+            [&chunks](const char *data, std::size_t size) { chunks.append(data, size); },
+            [&reserved](std::size_t size) { reserved += size; });
+        moduleGraph.writeAssembledSource(callbackSink);
+        REQUIRE(chunks == assembledSource);
+        REQUIRE(reserved == assembledSource.size());
+
+        // Without keeping the assembled source, the layout is the same
+        ModuleGraph streamedGraph;
+        streamedGraph.setModuleLoader(&loader);
+        streamedGraph.setKeepAssembledSource(false);
+        streamedGraph.setIncludeDir("resources/shaders/" + fixture);
+        REQUIRE(streamedGraph.loadModule("resources/shaders/" + fixture + "/main.glsl").empty());
+        REQUIRE(streamedGraph.getAssembledSourceSize() == assembledSource.size());
+        REQUIRE(streamedGraph.getSourceBlocksCount() == moduleGraph.getSourceBlocksCount());
+        for (int i = 0; i < moduleGraph.getSourceBlocksCount(); i++) {
+            REQUIRE(streamedGraph.getSourceBlock(i).assembledRange.begin == moduleGraph.getSourceBlock(i).assembledRange.begin);
+            REQUIRE(streamedGraph.getSourceBlock(i).assembledRange.end == moduleGraph.getSourceBlock(i).assembledRange.end);
+        }
+
+        std::string streamed;
+        StringAssemblySink streamedSink(streamed);
+        streamedGraph.writeAssembledSource(streamedSink);
+        REQUIRE(streamed == assembledSource);
+    }
+
+    // An empty graph writes nothing
+    ModuleGraph emptyGraph;
+    std::string empty;
+    StringAssemblySink emptySink(empty);
+    emptyGraph.writeAssembledSource(emptySink);
+    REQUIRE(empty.empty());
+    REQUIRE(emptyGraph.getAssembledSourceSize() == 0);
+}
+
+SCENARIO("ModuleGraph program hash", "[module_graph_test.cpp]") {
+    MemoryModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\n#include <b.glsl>\nvoid main() {}\n";
+    loader.files["shaders/other.glsl"] = "#include <a.glsl>\n#include <b.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    loader.files["shaders/b.glsl"] = "void b() {}\n";
+
+    ModuleGraph moduleGraph;
+    REQUIRE(moduleGraph.getProgramHash() == 0);
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::uint64_t programHash = moduleGraph.getProgramHash();
+    REQUIRE(programHash != 0);
+
+    // Same modules, same hash, even without keeping the assembled source
+    ModuleGraph sameGraph;
+    sameGraph.setModuleLoader(&loader);
+    sameGraph.setKeepAssembledSource(false);
+    sameGraph.setIncludeDir("shaders");
+    sameGraph.loadModule("shaders/main.glsl");
+    REQUIRE(sameGraph.getProgramHash() == programHash);
+
+    // The root module id is part of the assembled source
+    sameGraph.loadModule("shaders/other.glsl");
+    REQUIRE(sameGraph.getProgramHash() != programHash);
+
+    // Contents and order changes
+    loader.files["shaders/a.glsl"] = "void a() { }\n";
+    std::vector<std::string> touchedModules;
+    REQUIRE(moduleGraph.reload(touchedModules));
+    const std::uint64_t changedHash = moduleGraph.getProgramHash();
+    REQUIRE(changedHash != programHash);
+    loader.files["shaders/main.glsl"] = "#include <b.glsl>\n#include <a.glsl>\nvoid main() {}\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getProgramHash() != changedHash);
+    loader.files["shaders/main.glsl"] = "#include <a.glsl>\n#include <b.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "void a() {}\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(moduleGraph.getProgramHash() == programHash);
+}
+
+SCENARIO("ModuleGraph deep chains and cycles", "[module_graph_test.cpp]") {
+    // The topological sort does not recurse
+    MemoryModuleLoader loader;
+    const int depth = 20000;
+    for (int i = 0; i < depth; i++) {
+        const std::string include = i + 1 < depth ? "#include \"" + std::to_string(i + 1) + ".glsl\"\n" : "";
+        loader.files["chain/" + std::to_string(i) + ".glsl"] = include + "void f" + std::to_string(i) + "() {}\n";
+    }
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.loadModule("chain/0.glsl");
+    REQUIRE(moduleGraph.getModuleCount() == depth);
+    REQUIRE(moduleGraph.getSortedModule(0)->getId() == "chain/" + std::to_string(depth - 1) + ".glsl");
+    REQUIRE(moduleGraph.getSortedModule(depth - 1)->getId() == "chain/0.glsl");
+
+    // One cycle is reported for every strongly connected component
+    loader.files["cycles/main.glsl"] = "#include \"a.glsl\"\n#include \"c.glsl\"\n#include \"e.glsl\"\n";
+    loader.files["cycles/a.glsl"] = "#include \"b.glsl\"\n";
+    loader.files["cycles/b.glsl"] = "#include \"a.glsl\"\n";
+    loader.files["cycles/c.glsl"] = "#include \"d.glsl\"\n";
+    loader.files["cycles/d.glsl"] = "#include \"c.glsl\"\n";
+    loader.files["cycles/e.glsl"] = "#include \"e.glsl\"\n";
+    REQUIRE_THROWS_WITH(
+        moduleGraph.loadModule("cycles/main.glsl"),
+        "Dependency cycle: cycles/a.glsl --> cycles/b.glsl --> cycles/a.glsl\n"
+        "Dependency cycle: cycles/c.glsl --> cycles/d.glsl --> cycles/c.glsl\n"
+        "Dependency cycle: cycles/e.glsl --> cycles/e.glsl"
+    );
 }
@@ -0,0 +1,33 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_registry.h>
+#include <memory>
+
+SCENARIO("ModuleRegistry works", "[module_registry_test.cpp]") {
+    std::unique_ptr<Module> a(Module::fromSource("shaders/a.glsl", "void a() {}\n"));
+    std::unique_ptr<Module> b(Module::fromSource("shaders/b.glsl", "void b() {}\n"));
+    std::unique_ptr<Module> duplicate(Module::fromSource("shaders/a.glsl", "void a() {}\n"));
+
+    ModuleRegistry registry;
+    REQUIRE(registry.size() == 0);
+    REQUIRE(registry.find("shaders/a.glsl") == ModuleRegistry::INVALID_HANDLE);
+    REQUIRE(!registry.isValid(ModuleRegistry::INVALID_HANDLE));
+
+    REQUIRE(registry.add(a.get()) == 0);
+    REQUIRE(registry.add(b.get()) == 1);
+    REQUIRE_THROWS(registry.add(duplicate.get()));
+    REQUIRE(registry.size() == 2);
+
+    REQUIRE(registry.find("shaders/a.glsl") == 0);
+    REQUIRE(registry.find("shaders/b.glsl") == 1);
+    REQUIRE(registry.find("shaders/c.glsl") == ModuleRegistry::INVALID_HANDLE);
+    REQUIRE(registry.get(0) == a.get());
+    REQUIRE(registry.get(1) == b.get());
+    REQUIRE(registry.isValid(1));
+    REQUIRE(!registry.isValid(2));
+    REQUIRE(*registry.begin() == a.get());
+
+    registry.clear();
+    REQUIRE(registry.size() == 0);
+    REQUIRE(registry.find("shaders/a.glsl") == ModuleRegistry::INVALID_HANDLE);
+}
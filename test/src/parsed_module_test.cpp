@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/parsed_module.h>
+#include <glsl_assembler/string_utils.h>
+#include <vector>
+
+static void requireSameLines(const std::string &source) {
+    const std::shared_ptr<const ParsedModule> module = ParsedModule::parse("test.glsl", source);
+    const std::vector<std::string> lines = StringUtils::splitLines(source);
+    REQUIRE(module->getSourceLinesCount() == lines.size());
+    for (int i = 0; i < lines.size(); i++) {
+        REQUIRE(module->getSourceLine(i) == lines[i]);
+    }
+}
+
+SCENARIO("ParsedModule works", "[parsed_module_test.cpp]") {
+    // Same lines as StringUtils::splitLines()
+    requireSameLines("");
+    requireSameLines("\n");
+    requireSameLines("\n\n");
+    requireSameLines("void a() {}");
+    requireSameLines("void a() {}\n");
+    requireSameLines("void a() {}\n\nvoid b() {}");
+
+    // \r\n newlines are normalized, lone carriage returns are kept
+    const std::shared_ptr<const ParsedModule> crlfModule = ParsedModule::parse("crlf.glsl", "#version 330\r\n#include <a.glsl>\r\n\r\nvoid a() {}\rx\r\n\r", nullptr);
+    REQUIRE(crlfModule->getSourceLinesCount() == 5);
+    REQUIRE(crlfModule->getSourceLine(0) == "// #version 330");
+    REQUIRE(crlfModule->getSourceLine(1) == "// #include <a.glsl>");
+    REQUIRE(crlfModule->getSourceLine(2) == "");
+    REQUIRE(crlfModule->getSourceLine(3) == "void a() {}\rx");
+    REQUIRE(crlfModule->getSourceLine(4) == "\r");
+    REQUIRE(crlfModule->getHoistedLine(0).line == "#version 330");
+    REQUIRE(crlfModule->getInclude(0).path == "a.glsl");
+
+    // Include and hoisted lines are commented, the other ones are untouched
+    const std::shared_ptr<const ParsedModule> module = ParsedModule::parse(
+        "test.glsl", "#version 330\n#include <a.glsl>\nvoid main() {}\n  #include \"b.glsl\"  \nprecision highp float;");
+    REQUIRE(module->getSourceLinesCount() == 5);
+    REQUIRE(module->getSourceLine(0) == "// #version 330");
+    REQUIRE(module->getSourceLine(1) == "// #include <a.glsl>");
+    REQUIRE(module->getSourceLine(2) == "void main() {}");
+    REQUIRE(module->getSourceLine(3) == "//   #include \"b.glsl\"  ");
+    REQUIRE(module->getSourceLine(4) == "// precision highp float;");
+    REQUIRE(module->getSourceLine(2).str() == "void main() {}");
+    REQUIRE_THROWS(module->getSourceLine(5));
+
+    REQUIRE(module->getIncludeCount() == 2);
+    REQUIRE(module->getInclude(0).path == "a.glsl");
+    REQUIRE(module->getInclude(0).line == 1);
+    REQUIRE(module->getInclude(1).path == "b.glsl");
+    REQUIRE(module->getInclude(1).line == 3);
+    REQUIRE(module->getHoistedLinesCount() == 2);
+    REQUIRE(module->getHoistedLine(0).line == "#version 330");
+    REQUIRE(module->getHoistedLine(1).line == "precision highp float;");
+    REQUIRE(module->getHoistedLine(1).index == 4);
+
+    std::vector<std::string> lines;
+    module->inject(lines);
+    REQUIRE(lines.size() == 7);
+    REQUIRE(lines[0] == "// MODULE BEGIN: test.glsl");
+    REQUIRE(lines[3] == "void main() {}");
+    REQUIRE(lines[6] == "");
+}
+
+SCENARIO("ParsedModule parses buffers in place", "[parsed_module_test.cpp]") {
+    static const char source[] = "#include <a.glsl>\nvoid main() {}\n";
+    const SourceBuffer buffer = SourceBuffer::borrow(source, sizeof(source) - 1);
+    const std::shared_ptr<const ParsedModule> module = ParsedModule::parse("test.glsl", buffer, nullptr);
+    REQUIRE(module->getSourceLinesCount() == 2);
+    REQUIRE(module->getSourceLine(0) == "// #include <a.glsl>");
+    REQUIRE(module->getSourceLine(1).data() == source + 18);
+    REQUIRE(module->getSourceSize() == buffer.size());
+    REQUIRE(module->getSourceHash() == ParsedModule::parse("test.glsl", buffer.str())->getSourceHash());
+
+    // The module keeps an owned buffer alive
+    SourceBuffer ownedBuffer = SourceBuffer::fromString("void a() {}\n");
+    const std::weak_ptr<const void> owner = ownedBuffer.getOwner();
+    const std::shared_ptr<const ParsedModule> ownedModule = ParsedModule::parse("owned.glsl", ownedBuffer, nullptr);
+    ownedBuffer = SourceBuffer();
+    REQUIRE(!owner.expired());
+    REQUIRE(ownedModule->getSourceLine(0) == "void a() {}");
+    const std::shared_ptr<const ParsedModule> borrowedModule = ParsedModule::parse("owned.glsl", SourceBuffer::borrow("void a() {}\n", 12), nullptr);
+    REQUIRE(ownedModule->getMemoryUsage() == borrowedModule->getMemoryUsage() + 12);
+}
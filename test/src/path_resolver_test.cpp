@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/path_resolver.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <map>
+#include <stdexcept>
+
+class PathResolverTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+    int joinCount = 0;
+    int extractPathCount = 0;
+
+    std::string load(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+
+    std::string extractPath(const std::string &pathName) override {
+        extractPathCount++;
+        return SimpleModuleLoader::extractPath(pathName);
+    }
+
+    std::string join(const std::string &path, const std::string &pathName) override {
+        joinCount++;
+        return SimpleModuleLoader::join(path, pathName);
+    }
+};
+
+SCENARIO("PathResolver works", "[path_resolver_test.cpp]") {
+    PathResolverTestModuleLoader loader;
+    PathResolver pathResolver(&loader);
+    REQUIRE(pathResolver.getModuleLoader() == &loader);
+
+    // Results are computed once, then interned
+    const std::string &joined = pathResolver.join("shaders/lib", "../common/math.glsl");
+    REQUIRE(joined == "shaders/common/math.glsl");
+    REQUIRE(&pathResolver.join("shaders/lib", "../common/math.glsl") == &joined);
+    REQUIRE(pathResolver.join("shaders", "common/math.glsl") == joined);
+    REQUIRE(&pathResolver.join("shaders", "common/math.glsl") == &joined);
+    REQUIRE(loader.joinCount == 2);
+    REQUIRE(pathResolver.getPathCount() == 1);
+
+    const std::string &directory = pathResolver.extractPath("shaders/lib/a.glsl");
+    REQUIRE(directory == "shaders/lib");
+    REQUIRE(&pathResolver.extractPath("shaders/lib/a.glsl") == &directory);
+    REQUIRE(loader.extractPathCount == 1);
+    REQUIRE(pathResolver.getHits() == 3);
+    REQUIRE(pathResolver.getMisses() == 3);
+
+    // Errors are not cached
+    REQUIRE_THROWS_AS(pathResolver.join("shaders", "../../a.glsl"), std::runtime_error);
+    REQUIRE_THROWS_AS(pathResolver.join("shaders", "../../a.glsl"), std::runtime_error);
+    REQUIRE(loader.joinCount == 4);
+
+    // Changing the loader clears the cache
+    PathResolverTestModuleLoader otherLoader;
+    pathResolver.setModuleLoader(&otherLoader);
+    REQUIRE(pathResolver.getPathCount() == 0);
+    REQUIRE(pathResolver.join("shaders", "common/math.glsl") == "shaders/common/math.glsl");
+    REQUIRE(otherLoader.joinCount == 1);
+    REQUIRE(pathResolver.getHits() == 0);
+}
+
+SCENARIO("ModuleGraph resolves each include once", "[path_resolver_test.cpp]") {
+    PathResolverTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#include \"a.glsl\"\n#include \"b.glsl\"\n#include <common/math.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "#include <common/math.glsl>\nvoid a() {}\n";
+    loader.files["shaders/b.glsl"] = "#include <common/math.glsl>\n#include \"./common/math.glsl\"\nvoid b() {}\n";
+    loader.files["shaders/common/math.glsl"] = "float square(float x) { return x * x; }\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getModuleCount() == 4);
+    REQUIRE(moduleGraph.findModule("shaders/b.glsl")->getDependency(1).moduleHandle ==
+            moduleGraph.findModule("shaders/a.glsl")->getDependency(0).moduleHandle);
+
+    // 4 distinct (directory, include) pairs, 2 including modules with relative includes
+    REQUIRE(loader.joinCount == 4);
+    REQUIRE(loader.extractPathCount == 2);
+    REQUIRE(moduleGraph.getPathResolver().getHits() == 3);
+
+    // Loading again resolves nothing
+    const std::string source = moduleGraph.getAssembledSource();
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() == source);
+    REQUIRE(loader.joinCount == 4);
+    REQUIRE(loader.extractPathCount == 2);
+}
@@ -0,0 +1,171 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/batch_assembler.h>
+#include <glsl_assembler/module_cache.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/profiler.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/thread_pool.h>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+class ProfilerTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+};
+
+static int countEvents(const std::vector<Profiler::Event> &events, const std::string &name) {
+    int count = 0;
+    for (const Profiler::Event &event : events) {
+        count += event.name == name ? 1 : 0;
+    }
+
+    return count;
+}
+
+SCENARIO("Profiler works", "[profiler_test.cpp]") {
+    ProfilerTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] = "#version 330\n#include <a.glsl>\n#include <b.glsl>\nvoid main() {}\n";
+    loader.files["shaders/a.glsl"] = "#include \"b.glsl\"\nvoid a() {}\n";
+    loader.files["shaders/b.glsl"] = "void b() {}\n";
+
+    Profiler profiler;
+    std::size_t allocations = 0;
+    profiler.setAllocationCounter([&]() { return allocations += 10; });
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.setProfiler(&profiler);
+    REQUIRE(moduleGraph.getProfiler() == &profiler);
+    moduleGraph.loadModule("shaders/main.glsl");
+
+    // Phases and counters
+    const Profiler::Statistics statistics = profiler.getStatistics();
+    REQUIRE(statistics.counters.modulesLoaded == 3);
+    REQUIRE(statistics.counters.modulesReused == 0);
+    REQUIRE(statistics.counters.bytesLoaded == 64 + 30 + 12);
+    REQUIRE(statistics.counters.linesProcessed == 4 + 2 + 1);
+    REQUIRE(statistics.counters.bytesAssembled == moduleGraph.getAssembledSourceSize());
+    REQUIRE(statistics.getPhaseTime(Profiler::Phase::LOAD) > Profiler::Clock::duration::zero());
+    REQUIRE(statistics.getPhaseTime(Profiler::Phase::ASSEMBLE) > Profiler::Clock::duration::zero());
+    REQUIRE(statistics.getPhaseAllocations(Profiler::Phase::LOAD) == 3 * 10);
+    REQUIRE(statistics.getPhaseAllocations(Profiler::Phase::SORT) == 10);
+
+    // Events: one per module for load and analyze, one per BFS level for resolve
+    const std::vector<Profiler::Event> events = profiler.getEvents();
+    REQUIRE(countEvents(events, "load") == 3);
+    REQUIRE(countEvents(events, "analyze") == 3);
+    REQUIRE(countEvents(events, "resolve") == 2);
+    REQUIRE(countEvents(events, "sort") == 1);
+    REQUIRE(countEvents(events, "assemble") == 1);
+    REQUIRE(countEvents(events, "loadModule") == 1);
+    REQUIRE(events.back().name == "loadModule");
+    REQUIRE(events.back().module == "shaders/main.glsl");
+    REQUIRE(events[0].name == "load");
+    REQUIRE(events[0].module == "shaders/main.glsl");
+    for (const Profiler::Event &event : events) {
+        REQUIRE(event.thread == 0);
+        REQUIRE(event.begin >= events.back().begin);
+    }
+
+    // Chrome trace
+    std::ostringstream trace;
+    trace << 1.5;
+    profiler.writeChromeTrace(trace);
+    const std::string json = trace.str();
+    REQUIRE(json.find("1.5{\"traceEvents\":[\n{\"name\":\"load\",\"cat\":\"glsl_assembler\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":") == 0);
+    REQUIRE(json.find("\"args\":{\"module\":\"shaders/main.glsl\"}}") != std::string::npos);
+    REQUIRE(json.find("\n],\"displayTimeUnit\":\"ms\"}\n") == json.size() - 27);
+    trace.str("");
+    trace << 1.5;
+    REQUIRE(trace.str() == "1.5");
+
+    // Unchanged modules are reused on reload
+    std::vector<std::string> touchedModules;
+    profiler.clear();
+    REQUIRE(profiler.getEvents().empty());
+    loader.files["shaders/b.glsl"] = "void b() { }\n";
+    REQUIRE(moduleGraph.reload(touchedModules));
+    REQUIRE(profiler.getStatistics().counters.modulesLoaded == 3);
+    REQUIRE(profiler.getStatistics().counters.linesProcessed == 1);
+    REQUIRE(countEvents(profiler.getEvents(), "reload") == 1);
+    REQUIRE(countEvents(profiler.getEvents(), "analyze") == 3);
+    REQUIRE(countEvents(profiler.getEvents(), "sort") == 0);
+
+    // Only statistics
+    profiler.clear();
+    profiler.setRecordEvents(false);
+    REQUIRE(!profiler.isRecordEvents());
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(profiler.getEvents().empty());
+    REQUIRE(profiler.getStatistics().counters.modulesLoaded == 3);
+
+    // Special characters are escaped
+    profiler.clear();
+    profiler.setRecordEvents(true);
+    const std::string id = "shaders/\"quoted\"\\\t.glsl";
+    {
+        Profiler::Scope scope(&profiler, "custom", id);
+    }
+
+    trace.str("");
+    profiler.writeChromeTrace(trace);
+    REQUIRE(trace.str().find("\"args\":{\"module\":\"shaders/\\\"quoted\\\"\\\\\\t.glsl\"}}") != std::string::npos);
+
+    // No profiler, no instrumentation
+    {
+        Profiler::Scope scope(nullptr, Profiler::Phase::LOAD, id);
+    }
+
+    REQUIRE(Profiler::getPhaseName(Profiler::Phase::RESOLVE) == std::string("resolve"));
+}
+
+SCENARIO("Profiler records batches", "[profiler_test.cpp]") {
+    ProfilerTestModuleLoader loader;
+    loader.files["shaders/common.glsl"] = "void common() {}\n";
+    std::vector<std::string> modulePaths;
+    for (int i = 0; i < 16; i++) {
+        const std::string path = "shaders/root" + std::to_string(i) + ".glsl";
+        loader.files[path] = "#include <common.glsl>\nvoid main() {}\n";
+        modulePaths.push_back(path);
+    }
+
+    Profiler profiler;
+    ThreadPool threadPool(4);
+    BatchAssembler batchAssembler;
+    batchAssembler.setModuleLoader(&loader);
+    batchAssembler.setIncludeDir("shaders");
+    batchAssembler.setThreadPool(&threadPool);
+    batchAssembler.setProfiler(&profiler);
+    REQUIRE(batchAssembler.getProfiler() == &profiler);
+    const std::vector<BatchAssembler::Result> results = batchAssembler.assemble(modulePaths);
+
+    std::set<std::string> loadedRoots;
+    std::set<int> threads;
+    for (const Profiler::Event &event : profiler.getEvents()) {
+        if (event.name == "loadModule") {
+            loadedRoots.insert(event.module);
+        }
+
+        threads.insert(event.thread);
+    }
+
+    REQUIRE(loadedRoots.size() == 16);
+    REQUIRE(threads.size() >= 1);
+    REQUIRE(*threads.rbegin() == threads.size() - 1);
+    REQUIRE(profiler.getStatistics().counters.modulesLoaded == 32);
+
+    // The result graphs no longer record into the batch profiler
+    REQUIRE(results[0].moduleGraph->getProfiler() == nullptr);
+}
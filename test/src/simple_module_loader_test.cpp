@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 #include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/string_utils.h>
+#include <stdexcept>
 
 class TestModuleLoader : public SimpleModuleLoader {
 public:
@@ -9,6 +11,26 @@ public:
     }
 };
 
+// Segment-based implementation of SimpleModuleLoader::join(), as a reference
+static std::string referenceJoin(const std::string &path, const std::string &pathName) {
+    std::vector<std::string> pathSegments = StringUtils::split(path, "/");
+    for (const std::string &segment : StringUtils::split(pathName, "/")) {
+        if (segment == "" || segment == ".") {
+            continue;
+        } else if (segment == "..") {
+            if (pathSegments.empty()) {
+                throw std::runtime_error("Unknown path");
+            }
+
+            pathSegments.pop_back();
+        } else {
+            pathSegments.push_back(segment);
+        }
+    }
+
+    return StringUtils::join(pathSegments, "/");
+}
+
 SCENARIO("SimpleModuleLoader works", "[simple_module_loader_test.cpp]") {
     TestModuleLoader loader;
     REQUIRE(loader.isPath(""));
@@ -20,4 +42,31 @@ SCENARIO("SimpleModuleLoader works", "[simple_module_loader_test.cpp]") {
     REQUIRE(loader.join("my_path/nested", "../file.txt") == "my_path/file.txt");
     REQUIRE(loader.join("my_path", "../file.txt") == "file.txt");
     REQUIRE_THROWS(loader.join("my_path", "../../file.txt"));
+
+    // Same results as the segment-based implementation
+    const char *paths[] = { "", "a", "a/b", "/a", "a/", "a//b", "../a" };
+    const char *pathNames[] = { "", "x.glsl", "b/x.glsl", "/x.glsl", "x/", "./x.glsl", "../x.glsl", "../../x.glsl",
+                                "b/../x.glsl", "b//x.glsl", ".", "..", "...", ".x/..y", "../../../x.glsl" };
+    for (const char *path : paths) {
+        for (const char *pathName : pathNames) {
+            std::string expected;
+            try {
+                expected = referenceJoin(path, pathName);
+            } catch (const std::runtime_error &) {
+                REQUIRE_THROWS_AS(loader.join(path, pathName), std::runtime_error);
+                continue;
+            }
+
+            REQUIRE(loader.join(path, pathName) == expected);
+        }
+    }
+
+    REQUIRE(SimpleModuleLoader::isNormalized("common/math.glsl"));
+    REQUIRE(SimpleModuleLoader::isNormalized("...x/.y"));
+    REQUIRE(!SimpleModuleLoader::isNormalized(""));
+    REQUIRE(!SimpleModuleLoader::isNormalized("/math.glsl"));
+    REQUIRE(!SimpleModuleLoader::isNormalized("common//math.glsl"));
+    REQUIRE(!SimpleModuleLoader::isNormalized("./math.glsl"));
+    REQUIRE(!SimpleModuleLoader::isNormalized("common/../math.glsl"));
+    REQUIRE(!SimpleModuleLoader::isNormalized("common/"));
 }
@@ -0,0 +1,171 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/source_minifier.h>
+#include <cmrc/cmrc.hpp>
+#include <map>
+#include <stdexcept>
+
+CMRC_DECLARE(GLSLAssemblerTests);
+
+class SourceMinifierTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it != files.end()) {
+            return it->second;
+        }
+
+        return loadBuffer(path).str();
+    }
+
+    SourceBuffer loadBuffer(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it != files.end()) {
+            return SourceBuffer::fromString(it->second);
+        }
+
+        static cmrc::embedded_filesystem fs = cmrc::GLSLAssemblerTests::get_filesystem();
+        cmrc::file resource = fs.open(path);
+        return SourceBuffer::borrow(resource.begin(), resource.size());
+    }
+};
+
+static std::string minifyLines(const std::vector<std::string> &lines) {
+    SourceMinifier::State state;
+    std::string output;
+    std::string minifiedLine;
+    for (const std::string &line : lines) {
+        SourceMinifier::minifyLine(line, state, minifiedLine);
+        output += minifiedLine + "|";
+    }
+
+    return output;
+}
+
+SCENARIO("SourceMinifier works", "[source_minifier_test.cpp]") {
+    // Whitespace is only kept between tokens which would merge
+    REQUIRE(minifyLines({ "  vec3 color = vec3 ( 1.0, 0.5 , 0.0 ) ;  " }) == "vec3 color=vec3(1.0,0.5,0.0);|");
+    REQUIRE(minifyLines({ "a = b - -c + +d;", "x = y / *p;", "i = j < <k;" }) == "a=b- -c+ +d;|x=y/ *p;|i=j< <k;|");
+    REQUIRE(minifyLines({ "a += 1; b = c == d;", "f = 1.5e-3 + .5;" }) == "a+=1;b=c==d;|f=1.5e-3+.5;|");
+    REQUIRE(minifyLines({ "\t\t", "" }) == "||");
+
+    // Comments are removed, and count as whitespace
+    REQUIRE(minifyLines({ "float/* x */y; // comment", "a/**/=/**/b;" }) == "float y;|a=b;|");
+    REQUIRE(minifyLines({ "x = 1; /* multi", " * line", " */ y = 2;" }) == "x=1;||y=2;|");
+
+    // Directives keep single spaces, spliced lines are kept as they are
+    REQUIRE(minifyLines({ "  #define  F(x)  ((x) * 2) // twice" }) == "#define F(x) ((x) * 2)|");
+    REQUIRE(minifyLines({ "#define G (x)" }) == "#define G (x)|");
+    REQUIRE(minifyLines({ "  #define LONG a + \\  ", "    b // c", "x = 1;" }) == "#define LONG a + \\|    b // c|x=1;|");
+    REQUIRE(minifyLines({ "/*", " comment \\", "*/ a ;" }) == "||a;|");
+}
+
+SCENARIO("ModuleGraph minified output", "[source_minifier_test.cpp]") {
+    SourceMinifierTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] =
+        "#version 330 // version\n"
+        "#include <lib.glsl>\n"
+        "\n"
+        "/*\n"
+        " * Entry point\n"
+        " */\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    color = vec4( lib(), 1.0 );\n"
+        "}\n";
+    loader.files["shaders/lib.glsl"] =
+        "// Library\n"
+        "vec3 lib() {\n"
+        "    return vec3(0.5);\n"
+        "}\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::uint64_t fullHash = moduleGraph.getProgramHash();
+
+    moduleGraph.setMinify(true);
+    REQUIRE(moduleGraph.isMinify());
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() ==
+        "#version 330\n"
+        "vec3 lib(){\n"
+        "return vec3(0.5);\n"
+        "}\n"
+        "out vec4 color;\n"
+        "void main(){\n"
+        "color=vec4(lib(),1.0);\n"
+        "}"
+    );
+    REQUIRE(moduleGraph.getAssembledSourceSize() == moduleGraph.getAssembledSource().size());
+    REQUIRE(moduleGraph.getProgramHash() != fullHash);
+
+    // Line mapping skips the removed lines
+    const Module *lib = moduleGraph.findModule("shaders/lib.glsl");
+    const Module *main = moduleGraph.findModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getSourceBlocksCount() == 1 + 1 + 1);
+    int moduleLine = -1;
+    REQUIRE(moduleGraph.mapLine(0, moduleLine) == main);
+    REQUIRE(moduleLine == 0);
+    REQUIRE(moduleGraph.mapLine(1, moduleLine) == lib);
+    REQUIRE(moduleLine == 1);
+    REQUIRE(moduleGraph.mapLine(4, moduleLine) == main);
+    REQUIRE(moduleLine == 6);
+    REQUIRE(moduleGraph.mapLine(7, moduleLine) == main);
+    REQUIRE(moduleLine == 9);
+    std::vector<int> assembledLines;
+    REQUIRE(moduleGraph.mapModuleLine(main, 4, assembledLines) == 0);
+    REQUIRE(moduleGraph.mapModuleLine(main, 8, assembledLines) == 1);
+    REQUIRE(assembledLines == std::vector<int>{ 6 });
+
+    // Combined with tree shaking
+    moduleGraph.setTreeShaking(true);
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSourceSize() == moduleGraph.getAssembledSource().size());
+    REQUIRE(moduleGraph.getAssembledSource().find("vec3 lib(){\nreturn vec3(0.5);\n}\nout vec4 color;\n") != std::string::npos);
+
+    // Disabling it restores the whole output
+    moduleGraph.setTreeShaking(false);
+    moduleGraph.setMinify(false);
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getProgramHash() == fullHash);
+}
+
+SCENARIO("ModuleGraph minified output reduces the test shaders", "[source_minifier_test.cpp]") {
+    const char *shaders[] = { "comment", "diamond", "hoisting", "relative", "simple" };
+    for (const char *shader : shaders) {
+        const std::string dir = std::string("resources/shaders/") + shader;
+        SourceMinifierTestModuleLoader loader;
+        ModuleGraph moduleGraph;
+        moduleGraph.setModuleLoader(&loader);
+        moduleGraph.setIncludeDir(dir);
+        moduleGraph.loadModule(dir + "/main.glsl");
+        const std::size_t fullSize = moduleGraph.getAssembledSourceSize();
+
+        moduleGraph.setMinify(true);
+        moduleGraph.loadModule(dir + "/main.glsl");
+        const std::string &source = moduleGraph.getAssembledSource();
+        REQUIRE(source.size() == moduleGraph.getAssembledSourceSize());
+        REQUIRE(source.size() < fullSize * 3 / 4);
+        REQUIRE(source.find("//") == std::string::npos);
+        REQUIRE(source.find("\n\n") == std::string::npos);
+
+        // Every line maps back to a module line starting with the same token
+        int lineIndex = 0;
+        for (std::size_t begin = 0; begin <= source.size(); lineIndex++) {
+            std::size_t end = source.find('\n', begin);
+            end = end == std::string::npos ? source.size() : end;
+            int moduleLine = -1;
+            const Module *module = moduleGraph.mapLine(lineIndex, moduleLine);
+            REQUIRE(module != nullptr);
+            const std::string line = module->getSourceLine(moduleLine);
+            REQUIRE(line.find(source.substr(begin, 1)) != std::string::npos);
+            begin = end + 1;
+        }
+    }
+}
@@ -25,3 +25,51 @@ SCENARIO("StringUtils works", "[string_utils_test.cpp]") {
 
     REQUIRE(replaceAll("It's a fair bet that if it's fair tomorrow", "fair", "unfair") == "It's a unfair bet that if it's unfair tomorrow");
 }
+
+SCENARIO("StringUtils scanning primitives work with every instruction set", "[string_utils_test.cpp]") {
+    const SimdLevel supportedLevel = getSupportedSimdLevel();
+    REQUIRE(getSimdLevel() == supportedLevel);
+    const SimdLevel levels[] = { SimdLevel::SCALAR, SimdLevel::SSE2, SimdLevel::AVX2 };
+    for (const SimdLevel level : levels) {
+        setSimdLevel(level);
+        REQUIRE(getSimdLevel() == (level > supportedLevel ? supportedLevel : level));
+
+        // Newlines at every position relative to the block boundaries
+        for (std::size_t size = 0; size < 100; size++) {
+            std::string text(size, 'x');
+            std::vector<std::size_t> expected;
+            for (std::size_t i = size % 7; i < size; i += 1 + i % 5) {
+                text[i] = '\n';
+                expected.push_back(i);
+            }
+
+            std::vector<std::size_t> positions(1, 42);
+            findNewlines(text.data(), text.size(), positions);
+            expected.insert(expected.begin(), 42);
+            REQUIRE(positions == expected);
+        }
+
+        // Whitespace runs of every length, on both sides
+        for (std::size_t spaces = 0; spaces < 80; spaces++) {
+            std::string whitespace;
+            for (std::size_t i = 0; i < spaces; i++) {
+                whitespace += " \t\n\v\f\r"[i % 6];
+            }
+
+            const std::string text = whitespace + "a\x1f b\x80" + whitespace;
+            const char *begin = text.data();
+            const char *end = begin + text.size();
+            REQUIRE(skipWhitespace(begin, end) == begin + spaces);
+            REQUIRE(skipWhitespaceBackward(begin, end) == end - spaces);
+            REQUIRE(skipWhitespace(begin, begin + spaces) == begin + spaces);
+            REQUIRE(skipWhitespaceBackward(end - spaces, end) == end - spaces);
+            REQUIRE(trim_copy(text) == "a\x1f b\x80");
+        }
+
+        REQUIRE(splitLines("first\r\n\nthird") == std::vector<std::string>{ "first\r", "", "third" });
+        REQUIRE(splitLines("").empty());
+        REQUIRE(splitLines("\n") == std::vector<std::string>{ "" });
+    }
+
+    setSimdLevel(supportedLevel);
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/thread_pool.h>
+#include <stdexcept>
+
+SCENARIO("ThreadPool works", "[thread_pool_test.cpp]") {
+    ThreadPool pool(4);
+    REQUIRE(pool.getThreadCount() == 4);
+
+    std::vector<int> values(1000, 0);
+    pool.parallelFor(values.size(), [&values](const int i) { values[i] = i * 2; });
+    for (int i = 0; i < values.size(); i++) {
+        REQUIRE(values[i] == i * 2);
+    }
+
+    // Nested invocations do not deadlock, since waiting threads execute queued tasks
+    std::atomic<int> sum(0);
+    pool.parallelFor(16, [&pool, &sum](const int) {
+        pool.parallelFor(16, [&sum](const int j) { sum += j; });
+    });
+    REQUIRE(sum == 16 * (15 * 16 / 2));
+
+    // The exception with the lowest index is rethrown, after all invocations completed
+    std::atomic<int> completed(0);
+    REQUIRE_THROWS_WITH(
+        pool.parallelFor(100, [&completed](const int i) {
+            completed++;
+            if (i == 10 || i == 50) {
+                throw std::runtime_error("error " + std::to_string(i));
+            }
+        }),
+        "error 10"
+    );
+    REQUIRE(completed == 100);
+
+    std::atomic<int> submitted(0);
+    {
+        ThreadPool other(2);
+        for (int i = 0; i < 100; i++) {
+            other.submit([&submitted]() { submitted++; });
+        }
+    }
+    REQUIRE(submitted == 100);
+}
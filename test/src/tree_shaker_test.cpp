@@ -0,0 +1,202 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/tree_shaker.h>
+#include <map>
+#include <stdexcept>
+
+class TreeShakerTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+
+    std::string load(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        return it->second;
+    }
+};
+
+SCENARIO("TreeShaker works", "[tree_shaker_test.cpp]") {
+    TreeShakerTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] =
+        "#version 330\n"
+        "#include <lib.glsl>\n"
+        "uniform Material material;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    color = vec4(shade(material), 1.0);\n"
+        "}\n";
+    loader.files["shaders/lib.glsl"] =
+        "// Material parameters\n"
+        "struct Material {\n"
+        "    vec3 albedo;\n"
+        "};\n"
+        "\n"
+        "struct Unused { float x; };\n"
+        "const float PI = 3.14159, TAU = 6.28318;\n"
+        "const float SCALE[2] = float[2](1.0, 2.0);\n"
+        "\n"
+        "/* Not referenced\n"
+        "   at all */\n"
+        "float unused(float x) {\n"
+        "    return x * PI;\n"
+        "}\n"
+        "\n"
+        "float helper(float x);\n"
+        "vec3 shade(Material m) {\n"
+        "    return m.albedo * helper(SCALE[0]);\n"
+        "}\n"
+        "float helper(float x) { return x / TAU; }\n"
+        "float helper(vec2 x) { return x.x; } float other() { return 0.0; }\n"
+        "#define UNUSED_MACRO 1\n"
+        "// trailing comment\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    const std::string fullSource = moduleGraph.getAssembledSource();
+    const std::uint64_t fullHash = moduleGraph.getProgramHash();
+
+    moduleGraph.setTreeShaking(true);
+    REQUIRE(moduleGraph.isTreeShaking());
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() ==
+        "#version 330\n"
+        "// MODULE BEGIN: shaders/lib.glsl\n"
+        "// Material parameters\n"
+        "struct Material {\n"
+        "    vec3 albedo;\n"
+        "};\n"
+        "const float PI = 3.14159, TAU = 6.28318;\n"
+        "const float SCALE[2] = float[2](1.0, 2.0);\n"
+        "\n"
+        "float helper(float x);\n"
+        "vec3 shade(Material m) {\n"
+        "    return m.albedo * helper(SCALE[0]);\n"
+        "}\n"
+        "float helper(float x) { return x / TAU; }\n"
+        "float helper(vec2 x) { return x.x; } float other() { return 0.0; }\n"
+        "#define UNUSED_MACRO 1\n"
+        "// trailing comment\n"
+        "\n"
+        "// MODULE BEGIN: shaders/main.glsl\n"
+        "// #version 330\n"
+        "// #include <lib.glsl>\n"
+        "uniform Material material;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    color = vec4(shade(material), 1.0);\n"
+        "}\n"
+    );
+    REQUIRE(moduleGraph.getAssembledSourceSize() == moduleGraph.getAssembledSource().size());
+    REQUIRE(moduleGraph.getProgramHash() != fullHash);
+
+    // Line mapping skips the removed lines (the blank line before a declaration belongs to it)
+    const Module *lib = moduleGraph.findModule("shaders/lib.glsl");
+    int moduleLine = -1;
+    REQUIRE(moduleGraph.mapLine(5, moduleLine) == lib);
+    REQUIRE(moduleLine == 3);
+    REQUIRE(moduleGraph.mapLine(6, moduleLine) == lib);
+    REQUIRE(moduleLine == 6);
+    REQUIRE(moduleGraph.mapLine(8, moduleLine) == lib);
+    REQUIRE(moduleLine == 14);
+    REQUIRE(moduleGraph.mapLine(10, moduleLine) == lib);
+    REQUIRE(moduleLine == 16);
+    std::vector<int> assembledLines;
+    REQUIRE(moduleGraph.mapModuleLine(lib, 11, assembledLines) == 0);
+    REQUIRE(moduleGraph.mapModuleLine(lib, 16, assembledLines) == 1);
+    REQUIRE(assembledLines == std::vector<int>{ 10 });
+    REQUIRE(moduleGraph.getSourceBlocksCount() == 1 + 3 + 1);
+
+    // Disabling it restores the whole output
+    moduleGraph.setTreeShaking(false);
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() == fullSource);
+    REQUIRE(moduleGraph.getProgramHash() == fullHash);
+}
+
+SCENARIO("TreeShaker keeps what it cannot split", "[tree_shaker_test.cpp]") {
+    TreeShakerTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] =
+        "#include \"a.glsl\"\n"
+        "#include \"b.glsl\"\n"
+        "void main() { a(); }\n";
+    loader.files["shaders/a.glsl"] =
+        "#ifdef FAST\n"
+        "void a() {\n"
+        "#else\n"
+        "void a() { b();\n"
+        "#endif\n"
+        "}\n";
+    loader.files["shaders/b.glsl"] =
+        "void b() {}\n"
+        "void c() {}\n";
+    loader.files["shaders/unused.glsl"] =
+        "void d() {}\n";
+    loader.files["shaders/comments.glsl"] =
+        "// Only comments\n";
+    loader.files["shaders/trailing.glsl"] =
+        "float unused() { return 1.0; } /* comment\n"
+        "   continued */\n"
+        "#define A 1 /* comment\n"
+        "   continued */\n"
+        "void used() {}\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setTreeShaking(true);
+    moduleGraph.loadModule("shaders/main.glsl");
+
+    // a.glsl has unbalanced braces, so it is kept whole, and b() is referenced by it
+    std::vector<Module *> modules;
+    modules.push_back(moduleGraph.findModule("shaders/a.glsl"));
+    modules.push_back(moduleGraph.findModule("shaders/b.glsl"));
+    modules.push_back(moduleGraph.findModule("shaders/main.glsl"));
+    std::vector<std::vector<ModuleGraph::LineRange>> keptRanges;
+    TreeShaker::shake(modules, keptRanges);
+    REQUIRE(keptRanges.size() == 3);
+    REQUIRE(keptRanges[0].size() == 1);
+    REQUIRE(keptRanges[0][0].begin == 0);
+    REQUIRE(keptRanges[0][0].end == 5);
+    REQUIRE(keptRanges[1].size() == 1);
+    REQUIRE(keptRanges[1][0].begin == 0);
+    REQUIRE(keptRanges[1][0].end == 0);
+    REQUIRE(keptRanges[2][0].end == 2);
+
+    // Entirely removed modules are not emitted at all, modules without declarations are kept
+    loader.files["shaders/main.glsl"] =
+        "#include \"unused.glsl\"\n"
+        "#include \"comments.glsl\"\n"
+        "void main() {}\n";
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() ==
+        "// MODULE BEGIN: shaders/comments.glsl\n"
+        "// Only comments\n"
+        "\n"
+        "// MODULE BEGIN: shaders/main.glsl\n"
+        "// #include \"unused.glsl\"\n"
+        "// #include \"comments.glsl\"\n"
+        "void main() {}\n"
+    );
+
+    // Block comments starting after a declaration belong to it, up to their last line
+    loader.files["shaders/main.glsl"] =
+        "#include \"trailing.glsl\"\n"
+        "void main() { used(); }\n";
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() ==
+        "// MODULE BEGIN: shaders/trailing.glsl\n"
+        "#define A 1 /* comment\n"
+        "   continued */\n"
+        "void used() {}\n"
+        "\n"
+        "// MODULE BEGIN: shaders/main.glsl\n"
+        "// #include \"trailing.glsl\"\n"
+        "void main() { used(); }\n"
+    );
+}
@@ -0,0 +1,159 @@
+#include <catch2/catch.hpp>
+#include <glsl_assembler/assembly_sink.h>
+#include <glsl_assembler/module.h>
+#include <glsl_assembler/module_graph.h>
+#include <glsl_assembler/simple_module_loader.h>
+#include <glsl_assembler/thread_pool.h>
+#include <glsl_assembler/variant_assembler.h>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+class VariantAssemblerTestModuleLoader : public SimpleModuleLoader {
+public:
+    std::map<std::string, std::string> files;
+    int loadCount = 0;
+
+    std::string load(const std::string &path) override {
+        const auto it = files.find(path);
+        if (it == files.end()) {
+            throw std::runtime_error("Not found: " + path);
+        }
+
+        loadCount++;
+        return it->second;
+    }
+};
+
+SCENARIO("VariantAssembler works", "[variant_assembler_test.cpp]") {
+    VariantAssemblerTestModuleLoader loader;
+    loader.files["shaders/main.glsl"] =
+        "#include <lib.glsl>\n"
+        "#version 300 es\n"
+        "precision mediump float;\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "#ifdef RED\n"
+        "    color = vec4(1.0, 0.0, 0.0, ALPHA);\n"
+        "#else\n"
+        "    color = vec4(lib(), ALPHA);\n"
+        "#endif\n"
+        "}\n";
+    loader.files["shaders/lib.glsl"] = "vec3 lib() { return vec3(0.5); }\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    moduleGraph.setIncludeDir("shaders");
+    moduleGraph.loadModule("shaders/main.glsl");
+    REQUIRE(moduleGraph.getHoistedLinesCount() == 2);
+    REQUIRE(loader.loadCount == 2);
+
+    VariantAssembler variantAssembler(moduleGraph);
+    REQUIRE(&variantAssembler.getModuleGraph() == &moduleGraph);
+    const VariantAssembler::Variant variant = variantAssembler.assemble({ { "RED" }, { "ALPHA", "0.5" } });
+    const std::string &source = moduleGraph.getAssembledSource();
+    const std::size_t hoistedSize = source.find("// MODULE BEGIN");
+    REQUIRE(variant.source == source.substr(0, hoistedSize) + "#define RED\n#define ALPHA 0.5\n" + source.substr(hoistedSize));
+    REQUIRE(variant.source.find("#version 300 es\nprecision mediump float;\n#define RED\n") == 0);
+    REQUIRE(variant.defineLinesBegin == 2);
+    REQUIRE(variant.moduleGraph == &moduleGraph);
+    REQUIRE(variant.programHash == variantAssembler.getProgramHash(variant.defines));
+    REQUIRE(variant.programHash != moduleGraph.getProgramHash());
+
+    // Line mapping skips the define lines
+    const Module *main = moduleGraph.findModule("shaders/main.glsl");
+    const Module *lib = moduleGraph.findModule("shaders/lib.glsl");
+    int moduleLine = -1;
+    REQUIRE(variant.mapLine(1, moduleLine) == main);
+    REQUIRE(moduleLine == 2);
+    REQUIRE(variant.mapLine(2, moduleLine) == nullptr);
+    REQUIRE(moduleLine == -1);
+    REQUIRE(variant.mapLine(3, moduleLine) == nullptr);
+    REQUIRE(variant.mapLine(5, moduleLine) == lib);
+    REQUIRE(moduleLine == 0);
+    std::vector<int> lines;
+    REQUIRE(variant.mapModuleLine(main, 2, lines) == 2);
+    REQUIRE(lines[0] == 1);
+    REQUIRE(variant.mapLine(lines[1], moduleLine) == main);
+    REQUIRE(moduleLine == 2);
+    REQUIRE(variant.mapModuleLine(lib, 0, lines) == 1);
+    REQUIRE(lines == std::vector<int>{ 5 });
+    REQUIRE(variant.mapModuleLine(main, 6, lines) == 1);
+    REQUIRE(variant.mapLine(lines[0], moduleLine) == main);
+    REQUIRE(moduleLine == 6);
+
+    // The hash depends on the defines and their order
+    std::set<std::uint64_t> hashes;
+    hashes.insert(variantAssembler.getProgramHash({}));
+    hashes.insert(variantAssembler.getProgramHash({ { "RED" } }));
+    hashes.insert(variantAssembler.getProgramHash({ { "RED", "1" } }));
+    hashes.insert(variantAssembler.getProgramHash({ { "RED" }, { "ALPHA", "0.5" } }));
+    hashes.insert(variantAssembler.getProgramHash({ { "ALPHA", "0.5" }, { "RED" } }));
+    REQUIRE(hashes.size() == 5);
+    REQUIRE(variantAssembler.assemble(std::vector<VariantAssembler::Define>()).source == source);
+
+    // Many variants, in parallel, without loading anything again
+    std::vector<std::vector<VariantAssembler::Define>> defineSets;
+    for (int i = 0; i < 64; i++) {
+        std::vector<VariantAssembler::Define> defines;
+        if (i % 2) {
+            defines.emplace_back("RED");
+        }
+
+        defines.emplace_back("ALPHA", std::to_string(i) + ".0");
+        defineSets.push_back(defines);
+    }
+
+    ThreadPool threadPool(4);
+    const std::vector<VariantAssembler::Variant> variants = variantAssembler.assembleAll(defineSets, &threadPool);
+    const std::vector<VariantAssembler::Variant> serialVariants = variantAssembler.assembleAll(defineSets);
+    REQUIRE(variants.size() == 64);
+    for (int i = 0; i < 64; i++) {
+        REQUIRE(variants[i].source == serialVariants[i].source);
+        REQUIRE(variants[i].source == variantAssembler.assemble(defineSets[i]).source);
+        REQUIRE(variants[i].programHash == serialVariants[i].programHash);
+    }
+
+    REQUIRE(loader.loadCount == 2);
+
+    // Streamed from the modules when the graph does not keep its source
+    moduleGraph.setKeepAssembledSource(false);
+    moduleGraph.loadModule("shaders/main.glsl");
+    std::string streamed;
+    StringAssemblySink sink(streamed);
+    variantAssembler.writeSource(variant.defines, sink);
+    REQUIRE(streamed == variant.source);
+
+    // Invalid defines
+    REQUIRE_THROWS_AS(variantAssembler.assemble({ { "" } }), std::runtime_error);
+    REQUIRE_THROWS_AS(variantAssembler.assemble({ { "A", "1\n#define B" } }), std::runtime_error);
+}
+
+SCENARIO("VariantAssembler places the defines without hoisted lines or modules", "[variant_assembler_test.cpp]") {
+    VariantAssemblerTestModuleLoader loader;
+    loader.files["shaders/plain.glsl"] = "void main() {}\n";
+    loader.files["shaders/version.glsl"] = "#version 330\n";
+
+    ModuleGraph moduleGraph;
+    moduleGraph.setModuleLoader(&loader);
+    const std::vector<VariantAssembler::Define> defines = { { "A", "1" }, { "F(x)", "(x)" } };
+    VariantAssembler variantAssembler(moduleGraph);
+
+    // Without hoisted lines, the defines come first
+    moduleGraph.loadModule("shaders/plain.glsl");
+    VariantAssembler::Variant variant = variantAssembler.assemble(defines);
+    REQUIRE(variant.source == "#define A 1\n#define F(x) (x)\n" + moduleGraph.getAssembledSource());
+    int moduleLine = -1;
+    REQUIRE(variant.mapLine(0, moduleLine) == nullptr);
+    REQUIRE(variant.mapLine(3, moduleLine) == moduleGraph.findModule("shaders/plain.glsl"));
+    REQUIRE(moduleLine == 0);
+
+    // With only hoisted lines (the commented directives are minified away), the defines come last
+    moduleGraph.setMinify(true);
+    moduleGraph.loadModule("shaders/version.glsl");
+    REQUIRE(moduleGraph.getAssembledSource() == "#version 330");
+    variant = variantAssembler.assemble(defines);
+    REQUIRE(variant.source == "#version 330\n#define A 1\n#define F(x) (x)");
+    REQUIRE(variant.mapLine(0, moduleLine) == moduleGraph.findModule("shaders/version.glsl"));
+    REQUIRE(variant.mapLine(2, moduleLine) == nullptr);
+}